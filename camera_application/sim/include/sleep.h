@@ -0,0 +1,10 @@
+// Host build shim, sleeps advance the simulated clock instead of the wall clock
+#ifndef __SIM_SLEEP_H__
+#define __SIM_SLEEP_H__
+
+#include "xil_types.h"
+
+int usleep(unsigned long useconds);
+unsigned sleep(unsigned int seconds);
+
+#endif
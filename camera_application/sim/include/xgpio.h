@@ -0,0 +1,20 @@
+// Host build shim, dual channel GPIO wired to the simulated camera pins
+#ifndef __SIM_XGPIO_H__
+#define __SIM_XGPIO_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+
+typedef struct {
+    UINTPTR BaseAddress;
+    u32 IsReady;
+    u32 Direction[2];
+    u32 Data[2];
+} XGpio;
+
+int  XGpio_Initialize(XGpio *InstancePtr, UINTPTR BaseAddress);
+void XGpio_SetDataDirection(XGpio *InstancePtr, unsigned Channel, u32 DirectionMask);
+u32  XGpio_DiscreteRead(XGpio *InstancePtr, unsigned Channel);
+void XGpio_DiscreteWrite(XGpio *InstancePtr, unsigned Channel, u32 Mask);
+
+#endif
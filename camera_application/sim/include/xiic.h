@@ -0,0 +1,76 @@
+// Host build shim, the interrupt driven XIic API on top of the simulated bus
+#ifndef __SIM_XIIC_H__
+#define __SIM_XIIC_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xiic_l.h"
+
+#define XII_BUS_NOT_BUSY_EVENT  0x00000001
+#define XII_ARB_LOST_EVENT      0x00000002
+#define XII_SLAVE_NO_ACK_EVENT  0x00000004
+#define XII_MASTER_READ_EVENT   0x00000008
+#define XII_MASTER_WRITE_EVENT  0x00000010
+#define XII_GENERAL_CALL_EVENT  0x00000020
+
+#define XII_ADDR_TO_SEND_TYPE    1
+#define XII_ADDR_TO_RESPOND_TYPE 2
+
+typedef void (*XIic_Handler)(void *CallBackRef, int ByteCount);
+typedef void (*XIic_StatusHandler)(void *CallBackRef, int StatusEvent);
+
+typedef struct {
+    UINTPTR BaseAddress;
+    int Has10BitAddr;
+    u8 GpOutWidth;
+} XIic_Config;
+
+typedef struct {
+    u8 ArbitrationLost;
+    u8 RepeatedStarts;
+    u8 BusBusy;
+    u8 RecvBytes;
+    u8 RecvInterrupts;
+    u8 SendBytes;
+    u8 SendInterrupts;
+    u8 TxErrors;
+    u8 IicInterrupts;
+} XIicStats;
+
+typedef struct {
+    XIicStats Stats;
+    UINTPTR BaseAddress;
+    int Has10BitAddr;
+    int IsReady;
+    int IsStarted;
+    int AddrOfSlave;
+    u8 *SendBufferPtr;
+    u8 *RecvBufferPtr;
+    int SendByteCount;
+    int RecvByteCount;
+    XIic_Handler SendHandler;
+    void *SendCallBackRef;
+    XIic_Handler RecvHandler;
+    void *RecvCallBackRef;
+    XIic_StatusHandler StatusHandler;
+    void *StatusCallBackRef;
+} XIic;
+
+XIic_Config *XIic_LookupConfig(UINTPTR BaseAddress);
+int  XIic_CfgInitialize(XIic *InstancePtr, XIic_Config *Config, UINTPTR EffectiveAddr);
+int  XIic_Start(XIic *InstancePtr);
+int  XIic_Stop(XIic *InstancePtr);
+void XIic_Reset(XIic *InstancePtr);
+int  XIic_SetAddress(XIic *InstancePtr, int AddressType, int Address);
+int  XIic_MasterSend(XIic *InstancePtr, u8 *TxMsgPtr, int ByteCount);
+int  XIic_MasterRecv(XIic *InstancePtr, u8 *RxMsgPtr, int ByteCount);
+u32  XIic_IsIicBusy(XIic *InstancePtr);
+void XIic_SetSendHandler(XIic *InstancePtr, void *CallBackRef, XIic_Handler FuncPtr);
+void XIic_SetRecvHandler(XIic *InstancePtr, void *CallBackRef, XIic_Handler FuncPtr);
+void XIic_SetStatusHandler(XIic *InstancePtr, void *CallBackRef, XIic_StatusHandler FuncPtr);
+void XIic_InterruptHandler(void *InstancePtr);
+void XIic_MultiMasterInclude(void);
+void XIic_GetStats(XIic *InstancePtr, XIicStats *StatsPtr);
+void XIic_ClearStats(XIic *InstancePtr);
+
+#endif
@@ -0,0 +1,29 @@
+// Host build shim, low level XIic definitions used by the application
+#ifndef __SIM_XIIC_L_H__
+#define __SIM_XIIC_L_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+
+#define XIIC_STOP           0x00
+#define XIIC_REPEATED_START 0x01
+
+#define XIIC_DGIER_OFFSET   0x1C
+#define XIIC_IISR_OFFSET    0x20
+#define XIIC_IIER_OFFSET    0x28
+#define XIIC_RESETR_OFFSET  0x40
+#define XIIC_CR_REG_OFFSET  0x100
+#define XIIC_SR_REG_OFFSET  0x104
+
+// Register reads see the simulated controller state
+u32  XIic_ReadReg(UINTPTR BaseAddress, u32 RegOffset);
+void XIic_WriteReg(UINTPTR BaseAddress, u32 RegOffset, u32 RegisterValue);
+
+void XIic_IntrGlobalDisable(UINTPTR BaseAddress);
+void XIic_IntrGlobalEnable(UINTPTR BaseAddress);
+
+int XIic_DynInit(UINTPTR BaseAddress);
+unsigned XIic_DynSend(UINTPTR BaseAddress, u16 Address, u8 *BufferPtr, u8 ByteCount, u8 Option);
+unsigned XIic_DynRecv(UINTPTR BaseAddress, u8 Address, u8 *BufferPtr, u8 ByteCount);
+
+#endif
@@ -0,0 +1,17 @@
+// Host build shim, exception enables gate interrupt delivery in the simulator
+#ifndef __SIM_XIL_EXCEPTION_H__
+#define __SIM_XIL_EXCEPTION_H__
+
+#include "xil_types.h"
+
+#define XIL_EXCEPTION_ID_INT 5U
+
+typedef void (*Xil_ExceptionHandler)(void *data);
+typedef void (*Xil_InterruptHandler)(void *data);
+
+void Xil_ExceptionInit(void);
+void Xil_ExceptionRegisterHandler(u32 Exception_id, Xil_ExceptionHandler Handler, void *Data);
+void Xil_ExceptionEnable(void);
+void Xil_ExceptionDisable(void);
+
+#endif
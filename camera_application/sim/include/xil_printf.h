@@ -0,0 +1,12 @@
+// Host build shim, xil_printf goes to stdout. Like the BSP version it is not format checked,
+// the application formats UINTPTR with %X which is only exact on the 32 bit target.
+#ifndef __SIM_XIL_PRINTF_H__
+#define __SIM_XIL_PRINTF_H__
+
+#include <stdio.h>
+
+void xil_printf(const char *ctrl1, ...);
+
+#define print(s) fputs((s), stdout)
+
+#endif
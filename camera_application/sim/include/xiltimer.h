@@ -0,0 +1,15 @@
+// Host build shim, the global timer reads the simulated clock
+#ifndef __SIM_XILTIMER_H__
+#define __SIM_XILTIMER_H__
+
+#include "xil_types.h"
+
+// Same rate as the Zynq global timer and, like the BSP's xtimer_config.h, without parentheses
+#define XSLEEPTIMER_FREQ  666665955ULL/2
+#define COUNTS_PER_SECOND XSLEEPTIMER_FREQ
+
+typedef u64 XTime;
+
+void XTime_GetTime(XTime *Xtime_Global);
+
+#endif
@@ -0,0 +1,37 @@
+// Host build shim, a GIC with per-interrupt enables and connected handlers
+#ifndef __SIM_XSCUGIC_H__
+#define __SIM_XSCUGIC_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_exception.h"
+
+#define XSCUGIC_MAX_NUM_INTR_INPUTS 95U
+
+typedef struct {
+    u32 DeviceId;
+    u32 CpuBaseAddress;
+    u32 DistBaseAddress;
+} XScuGic_Config;
+
+typedef struct {
+    Xil_InterruptHandler Handler;
+    void *CallBackRef;
+} XScuGic_VectorTableEntry;
+
+typedef struct {
+    XScuGic_Config *Config;
+    u32 IsReady;
+    XScuGic_VectorTableEntry Handlers[XSCUGIC_MAX_NUM_INTR_INPUTS];
+    u8 Enabled[XSCUGIC_MAX_NUM_INTR_INPUTS];
+} XScuGic;
+
+XScuGic_Config *XScuGic_LookupConfig(UINTPTR BaseAddress);
+int  XScuGic_CfgInitialize(XScuGic *InstancePtr, XScuGic_Config *ConfigPtr, u32 EffectiveAddr);
+int  XScuGic_Connect(XScuGic *InstancePtr, u32 Int_Id, Xil_InterruptHandler Handler, void *CallBackRef);
+void XScuGic_Enable(XScuGic *InstancePtr, u32 Int_Id);
+void XScuGic_Disable(XScuGic *InstancePtr, u32 Int_Id);
+void XScuGic_SetPriorityTriggerType(XScuGic *InstancePtr, u32 Int_Id, u8 Priority, u8 Trigger);
+void XScuGic_InterruptHandler(XScuGic *InstancePtr);
+
+#endif
@@ -0,0 +1,16 @@
+// Host build shim, status codes used by the application, values match the BSP
+#ifndef __SIM_XSTATUS_H__
+#define __SIM_XSTATUS_H__
+
+#include "xil_types.h"
+
+#define XST_SUCCESS         0L
+#define XST_FAILURE         1L
+#define XST_DEVICE_NOT_FOUND 2L
+#define XST_INVALID_PARAM   15L
+#define XST_NO_FEATURE      19L
+#define XST_DEVICE_BUSY     21L
+#define XST_TIMEOUT         31L
+#define XST_IIC_BUS_BUSY    1077
+
+#endif
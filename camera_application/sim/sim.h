@@ -0,0 +1,65 @@
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include "xil_types.h"
+
+/*
+    Host simulation of the camera board's control path.
+    Time is virtual, it only moves when the code under test reads the timer, sleeps, polls the
+    interrupt controller or drives the bus, so runs are deterministic and independent of the host.
+*/
+
+// SCCB / IIC timing, defaults model a 100 kHz bus
+typedef struct {
+    u32 byte_ns;        // One byte plus its ACK bit
+    u32 start_stop_ns;  // START, STOP or repeated START condition
+    u32 irq_ns;         // Interrupt entry latency after the bus goes idle
+    u32 poll_ns;        // Cost of one timer read or interrupt controller access
+} Sim_BusTiming;
+
+// A simulated IIC slave, callbacks run when the transfer completes on the bus
+typedef struct Sim_Slave {
+    u8 addr;                                          // 7 bit address
+    int  (*ack)(void *ref);                           // TRUE to ACK the address phase
+    void (*write)(void *ref, const u8 *data, int n);  // Master to slave bytes
+    void (*read)(void *ref, u8 *data, int n);         // Slave to master bytes
+    void (*pins)(void *ref, u32 gpio_out);            // GPIO channel 1 changed, NULL if not wired
+    void *ref;
+    struct Sim_Slave *next;
+} Sim_Slave;
+
+// Clock and bus control
+void Sim_Reset(void);
+void Sim_SetTiming(const Sim_BusTiming *timing);
+void Sim_GetTiming(Sim_BusTiming *timing);
+u64  Sim_Now(void);                   // Virtual time in ns
+void Sim_Advance(u64 ns);             // Move time forward, delivering due interrupts
+
+// Fault injection
+void Sim_InjectNack(int count);       // NACK the next count address phases
+void Sim_InjectBusBusy(u32 ns);       // Another master holds the bus for ns
+void Sim_InjectDynInitFail(int count); // Fail the next count XIic_DynInit calls
+void Sim_SetXclkLockTime(u32 us);     // GPIO channel 2 bit 0 rises this long after start
+
+// Bus wiring
+void Sim_AttachSlave(Sim_Slave *slave);
+
+// Totals for the whole run
+typedef struct {
+    u32 transfers;      // Address phases on the bus
+    u32 nacks;          // Address phases not acknowledged
+    u32 bytes;          // Data bytes moved
+    u32 interrupts;     // IIC interrupts delivered
+    u64 busy_ns;        // Time the bus was driven by us
+} Sim_BusStats;
+
+void Sim_GetBusStats(Sim_BusStats *stats);
+
+// Internal to the simulator
+void Sim_Bsp_Reset(void);
+int  Sim_IrqDeliverable(void *gic, u32 int_id);
+void Sim_Iic_Connect(void *gic, u32 int_id, void *handler, void *ref);
+void Sim_Iic_Service(void);
+void Sim_Gpio_Write(u32 value);
+
+#endif
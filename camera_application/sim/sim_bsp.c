@@ -0,0 +1,201 @@
+#include <stdarg.h>
+#include <string.h>
+
+#include "sim.h"
+#include "xiltimer.h"
+#include "sleep.h"
+#include "xscugic.h"
+#include "xil_exception.h"
+#include "xgpio.h"
+#include "xil_printf.h"
+
+/*
+    Clock, interrupt controller, exceptions and GPIO of the simulated board.
+    The IIC controller model lives in sim_xiic.c.
+*/
+
+#define SIM_DEFAULT_XCLK_LOCK_US 2000
+
+static u64 sim_now_ns;
+static u32 sim_xclk_lock_us = SIM_DEFAULT_XCLK_LOCK_US;
+static int sim_exceptions_enabled;
+static XScuGic_Config sim_gic_cfg;
+
+u64 Sim_Now(void)
+{
+    return sim_now_ns;
+}
+
+void Sim_Advance(u64 ns)
+{
+    sim_now_ns += ns;
+    Sim_Iic_Service();
+}
+
+void Sim_SetXclkLockTime(u32 us)
+{
+    sim_xclk_lock_us = us;
+}
+
+// Interrupts reach the handler only with exceptions on and the line enabled at the GIC
+int Sim_IrqDeliverable(void *gic_ptr, u32 int_id)
+{
+    XScuGic *gic = (XScuGic *)gic_ptr;
+    return sim_exceptions_enabled && gic != NULL && int_id < XSCUGIC_MAX_NUM_INTR_INPUTS && gic->Enabled[int_id];
+}
+
+void Sim_Bsp_Reset(void)
+{
+    sim_now_ns = 0;
+    sim_xclk_lock_us = SIM_DEFAULT_XCLK_LOCK_US;
+    sim_exceptions_enabled = 0;
+}
+
+// ------------------------------------------ Global Timer ------------------------------------------
+
+void XTime_GetTime(XTime *Xtime_Global)
+{
+    Sim_BusTiming timing;
+
+    Sim_GetTiming(&timing);
+    Sim_Advance(timing.poll_ns);
+    *Xtime_Global = sim_now_ns * (COUNTS_PER_SECOND) / 1000000000ULL;
+}
+
+int usleep(unsigned long useconds)
+{
+    Sim_Advance((u64)useconds * 1000ULL);
+    return 0;
+}
+
+unsigned sleep(unsigned int seconds)
+{
+    Sim_Advance((u64)seconds * 1000000000ULL);
+    return 0;
+}
+
+// ------------------------------------------ Exceptions --------------------------------------------
+
+void Xil_ExceptionInit(void)
+{
+}
+
+void Xil_ExceptionRegisterHandler(u32 Exception_id, Xil_ExceptionHandler Handler, void *Data)
+{
+    (void)Exception_id;
+    (void)Handler;
+    (void)Data;
+}
+
+void Xil_ExceptionEnable(void)
+{
+    sim_exceptions_enabled = 1;
+    Sim_Iic_Service();
+}
+
+void Xil_ExceptionDisable(void)
+{
+    sim_exceptions_enabled = 0;
+}
+
+// ------------------------------------------ Interrupt Controller ----------------------------------
+
+XScuGic_Config *XScuGic_LookupConfig(UINTPTR BaseAddress)
+{
+    sim_gic_cfg.CpuBaseAddress = (u32)BaseAddress;
+    return &sim_gic_cfg;
+}
+
+int XScuGic_CfgInitialize(XScuGic *InstancePtr, XScuGic_Config *ConfigPtr, u32 EffectiveAddr)
+{
+    (void)EffectiveAddr;
+    memset(InstancePtr, 0, sizeof(*InstancePtr));
+    InstancePtr->Config = ConfigPtr;
+    InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+    return XST_SUCCESS;
+}
+
+int XScuGic_Connect(XScuGic *InstancePtr, u32 Int_Id, Xil_InterruptHandler Handler, void *CallBackRef)
+{
+    if(Int_Id >= XSCUGIC_MAX_NUM_INTR_INPUTS) return XST_INVALID_PARAM;
+    InstancePtr->Handlers[Int_Id].Handler = Handler;
+    InstancePtr->Handlers[Int_Id].CallBackRef = CallBackRef;
+
+    // The IIC model raises its interrupt on whichever line the driver was connected to
+    Sim_Iic_Connect(InstancePtr, Int_Id, (void *)Handler, CallBackRef);
+    return XST_SUCCESS;
+}
+
+void XScuGic_Enable(XScuGic *InstancePtr, u32 Int_Id)
+{
+    Sim_BusTiming timing;
+
+    if(Int_Id >= XSCUGIC_MAX_NUM_INTR_INPUTS) return;
+    InstancePtr->Enabled[Int_Id] = 1;
+
+    // Distributor access, also where a pending interrupt gets taken
+    Sim_GetTiming(&timing);
+    Sim_Advance(timing.poll_ns);
+}
+
+void XScuGic_Disable(XScuGic *InstancePtr, u32 Int_Id)
+{
+    if(Int_Id >= XSCUGIC_MAX_NUM_INTR_INPUTS) return;
+    InstancePtr->Enabled[Int_Id] = 0;
+}
+
+void XScuGic_SetPriorityTriggerType(XScuGic *InstancePtr, u32 Int_Id, u8 Priority, u8 Trigger)
+{
+    (void)InstancePtr;
+    (void)Int_Id;
+    (void)Priority;
+    (void)Trigger;
+}
+
+void XScuGic_InterruptHandler(XScuGic *InstancePtr)
+{
+    (void)InstancePtr;
+}
+
+// ------------------------------------------ GPIO --------------------------------------------------
+
+int XGpio_Initialize(XGpio *InstancePtr, UINTPTR BaseAddress)
+{
+    memset(InstancePtr, 0, sizeof(*InstancePtr));
+    InstancePtr->BaseAddress = BaseAddress;
+    InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+    return XST_SUCCESS;
+}
+
+void XGpio_SetDataDirection(XGpio *InstancePtr, unsigned Channel, u32 DirectionMask)
+{
+    if(Channel < 1 || Channel > 2) return;
+    InstancePtr->Direction[Channel - 1] = DirectionMask;
+}
+
+// Channel 2 bit 0 is the XCLK clock wizard lock
+u32 XGpio_DiscreteRead(XGpio *InstancePtr, unsigned Channel)
+{
+    if(Channel == 2) return (sim_now_ns >= (u64)sim_xclk_lock_us * 1000ULL) ? 1U : 0U;
+    if(Channel == 1) return InstancePtr->Data[0];
+    return 0;
+}
+
+// Channel 1 drives RESET ( bit 1 ) and PWDN ( bit 0 ) of the camera
+void XGpio_DiscreteWrite(XGpio *InstancePtr, unsigned Channel, u32 Mask)
+{
+    if(Channel < 1 || Channel > 2) return;
+    InstancePtr->Data[Channel - 1] = Mask;
+    if(Channel == 1) Sim_Gpio_Write(Mask);
+}
+
+// ------------------------------------------ Console -----------------------------------------------
+
+void xil_printf(const char *ctrl1, ...)
+{
+    va_list args;
+
+    va_start(args, ctrl1);
+    vprintf(ctrl1, args);
+    va_end(args);
+}
@@ -0,0 +1,856 @@
+#include <stdlib.h>
+#include <string.h>
+#include <xstatus.h>
+
+#include "xil_printf.h"
+#include "xscugic.h"
+#include "xgpio.h"
+#include "ov7670.h"
+#include "ov7670_profiles.h"
+#include "iic_helper.h"
+#include "frame_pool.h"
+#include "frame_ring.h"
+#include "xil_mem.h"
+#include "pixel_convert.h"
+#include "resize.h"
+#include "demosaic.h"
+#include "image_stats.h"
+#include "auto_exposure.h"
+#include "auto_white_balance.h"
+#include "color_pipeline.h"
+#include "motion_detect.h"
+#include "sim.h"
+#include "sim_ov7670.h"
+
+/*
+    Host run of the camera control path against the simulated board.
+    Usage: ov7670_sim [bus_khz]     default 100 kHz SCCB
+    Exits with the number of failed checks, so CI can gate on it.
+*/
+
+#define SIM_IIC_BA          0x41600000U
+#define SIM_GPIO_BA         0x41200000U
+#define SIM_GIC_BA          0xF8F00100U
+#define SIM_IIC_INTERRUPT_ID 61U
+#define SIM_ABSENT_ADDR     0x50    // Nothing answers here
+#define SIM_FRAME_MEM_SIZE  (2U * 1024U * 1024U)
+#define SIM_FRAME_BLOCKS    3U
+#define SIM_MEM_TEST_BYTES  (64U * 1024U)
+#define SIM_PIX_W           36U     // Not a multiple of the NEON step, the remainder path runs too
+#define SIM_PIX_H           6U
+#define SIM_FRAME_NS        (66U * 1000U * 1000U)   // VGA at 15 fps
+
+static XScuGic intr_ctl;
+static XGpio camera_gpio;
+static IicCtrl iic_ctrl;
+static IicDevice ov7670_iic, absent_iic;
+static OV7670 camera;
+static Sim_OV7670 sensor;
+static FramePool frame_pool;
+static FrameRing frame_ring;
+static u8 frame_mem[SIM_FRAME_MEM_SIZE + FRAME_ALIGN];
+
+static Resize resize;
+static Demosaic demosaic;
+static ImageStats image_stats;
+static AutoExposure auto_exposure;
+static AutoWhiteBalance auto_white_balance;
+static ColorPipeline color_pipeline;
+static MotionDetect motion_detect;
+static int failures;
+static u8 mem_src[SIM_MEM_TEST_BYTES + 64], mem_dst[SIM_MEM_TEST_BYTES + 64], mem_ref[SIM_MEM_TEST_BYTES + 64];
+
+static void Sim_Check(int ok, const char *what)
+{
+    xil_printf("[%s] %s\n", ok ? "PASS" : "FAIL", what);
+    if(!ok) failures++;
+}
+
+// Register file matches every masked bit of a sequence
+static int Sim_Sensor_Matches(const OV7670_RegSeq *seq, int count)
+{
+    for(int i = 0; i < count; i++)
+    {
+        if((sensor.regs[seq[i].reg] & seq[i].mask) != (seq[i].value & seq[i].mask))
+        {
+            xil_printf("[ERROR] Reg 0x%02X: 0x%02X, expected 0x%02X\n", seq[i].reg, sensor.regs[seq[i].reg], seq[i].value);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Switch profile and report what it cost on the simulated bus
+static int Sim_Profile_Switch(OV7670_Resolution res, OV7670_Format fmt, u32 *writes)
+{
+    u64 t_start = Sim_Now();
+    int count, status;
+
+    Sim_OV7670_ClearCounts(&sensor);
+    status = OV7670_SetProfile(&camera, res, fmt);
+    *writes = sensor.reg_writes;
+
+    xil_printf("[INFO] Profile %d: %u register writes, %u us\n", OV7670_PROFILE_ID(res, fmt), *writes,
+               (u32)((Sim_Now() - t_start) / 1000ULL));
+
+    const OV7670_RegSeq *seq = OV7670_Profile_Get(OV7670_PROFILE_ID(res, fmt), &count);
+    return status == XST_SUCCESS && Sim_Sensor_Matches(seq, count);
+}
+
+// Xil_MemCpy / Xil_MemSet against libc for every head / tail alignment around the NEON cut-over
+static int Sim_Mem_Check(int set)
+{
+    static const u32 sizes[] = { 0, 1, 3, 15, 16, 63, 64, 65, XIL_MEM_NEON_MIN - 1U, XIL_MEM_NEON_MIN,
+                                 XIL_MEM_NEON_MIN + 1U, 200, 257, 1000, 4096 + 13, SIM_MEM_TEST_BYTES };
+
+    for(u32 i = 0; i < sizeof(mem_src); i++) mem_src[i] = (u8)(i * 13U + 7U);
+    for(u32 n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++)
+    {
+        for(u32 d_off = 0; d_off < 16; d_off++)
+        {
+            for(u32 s_off = 0; s_off < 16; s_off++)
+            {
+                memset(mem_dst, 0xEE, sizeof(mem_dst));
+                memset(mem_ref, 0xEE, sizeof(mem_ref));
+                if(set)
+                {
+                    Xil_MemSet(mem_dst + d_off, (s32)(0x100 + s_off), sizes[n]);
+                    memset(mem_ref + d_off, (int)s_off, sizes[n]);
+                }
+                else
+                {
+                    Xil_MemCpy(mem_dst + d_off, mem_src + s_off, sizes[n]);
+                    memcpy(mem_ref + d_off, mem_src + s_off, sizes[n]);
+                }
+                // Whole buffer, so writes outside the range count too
+                if(memcmp(mem_dst, mem_ref, sizeof(mem_dst)) != 0)
+                {
+                    xil_printf("[ERROR] %s of %u bytes, dst +%u, src +%u\n", set ? "Xil_MemSet" : "Xil_MemCpy", sizes[n], d_off, s_off);
+                    return 0;
+                }
+                if(set) break; // No source
+            }
+        }
+    }
+    return 1;
+}
+
+// Every RGB565 value survives RGB888 and back, primaries land on full scale
+static int Sim_Pix_Rgb565_RoundTrip(void)
+{
+    static u16 in[65536], out[65536];
+    static u8 rgb[3 * 65536];
+
+    for(u32 i = 0; i < 65536; i++) in[i] = (u16)i;
+    Pix_Rgb565ToRgb888_Line(rgb, in, 65536);
+    Pix_Rgb888ToRgb565_Line(out, rgb, 65536);
+    return memcmp(in, out, sizeof(in)) == 0 && rgb[3 * 0xF800] == 255 && rgb[3 * 0xF800 + 1] == 0 &&
+           rgb[3 * 0x07E0 + 1] == 255 && rgb[3 * 0x001F + 2] == 255;
+}
+
+// RGB555 -> RGB565 keeps R and B, and G in the top 5 bits
+static int Sim_Pix_Rgb555(void)
+{
+    static u16 in[32768], out[32768];
+
+    for(u32 i = 0; i < 32768; i++) in[i] = (u16)i;
+    Pix_Rgb555ToRgb565_Line(out, in, 32768);
+    for(u32 i = 0; i < 32768; i++)
+    {
+        if((out[i] >> 11) != ((i >> 10) & 0x1FU) || ((out[i] >> 6) & 0x1FU) != ((i >> 5) & 0x1FU) || (out[i] & 0x1FU) != (i & 0x1FU))
+            return 0;
+    }
+    return out[0x7FFF] == 0xFFFF;
+}
+
+// Frame level: YUYV to RGB, I420 and gray agree with each other
+static int Sim_Pix_Yuyv_Frame(void)
+{
+    static u8 yuyv[SIM_PIX_W * SIM_PIX_H * 2], rgb[SIM_PIX_W * SIM_PIX_H * 3];
+    static u8 i420[SIM_PIX_W * SIM_PIX_H * 3 / 2], gray[SIM_PIX_W * SIM_PIX_H];
+    PixImage src, dst;
+
+    // Pure red ( Y 76, U 85, V 255 ) everywhere, luma ramps on the right half
+    for(u32 i = 0; i < SIM_PIX_W * SIM_PIX_H / 2; i++)
+    {
+        u8 *p = yuyv + 4 * i;
+        p[0] = p[2] = (i % (SIM_PIX_W / 2)) < SIM_PIX_W / 4 ? 76 : (u8)(7 * i);
+        p[1] = 85;
+        p[3] = 255;
+    }
+    Pix_Image_Init(&src, yuyv, SIM_PIX_W, SIM_PIX_H, PIX_FMT_YUYV);
+
+    Pix_Image_Init(&dst, rgb, SIM_PIX_W, SIM_PIX_H, PIX_FMT_RGB888);
+    if(Pix_Convert(&src, &dst) != XST_SUCCESS || rgb[0] != 255 || rgb[1] != 0 || rgb[2] != 0) return 0;
+
+    Pix_Image_Init(&dst, i420, SIM_PIX_W, SIM_PIX_H, PIX_FMT_I420);
+    if(Pix_Convert(&src, &dst) != XST_SUCCESS || dst.planes[1][0] != 85 || dst.planes[2][SIM_PIX_W / 2 - 1] != 255) return 0;
+
+    Pix_Image_Init(&dst, gray, SIM_PIX_W, SIM_PIX_H, PIX_FMT_GRAY8);
+    if(Pix_Convert(&src, &dst) != XST_SUCCESS) return 0;
+    return memcmp(gray, i420, sizeof(gray)) == 0;
+}
+
+// Flat Bayer quads give their own level, unsupported pairs and odd geometry are refused
+static int Sim_Pix_Bayer_And_Errors(void)
+{
+    static u8 raw[SIM_PIX_W * SIM_PIX_H], gray[SIM_PIX_W * SIM_PIX_H];
+    PixImage src, dst;
+
+    memset(raw, 200, sizeof(raw));
+    Pix_Image_Init(&src, raw, SIM_PIX_W, SIM_PIX_H, PIX_FMT_BAYER_BGGR);
+    Pix_Image_Init(&dst, gray, SIM_PIX_W, SIM_PIX_H, PIX_FMT_GRAY8);
+    if(Pix_Convert(&src, &dst) != XST_SUCCESS || gray[0] != 200 || gray[sizeof(gray) - 1] != 200) return 0;
+
+    if(Pix_Convert(&dst, &src) != XST_NO_FEATURE) return 0;
+    src.format = PIX_FMT_YUYV;
+    src.width = dst.width = SIM_PIX_W - 1U;
+    return Pix_Convert(&src, &dst) == XST_INVALID_PARAM;
+}
+
+// 1:1 bilinear is an exact copy, RGB565 unpack / repack included
+static int Sim_Resize_Identity(void)
+{
+    static u16 in[64 * 48], out[64 * 48];
+    PixImage src, dst;
+
+    for(u32 i = 0; i < 64 * 48; i++) in[i] = (u16)(i * 2654435761U >> 16);
+    Pix_Image_Init(&src, in, 64, 48, PIX_FMT_RGB565);
+    Pix_Image_Init(&dst, out, 64, 48, PIX_FMT_RGB565);
+    return Resize_Bilinear(&resize, &src, NULL, &dst) == XST_SUCCESS && memcmp(in, out, sizeof(in)) == 0;
+}
+
+// Box 2x of 2x2 blocks gives the block values back, 4x of a flat RGB888 image keeps the colour
+static int Sim_Resize_Box(void)
+{
+    static u8 gray[40 * 20], half[20 * 10], rgb[64 * 32 * 3], quarter[16 * 8 * 3];
+    PixImage src, dst;
+
+    for(u32 y = 0; y < 20; y++)
+        for(u32 x = 0; x < 40; x++) gray[y * 40 + x] = (u8)((y / 2) * 20 + x / 2);
+    Pix_Image_Init(&src, gray, 40, 20, PIX_FMT_GRAY8);
+    Pix_Image_Init(&dst, half, 20, 10, PIX_FMT_GRAY8);
+    if(Resize_Image(&resize, &src, NULL, &dst) != XST_SUCCESS) return 0;
+    for(u32 i = 0; i < sizeof(half); i++) if(half[i] != (u8)i) return 0;
+
+    for(u32 i = 0; i < sizeof(rgb); i += 3) { rgb[i] = 10; rgb[i + 1] = 128; rgb[i + 2] = 250; }
+    Pix_Image_Init(&src, rgb, 64, 32, PIX_FMT_RGB888);
+    Pix_Image_Init(&dst, quarter, 16, 8, PIX_FMT_RGB888);
+    if(Resize_Image(&resize, &src, NULL, &dst) != XST_SUCCESS) return 0;
+    for(u32 i = 0; i < sizeof(quarter); i += 3) if(quarter[i] != 10 || quarter[i + 1] != 128 || quarter[i + 2] != 250) return 0;
+    return resize.stats.box == 2;
+}
+
+// Crop + bilinear scale: a ramp stays a ramp over the cropped range, bad requests are refused
+static int Sim_Resize_Crop(void)
+{
+    static u8 ramp[200 * 10], out[30 * 7];
+    ResizeRect crop = { 50, 2, 100, 6 };
+    ResizeRect outside = { 150, 0, 100, 6 };
+    PixImage src, dst;
+
+    for(u32 i = 0; i < sizeof(ramp); i++) ramp[i] = (u8)(i % 200);
+    Pix_Image_Init(&src, ramp, 200, 10, PIX_FMT_GRAY8);
+    Pix_Image_Init(&dst, out, 30, 7, PIX_FMT_GRAY8);
+    if(Resize_Image(&resize, &src, &crop, &dst) != XST_SUCCESS) return 0;
+    for(u32 x = 1; x < 30; x++) if(out[x] <= out[x - 1] || out[6 * 30 + x] != out[x]) return 0;
+    if(out[0] < 50 || out[29] > 149) return 0;
+
+    if(Resize_Image(&resize, &src, &outside, &dst) != XST_INVALID_PARAM) return 0;
+    src.format = dst.format = PIX_FMT_YUYV;
+    return Resize_Image(&resize, &src, NULL, &dst) == XST_NO_FEATURE;
+}
+
+// BGGR mosaic of an image given per column, the same on every line
+static void Sim_Bayer_Columns(u8 *raw, const u8 (*rgb)[3])
+{
+    for(u32 y = 0; y < SIM_PIX_H; y++)
+        for(u32 x = 0; x < SIM_PIX_W; x++)
+            raw[y * SIM_PIX_W + x] = rgb[x][(y & 1U) == 0 ? ((x & 1U) == 0 ? 2 : 1) : ((x & 1U) == 0 ? 1 : 0)];
+}
+
+// A flat colour comes back exactly from both methods, borders included, RGB565 output too
+static int Sim_Demosaic_Flat(void)
+{
+    static u8 raw[SIM_PIX_W * SIM_PIX_H], rgb[SIM_PIX_W * SIM_PIX_H * 3];
+    static u16 rgb565[SIM_PIX_W * SIM_PIX_H];
+    u8 cols[SIM_PIX_W][3];
+    PixImage src, dst;
+
+    for(u32 x = 0; x < SIM_PIX_W; x++) { cols[x][0] = 200; cols[x][1] = 100; cols[x][2] = 40; }
+    Sim_Bayer_Columns(raw, (const u8 (*)[3])cols);
+    Pix_Image_Init(&src, raw, SIM_PIX_W, SIM_PIX_H, PIX_FMT_BAYER_BGGR);
+    for(int method = DEMOSAIC_BILINEAR; method <= DEMOSAIC_EDGE_AWARE; method++)
+    {
+        Demosaic_Init(&demosaic, (DemosaicMethod)method);
+        Pix_Image_Init(&dst, rgb, SIM_PIX_W, SIM_PIX_H, PIX_FMT_RGB888);
+        if(Demosaic_Frame(&demosaic, &src, &dst) != XST_SUCCESS) return 0;
+        for(u32 i = 0; i < sizeof(rgb); i += 3) if(rgb[i] != 200 || rgb[i + 1] != 100 || rgb[i + 2] != 40) return 0;
+
+        Pix_Image_Init(&dst, rgb565, SIM_PIX_W, SIM_PIX_H, PIX_FMT_RGB565);
+        if(Demosaic_Frame(&demosaic, &src, &dst) != XST_SUCCESS) return 0;
+        for(u32 i = 0; i < SIM_PIX_W * SIM_PIX_H; i++) if(rgb565[i] != (((200U >> 3) << 11) | ((100U >> 2) << 5) | (40U >> 3))) return 0;
+    }
+    return demosaic.stats.frames == 2;
+}
+
+// Grey scene with a vertical edge: bilinear leaves colour fringes, edge aware stays grey
+static int Sim_Demosaic_Edge(void)
+{
+    static u8 raw[SIM_PIX_W * SIM_PIX_H], rgb[SIM_PIX_W * SIM_PIX_H * 3];
+    u8 cols[SIM_PIX_W][3];
+    PixImage src, dst;
+    u32 fringe[2] = { 0, 0 };
+
+    for(u32 x = 0; x < SIM_PIX_W; x++) memset(cols[x], x < SIM_PIX_W / 2 + 1 ? 40 : 220, 3);
+    Sim_Bayer_Columns(raw, (const u8 (*)[3])cols);
+    Pix_Image_Init(&src, raw, SIM_PIX_W, SIM_PIX_H, PIX_FMT_BAYER_BGGR);
+    Pix_Image_Init(&dst, rgb, SIM_PIX_W, SIM_PIX_H, PIX_FMT_RGB888);
+    for(int method = DEMOSAIC_BILINEAR; method <= DEMOSAIC_EDGE_AWARE; method++)
+    {
+        Demosaic_Init(&demosaic, (DemosaicMethod)method);
+        if(Demosaic_Frame(&demosaic, &src, &dst) != XST_SUCCESS) return 0;
+        for(u32 i = 0; i < sizeof(rgb); i += 3)
+            fringe[method] += (u32)abs(rgb[i] - rgb[i + 1]) + (u32)abs(rgb[i + 2] - rgb[i + 1]);
+    }
+    return fringe[DEMOSAIC_BILINEAR] > 0 && fringe[DEMOSAIC_EDGE_AWARE] == 0;
+}
+
+// Wrong formats, odd or mismatched geometry are refused and counted
+static int Sim_Demosaic_Errors(void)
+{
+    static u8 raw[SIM_PIX_W * SIM_PIX_H], rgb[SIM_PIX_W * SIM_PIX_H * 3];
+    PixImage src, dst;
+
+    Demosaic_Init(&demosaic, DEMOSAIC_BILINEAR);
+    Pix_Image_Init(&src, raw, SIM_PIX_W, SIM_PIX_H, PIX_FMT_GRAY8);
+    Pix_Image_Init(&dst, rgb, SIM_PIX_W, SIM_PIX_H, PIX_FMT_RGB888);
+    if(Demosaic_Frame(&demosaic, &src, &dst) != XST_INVALID_PARAM) return 0;
+    src.format = PIX_FMT_BAYER_BGGR;
+    dst.format = PIX_FMT_YUYV;
+    if(Demosaic_Frame(&demosaic, &src, &dst) != XST_INVALID_PARAM) return 0;
+    dst.format = PIX_FMT_RGB888;
+    src.width = dst.width = SIM_PIX_W - 1U;
+    if(Demosaic_Frame(&demosaic, &src, &dst) != XST_INVALID_PARAM) return 0;
+    src.width = SIM_PIX_W;
+    if(Demosaic_Frame(&demosaic, &src, &dst) != XST_INVALID_PARAM) return 0;
+    return demosaic.stats.errors == 4 && demosaic.stats.frames == 0;
+}
+
+// 2 x 2 tiles over four flat quadrants: each tile sees only its own colour
+static int Sim_Stats_Tiles(void)
+{
+    static const u8 colour[4][3] = { { 255, 10, 10 }, { 0, 0, 0 }, { 60, 120, 180 }, { 100, 100, 100 } };
+    static u8 rgb[64 * 32 * 3];
+    ImageStatsConfig cfg = { .tiles_x = 2, .tiles_y = 2, .line_step = 1, .sat_level = 250, .black_level = 8 };
+    PixImage img;
+
+    for(u32 y = 0; y < 32; y++)
+        for(u32 x = 0; x < 64; x++) memcpy(rgb + 3 * (y * 64 + x), colour[(y / 16) * 2 + x / 32], 3);
+    Pix_Image_Init(&img, rgb, 64, 32, PIX_FMT_RGB888);
+    if(Image_Stats_Init(&image_stats, &cfg) != XST_SUCCESS || Image_Stats_Frame(&image_stats, &img) != XST_SUCCESS) return 0;
+
+    for(u32 t = 0; t < 4; t++)
+    {
+        const ImageStatsTile *tile = Image_Stats_Tile(&image_stats, t % 2, t / 2);
+
+        if(tile->pixels != 32 * 16) return 0;
+        for(u32 ch = 0; ch < 3; ch++)
+            if(Image_Stats_Mean(tile, (ImageStatsChannel)ch) != colour[t][ch] ||
+               tile->hist[ch][colour[t][ch] >> IMAGE_STATS_BIN_SHIFT] != tile->pixels) return 0;
+        if(tile->saturated != (t == 0 ? tile->pixels : 0) || tile->black != (t == 1 ? tile->pixels : 0)) return 0;
+    }
+    // Quadrant lumas 84, 0, 109 and 100, a quarter of the frame is black
+    return image_stats.total.pixels == 64 * 32 && Image_Stats_Mean(&image_stats.total, IMAGE_STATS_Y) == (84 + 0 + 109 + 100 + 2) / 4 &&
+           Image_Stats_Percentile(&image_stats.total, IMAGE_STATS_Y, 25) == 7;
+}
+
+// Every 4th line of a raw Bayer frame, measured per quad; bad configs and I420 refused
+static int Sim_Stats_Bayer_Sampled(void)
+{
+    static u8 raw[SIM_PIX_W * 16];
+    ImageStatsConfig cfg = { .tiles_x = 3, .tiles_y = 2, .line_step = 4, .sat_level = 250, .black_level = 8 };
+    PixImage img;
+
+    for(u32 y = 0; y < 16; y++)
+        for(u32 x = 0; x < SIM_PIX_W; x++) raw[y * SIM_PIX_W + x] = (y & 1U) == 0 ? ((x & 1U) == 0 ? 30 : 90) : ((x & 1U) == 0 ? 94 : 200);
+    Pix_Image_Init(&img, raw, SIM_PIX_W, 16, PIX_FMT_BAYER_BGGR);
+    if(Image_Stats_Init(&image_stats, &cfg) != XST_SUCCESS || Image_Stats_Frame(&image_stats, &img) != XST_SUCCESS) return 0;
+    if(image_stats.total.pixels != (SIM_PIX_W / 2) * 2 || Image_Stats_Mean(&image_stats.total, IMAGE_STATS_R) != 200 ||
+       Image_Stats_Mean(&image_stats.total, IMAGE_STATS_G) != 92 || Image_Stats_Mean(&image_stats.total, IMAGE_STATS_B) != 30) return 0;
+
+    img.format = PIX_FMT_I420;
+    if(Image_Stats_Frame(&image_stats, &img) != XST_NO_FEATURE) return 0;
+    cfg.line_step = 0;
+    return Image_Stats_Init(&image_stats, &cfg) == XST_INVALID_PARAM;
+}
+
+// Flat scene luma the simulated sensor returns for its exposure and gain registers
+static u32 Sim_Scene_Luma(u32 scene)
+{
+    u32 exposure = ((u32)(sensor.regs[REG_AECHH] & 0x3FU) << 10) | ((u32)sensor.regs[REG_AECH] << 2) | (sensor.regs[REG_COM1] & 0x03U);
+    u32 gain = AUTO_EXPOSURE_GAIN_ONE + (sensor.regs[REG_GAIN] & 0x0FU);
+    u32 luma;
+
+    for(u32 bit = 0x10U; bit <= 0x80U; bit <<= 1)
+        if(sensor.regs[REG_GAIN] & bit) gain <<= 1;
+    luma = scene * exposure * gain / (AUTO_EXPOSURE_GAIN_ONE * 100U);
+    return luma > 255U ? 255U : luma;
+}
+
+// Run frames through statistics and the controller, the bus runs between frames. TRUE once settled
+// within frames, registers written no more often than the interval allows.
+static int Sim_Auto_Exposure_Run(u32 scene, u32 frames)
+{
+    static u8 gray[64 * 48];
+    PixImage img;
+    u32 writes = sensor.write_count[REG_AECH] + sensor.write_count[REG_GAIN], updates = auto_exposure.stats.updates;
+
+    Pix_Image_Init(&img, gray, 64, 48, PIX_FMT_GRAY8);
+    for(u32 f = 0; f < frames; f++)
+    {
+        memset(gray, (int)Sim_Scene_Luma(scene), sizeof(gray));
+        Image_Stats_Frame(&image_stats, &img);
+        Auto_Exposure_Update(&auto_exposure, &image_stats);
+        Sim_Advance(SIM_FRAME_NS);
+    }
+    writes = sensor.write_count[REG_AECH] + sensor.write_count[REG_GAIN] - writes;
+    return auto_exposure.settled && writes <= 2U * (auto_exposure.stats.updates - updates) &&
+           auto_exposure.stats.updates - updates <= frames / auto_exposure.cfg.interval;
+}
+
+// Dark scene brightened, then a 6x brighter scene pulled back, the sensor's AEC / AGC switched off
+static int Sim_Auto_Exposure(void)
+{
+    AutoExposureConfig cfg = { .target = 118, .hold_band = 6, .wake_band = 16, .damping = 160, .interval = 2,
+                               .max_exposure = 500, .band_rows = 76, .max_gain = 8U * AUTO_EXPOSURE_GAIN_ONE };
+    u32 settled_writes;
+
+    if(Image_Stats_Init(&image_stats, NULL) != XST_SUCCESS || Auto_Exposure_Init(&auto_exposure, &camera, &cfg) != XST_SUCCESS) return 0;
+    if(sensor.regs[REG_COM8] & (REG_COM8_AEC_EN | REG_COM8_AGC_EN)) return 0;
+
+    if(!Sim_Auto_Exposure_Run(10, 24) || auto_exposure.exposure % cfg.band_rows != 0) return 0;
+    if(!Sim_Auto_Exposure_Run(60, 24)) return 0;
+    if(Sim_Scene_Luma(60) < 118U - cfg.wake_band || Sim_Scene_Luma(60) > 118U + cfg.wake_band) return 0;
+
+    // Settled: no more bus traffic
+    settled_writes = sensor.reg_writes;
+    Sim_Auto_Exposure_Run(60, 10);
+    return sensor.reg_writes == settled_writes;
+}
+
+// A dark frame while the camera queue has room for only 3 writes: nothing of the update may be
+// queued and the model keeps its exposure, the next frame with room applies all of it
+static int Sim_Auto_Exposure_Queue_Full(void)
+{
+    static u8 gray[64 * 48];
+    static IicTxn fill[IIC_QUEUE_DEPTH];
+    u8 tx_buf[] = { REG_BLUE, sensor.regs[REG_BLUE] };
+    u32 exposure = auto_exposure.exposure, gain = auto_exposure.gain, deferred = auto_exposure.stats.deferred;
+    u32 writes = sensor.reg_writes;
+    PixImage img;
+    int ok;
+
+    Pix_Image_Init(&img, gray, 64, 48, PIX_FMT_GRAY8);
+    memset(gray, (int)Sim_Scene_Luma(10), sizeof(gray));
+    Image_Stats_Frame(&image_stats, &img);
+
+    for(u32 i = 0; Iic_Queue_Room(&ov7670_iic) >= AUTO_EXPOSURE_TXNS; i++)
+    {
+        if(Iic_Queue_Write(&ov7670_iic, &fill[i], tx_buf, 2, NULL, NULL) != XST_SUCCESS) return 0;
+    }
+    auto_exposure.wait = 0;
+    Auto_Exposure_Update(&auto_exposure, &image_stats);
+    ok = auto_exposure.stats.deferred == deferred + 1 && auto_exposure.exposure == exposure && auto_exposure.gain == gain;
+    for(u32 i = 0; i < AUTO_EXPOSURE_TXNS; i++) ok = ok && Iic_Txn_Poll(&auto_exposure.txn[i]) != XST_DEVICE_BUSY;
+
+    while(!Iic_Queue_Idle(&iic_ctrl)) Sim_Advance(SIM_FRAME_NS);
+    writes = sensor.reg_writes;
+    Auto_Exposure_Update(&auto_exposure, &image_stats);
+    while(!Iic_Queue_Idle(&iic_ctrl)) Sim_Advance(SIM_FRAME_NS);
+    return ok && auto_exposure.exposure * auto_exposure.gain > exposure * gain && sensor.reg_writes > writes;
+}
+
+// Frames of a flat coloured scene through the simulated red / blue gains, then balanced by the
+// controller. TRUE when the digitally corrected frame ends up grey within 3 %.
+static int Sim_White_Balance_Run(const u8 scene[3], u32 frames)
+{
+    static u8 rgb[64 * 48 * 3];
+    u32 gain[3] = { sensor.regs[REG_RED], 0x80U, sensor.regs[REG_BLUE] };
+    PixImage img;
+
+    Pix_Image_Init(&img, rgb, 64, 48, PIX_FMT_RGB888);
+    for(u32 f = 0; f < frames; f++)
+    {
+        gain[0] = sensor.regs[REG_RED];
+        gain[2] = sensor.regs[REG_BLUE];
+        for(u32 i = 0; i < sizeof(rgb); i++)
+        {
+            u32 v = (scene[i % 3] * gain[i % 3] + 64U) >> 7;
+            rgb[i] = (u8)(v > 255U ? 255U : v);
+        }
+        Image_Stats_Frame(&image_stats, &img);
+        Auto_White_Balance_Update(&auto_white_balance, &image_stats);
+        Auto_White_Balance_Apply(&auto_white_balance, &img);
+        Sim_Advance(SIM_FRAME_NS);
+    }
+    for(u32 ch = 0; ch < 3; ch += 2)
+        if((u32)abs(rgb[ch] - rgb[1]) * 100U > 3U * rgb[1]) return 0;
+    return 1;
+}
+
+// A mild cast is absorbed by the sensor gains alone, a strong one needs the digital fallback
+static int Sim_White_Balance(void)
+{
+    static const u8 warm[3] = { 150, 120, 90 }, green[3] = { 40, 160, 100 };
+    AutoWhiteBalanceConfig cfg = { .method = AUTO_WHITE_BALANCE_GRAY_WORLD, .damping = 160, .interval = 1, .percentile = 98,
+                                   .dark_level = 24, .hold_permille = 10 };
+
+    if(Image_Stats_Init(&image_stats, NULL) != XST_SUCCESS || Auto_White_Balance_Init(&auto_white_balance, &camera, &cfg) != XST_SUCCESS)
+        return 0;
+    if(sensor.regs[REG_COM8] & REG_COM8_AWB_EN) return 0;
+
+    if(!Sim_White_Balance_Run(warm, 20) || auto_white_balance.stats.digital_frames != 0) return 0;
+    if(!Sim_White_Balance_Run(green, 30) || auto_white_balance.stats.digital_frames == 0) return 0;
+    return sensor.regs[REG_RED] == 0xFF && auto_white_balance.digital[AUTO_WHITE_BALANCE_RED] > 64U;
+}
+
+// Unit tables leave the frame alone, new ones only take effect at the next frame. Saturation 0
+// turns a colour into gamma( luma ), white stays white through RGB565.
+static int Sim_Color_Pipeline(void)
+{
+    static u8 rgb[40 * 4 * 3];
+    static u16 rgb565[40 * 4];
+    u8 gamma[256];
+    s16 matrix[COLOR_PIPELINE_CHANNELS][COLOR_PIPELINE_CHANNELS];
+    PixImage img, img565;
+
+    for(u32 i = 0; i < sizeof(rgb); i++) rgb[i] = (u8)(60U * (i % 3 + 1));
+    for(u32 i = 0; i < 40 * 4; i++) rgb565[i] = 0xFFFFU;
+    Pix_Image_Init(&img, rgb, 40, 4, PIX_FMT_RGB888);
+    Pix_Image_Init(&img565, rgb565, 40, 4, PIX_FMT_RGB565);
+
+    if(Color_Pipeline_Init(&color_pipeline) != XST_SUCCESS || Color_Pipeline_Frame(&color_pipeline, &img) != XST_SUCCESS) return 0;
+    if(rgb[0] != 60 || rgb[1] != 120 || rgb[2] != 180 || color_pipeline.stats.skipped != 1) return 0;
+
+    Color_Pipeline_Gamma_Lut(gamma, COLOR_PIPELINE_GAMMA_SRGB);
+    Color_Pipeline_Saturation_Matrix(matrix, 0);
+    if(Color_Pipeline_Set_Matrix(&color_pipeline, matrix) != XST_SUCCESS ||
+       Color_Pipeline_Set_Lut(&color_pipeline, gamma, gamma, gamma) != XST_SUCCESS) return 0;
+    if(!color_pipeline.tables[color_pipeline.active].unit_matrix || !color_pipeline.pending) return 0;
+
+    // Luma of ( 60, 120, 180 ) is 109, gamma 2.2 puts 109 at 173
+    if(Color_Pipeline_Frame(&color_pipeline, &img) != XST_SUCCESS || color_pipeline.stats.swaps != 1) return 0;
+    for(u32 i = 0; i < sizeof(rgb); i++)
+        if(rgb[i] != gamma[109] || gamma[109] != 173) return 0;
+
+    Color_Pipeline_Saturation_Matrix(matrix, 2U * COLOR_PIPELINE_ONE);
+    Color_Pipeline_Set_Matrix(&color_pipeline, matrix);
+    if(Color_Pipeline_Frame(&color_pipeline, &img565) != XST_SUCCESS) return 0;
+    for(u32 i = 0; i < 40 * 4; i++)
+        if(rgb565[i] != 0xFFFFU) return 0;
+
+    matrix[0][0] = COLOR_PIPELINE_COEFF_MAX + 1;
+    img.format = PIX_FMT_GRAY8;
+    return Color_Pipeline_Set_Matrix(&color_pipeline, matrix) == XST_INVALID_PARAM &&
+           Color_Pipeline_Frame(&color_pipeline, &img) == XST_NO_FEATURE;
+}
+
+// One 160 x 120 RGB565 frame of a noisy gradient, with white 16 x 16 squares at the given corners
+static void Sim_Motion_Scene(u16 *pixels, const u16 squares[][2], u32 count)
+{
+    for(u32 y = 0; y < 120; y++)
+    {
+        for(u32 x = 0; x < 160; x++)
+        {
+            u32 v = 40U + (x + y) % 64U + (u32)(rand() % 5);
+
+            for(u32 i = 0; i < count; i++)
+                if(x - squares[i][0] < 16U && y - squares[i][1] < 16U) v = 255U;
+            pixels[y * 160 + x] = (u16)(((v >> 3) << 11) | ((v >> 2) << 5) | (v >> 3));
+        }
+    }
+}
+
+// Sensor noise stays quiet once the hold runs out, two squares appearing give one box each, and
+// squares that stop moving fade into the reference
+static int Sim_Motion(void)
+{
+    static u16 rgb565[160 * 120];
+    static const u16 squares[2][2] = { { 40, 40 }, { 120, 88 } };
+    PixImage img;
+
+    Pix_Image_Init(&img, rgb565, 160, 120, PIX_FMT_RGB565);
+    if(Motion_Detect_Init(&motion_detect, NULL) != XST_SUCCESS) return 0;
+
+    Sim_Motion_Scene(rgb565, squares, 0);
+    if(Motion_Detect_Frame(&motion_detect, &img) != XST_SUCCESS || !motion_detect.motion) return 0;
+    for(u32 f = 0; f < 5; f++)
+    {
+        Sim_Motion_Scene(rgb565, squares, 0);
+        Motion_Detect_Frame(&motion_detect, &img);
+    }
+    if(motion_detect.motion || motion_detect.active != 0 || motion_detect.blocks_x != 20 || motion_detect.blocks_y != 15) return 0;
+
+    Sim_Motion_Scene(rgb565, squares, 2);
+    if(Motion_Detect_Frame(&motion_detect, &img) != XST_SUCCESS || !motion_detect.motion || motion_detect.box_count != 2) return 0;
+    for(u32 i = 0; i < 2; i++)
+    {
+        const MotionDetectBox *box = &motion_detect.boxes[i];
+
+        if(box->x != squares[i][0] || box->y != squares[i][1] || box->width != 16 || box->height != 16 || box->blocks != 4) return 0;
+    }
+    if(!Motion_Detect_Block(&motion_detect, 5, 5) || Motion_Detect_Block(&motion_detect, 10, 5)) return 0;
+
+    for(u32 f = 0; f < 15; f++)
+    {
+        Sim_Motion_Scene(rgb565, squares, 2);
+        Motion_Detect_Frame(&motion_detect, &img);
+    }
+    img.width = 4;
+    return !motion_detect.motion && motion_detect.box_count == 0 && Motion_Detect_Frame(&motion_detect, &img) == XST_INVALID_PARAM;
+}
+
+int main(int argc, char **argv)
+{
+    Sim_BusTiming timing;
+    int status;
+    u8 value;
+
+    Sim_Reset();
+    if(argc > 1)
+    {
+        u32 khz = (u32)strtoul(argv[1], NULL, 0);
+        if(khz == 0) return EXIT_FAILURE;
+        Sim_GetTiming(&timing);
+        timing.byte_ns = 9000000U / khz; // 8 data bits + ACK
+        Sim_SetTiming(&timing);
+    }
+    Sim_GetTiming(&timing);
+    xil_printf("[INFO] OV7670 host simulation, %u ns per SCCB byte\n", timing.byte_ns);
+
+    Sim_OV7670_Init(&sensor, OV7670_IIC_ADDR);
+
+    // ------------------------------- Same bring-up as main.c ------------------------------------------
+    XGpio_Initialize(&camera_gpio, SIM_GPIO_BA);
+    XScuGic_CfgInitialize(&intr_ctl, XScuGic_LookupConfig(SIM_GIC_BA), SIM_GIC_BA);
+
+    status = Iic_Helper_Init(&iic_ctrl, SIM_IIC_BA, &intr_ctl, SIM_IIC_INTERRUPT_ID);
+    Sim_Check(status == XST_SUCCESS, "Iic_Helper_Init");
+    status = Iic_Device_Init(&ov7670_iic, &iic_ctrl, OV7670_IIC_ADDR);
+    Sim_Check(status == XST_SUCCESS, "Iic_Device_Init, camera");
+    status = Iic_Device_Init(&absent_iic, &iic_ctrl, SIM_ABSENT_ADDR);
+    Sim_Check(status == XST_SUCCESS, "Iic_Device_Init, absent device");
+
+    status = OV7670_Init(&camera, &ov7670_iic, &camera_gpio);
+    Sim_Check(status == XST_SUCCESS, "OV7670_Init");
+
+    status = OV7670_Reg_ReadWrite_Test(&camera);
+    Sim_Check(status == XST_SUCCESS, "OV7670_Reg_ReadWrite_Test");
+
+    status = OV7670_Basic_Setup(&camera);
+    Sim_Check(status == XST_SUCCESS, "OV7670_Basic_Setup");
+    Sim_Check(sensor.regs[REG_COM7] == REG_COM7_RGB_MODE && sensor.regs[REG_COM15] == (REG_COM15_FULL_RANGE | REG_COM15_RGB565) &&
+              sensor.regs[REG_CLKRC] == REG_CLKRC_CLK_DIV_2, "Basic setup reached the sensor");
+    Sim_Check(camera.boot.total_us <= OV7670_BOOT_BUDGET_US, "Bring-up within OV7670_BOOT_BUDGET_US");
+    // The reset pulse is one usleep, the global timer must give it back in real microseconds
+    Sim_Check(camera.boot.power_us >= OV7670_RESET_PULSE_US && camera.boot.power_us < OV7670_RESET_PULSE_US + 50,
+              "Reset pulse measured at its length in us");
+    OV7670_Print_Startup_Report(&camera);
+
+    // ------------------------------- Profiles, full then delta ----------------------------------------
+    u32 full_writes, delta_writes;
+    int delta_count;
+
+    OV7670_Profiles_Init();
+    Sim_Check(Sim_Profile_Switch(OV7670_RES_VGA, OV7670_FMT_RGB565, &full_writes), "VGA RGB565 profile");
+    Sim_Check(Sim_Profile_Switch(OV7670_RES_QVGA, OV7670_FMT_RGB565, &delta_writes), "QVGA RGB565 profile");
+    OV7670_Profile_Transition(OV7670_PROFILE_ID(OV7670_RES_VGA, OV7670_FMT_RGB565),
+                              OV7670_PROFILE_ID(OV7670_RES_QVGA, OV7670_FMT_RGB565), &delta_count);
+    Sim_Check(delta_writes == (u32)delta_count, "Profile switch writes only the transition delta");
+    OV7670_FrameInfo bad_info = OV7670_Profile_FrameInfo(OV7670_RES_COUNT, OV7670_FMT_RGB565);
+    Sim_Check(OV7670_SetProfile(&camera, OV7670_RES_COUNT, OV7670_FMT_RGB565) == XST_INVALID_PARAM &&
+              bad_info.width == 0 && bad_info.height == 0 && bad_info.bytes_per_pixel == 0 &&
+              OV7670_Profile_FrameInfo(OV7670_RES_VGA, OV7670_FMT_COUNT).width == 0, "Unknown profiles are refused");
+
+    // ------------------------------- Fault injection --------------------------------------------------
+    Sim_InjectNack(1);
+    status = OV7670_WriteReg(&camera, REG_BLUE, 0x55);
+    Sim_Check(status != XST_SUCCESS, "Injected NACK fails the write");
+    status = OV7670_WriteReg(&camera, REG_BLUE, 0x55);
+    Sim_Check(status == XST_SUCCESS && sensor.regs[REG_BLUE] == 0x55, "Write after NACK recovers");
+
+    IicStats stats;
+    Iic_Stats_Snapshot(&iic_ctrl, &stats);
+    u32 busy_before = stats.bus_busy_waits;
+    Sim_InjectBusBusy(500000);
+    status = OV7670_ReadReg_Uncached(&camera, REG_BLUE, &value);
+    Iic_Stats_Snapshot(&iic_ctrl, &stats);
+    Sim_Check(status == XST_SUCCESS && value == 0x55 && stats.bus_busy_waits > busy_before, "Read waits out another bus master");
+
+    status = Iic_Read(&absent_iic, 0x00, &value, 1);
+    Sim_Check(status != XST_SUCCESS, "Absent device NACKs");
+
+    Sim_InjectDynInitFail(1);
+    status = Iic_Read_Combined(&ov7670_iic, REG_BLUE, &value, 1);
+    Sim_Check(status != XST_SUCCESS, "Failed dynamic init fails the combined read");
+    status = OV7670_ReadReg_Uncached(&camera, REG_BLUE, &value);
+    Sim_Check(status == XST_SUCCESS && value == 0x55, "Queued reads still complete after a failed dynamic init");
+
+    status = OV7670_WriteReg(&camera, REG_PID, 0x00);
+    status |= OV7670_ReadReg_Uncached(&camera, REG_PID, &value);
+    Sim_Check(status == XST_SUCCESS && value == OV7670_PID_VALUE, "PID is read only");
+
+    // ------------------------------- Software reset ---------------------------------------------------
+    u32 resets = sensor.resets;
+    status = OV7670_Reset(&camera);
+    Sim_Check(status == XST_SUCCESS && sensor.resets == resets + 1, "COM7 software reset");
+    Sim_Check(sensor.regs[REG_COM7] == 0x00 && sensor.regs[REG_BLUE] == Sim_OV7670_Default(REG_BLUE), "Reset restores defaults");
+
+    // Same PID, another version: never taken for the OV7670
+    sensor.version = 0x70;
+    status = OV7670_Reset(&camera);
+    Sim_Check(status == XST_TIMEOUT, "Wrong REG_VER keeps the sensor from being ready");
+    sensor.version = Sim_OV7670_Default(REG_VER);
+    status = OV7670_Reset(&camera);
+    Sim_Check(status == XST_SUCCESS, "Sensor ready again with the right REG_VER");
+
+    // ------------------------------- Frame pool -------------------------------------------------------
+    OV7670_FrameInfo info = OV7670_Profile_FrameInfo(OV7670_RES_VGA, OV7670_FMT_RGB565);
+    FrameBuf *bufs[SIM_FRAME_BLOCKS];
+    FramePoolStats pool_stats;
+    int aligned = 1;
+
+    status = Frame_Mem_Init(frame_mem + 1, SIM_FRAME_MEM_SIZE);
+    status |= FramePool_Create(&frame_pool, "vga", Frame_BlockSize(info.width, info.height, info.bytes_per_pixel), SIM_FRAME_BLOCKS);
+    Sim_Check(status == XST_SUCCESS, "Frame pool created");
+    Sim_Check(FramePool_Create(&frame_pool, "too big", SIM_FRAME_MEM_SIZE, 1) != XST_SUCCESS, "Region overcommit refused");
+
+    for(u32 i = 0; i < SIM_FRAME_BLOCKS; i++)
+    {
+        bufs[i] = FramePool_Alloc(&frame_pool);
+        if(bufs[i] == NULL || ((UINTPTR)bufs[i]->data & (FRAME_ALIGN - 1)) != 0) aligned = 0;
+    }
+    Sim_Check(aligned, "Blocks are cache line aligned");
+    Sim_Check(FramePool_Alloc(&frame_pool) == NULL, "Empty pool fails the alloc");
+
+    FrameBuf_Retain(bufs[1]);
+    FrameBuf_Release(bufs[1]);
+    FrameBuf_Release(bufs[0]);
+    FrameBuf *again = FramePool_Alloc(&frame_pool);
+    Sim_Check(again == bufs[0], "Retained block stays out, released block comes back");
+
+    FrameBuf_Release(again);
+    FrameBuf_Release(bufs[1]);
+    FrameBuf_Release(bufs[2]);
+    FramePool_GetStats(&frame_pool, &pool_stats);
+    Sim_Check(pool_stats.in_use == 0 && pool_stats.high_water == SIM_FRAME_BLOCKS && pool_stats.failures == 1, "Pool statistics");
+    FramePool_Print_Stats(&frame_pool);
+
+    // ------------------------------- Frame ring -------------------------------------------------------
+    FrameRingStats ring_stats;
+    FrameBuf *frame;
+    u32 in_order = 1, seq = 0;
+
+    FrameRing_Init(&frame_ring);
+
+    // More frames than slots, the pool recycles what the ring drops
+    for(u32 i = 0; i < FRAME_RING_SLOTS + 2; i++)
+    {
+        while((frame = FramePool_Alloc(&frame_pool)) == NULL)
+        {
+            FrameBuf_Release(FrameRing_Consume(&frame_ring));
+        }
+        frame->sequence = seq++;
+        FrameRing_Publish(&frame_ring, frame);
+    }
+    while((frame = FrameRing_Consume(&frame_ring)) != NULL)
+    {
+        if(frame->sequence != seq - FrameRing_Count(&frame_ring) - 1) in_order = 0;
+        FrameBuf_Release(frame);
+    }
+    Sim_Check(in_order, "Ring hands frames out in order");
+
+    // Fill past capacity without a consumer, then live view takes only the newest
+    for(u32 i = 0; i < SIM_FRAME_BLOCKS; i++)
+    {
+        frame = FramePool_Alloc(&frame_pool);
+        frame->sequence = seq++;
+        FrameRing_Publish(&frame_ring, frame);
+    }
+    frame = FrameRing_ConsumeLatest(&frame_ring);
+    Sim_Check(frame != NULL && frame->sequence == seq - 1 && FrameRing_Count(&frame_ring) == 0, "Live view gets the newest frame");
+    FrameBuf_Release(frame);
+
+    // Same block published over and over, one reference per slot
+    frame = FramePool_Alloc(&frame_pool);
+    for(u32 i = 0; i < FRAME_RING_SLOTS + 1; i++)
+    {
+        FrameBuf_Retain(frame);
+        FrameRing_Publish(&frame_ring, frame);
+    }
+    FrameBuf_Release(frame);
+    FrameRing_GetStats(&frame_ring, &ring_stats);
+    Sim_Check(ring_stats.dropped == 1 && FrameRing_Count(&frame_ring) == FRAME_RING_SLOTS, "Full ring reclaims its oldest frame instead of blocking");
+    while((frame = FrameRing_ConsumeLatest(&frame_ring)) != NULL) FrameBuf_Release(frame);
+    FramePool_GetStats(&frame_pool, &pool_stats);
+    Sim_Check(pool_stats.in_use == 0, "Every dropped and skipped frame went back to the pool");
+    FrameRing_Print_Stats(&frame_ring);
+
+    // ------------------------------- BSP memory copy / fill -------------------------------------------
+    Sim_Check(Sim_Mem_Check(0), "Xil_MemCpy matches memcpy for every alignment and size");
+    Sim_Check(Sim_Mem_Check(1), "Xil_MemSet matches memset for every alignment and size");
+
+    // ------------------------------- Pixel conversion -------------------------------------------------
+    Sim_Check(Sim_Pix_Rgb565_RoundTrip(), "RGB565 -> RGB888 -> RGB565 is lossless");
+    Sim_Check(Sim_Pix_Rgb555(), "RGB555 -> RGB565 keeps every channel");
+    Sim_Check(Sim_Pix_Yuyv_Frame(), "YUYV frame to RGB888, I420 and gray");
+    Sim_Check(Sim_Pix_Bayer_And_Errors(), "Bayer to gray, unsupported and odd sized conversions refused");
+
+    // ------------------------------- Resize -----------------------------------------------------------
+    Resize_Init(&resize);
+    Sim_Check(Sim_Resize_Identity(), "1:1 bilinear resize is an exact copy");
+    Sim_Check(Sim_Resize_Box(), "Box 2x / 4x average their blocks");
+    Sim_Check(Sim_Resize_Crop(), "Crop and scale in one pass, bad windows refused");
+    Resize_Print_Stats(&resize);
+
+    // ------------------------------- Demosaic ---------------------------------------------------------
+    Sim_Check(Sim_Demosaic_Flat(), "Flat colour demosaics exactly, bilinear and edge aware");
+    Sim_Check(Sim_Demosaic_Edge(), "Edge aware demosaic leaves no colour fringe on a vertical edge");
+    Sim_Check(Sim_Demosaic_Errors(), "Demosaic refuses wrong formats and odd geometry");
+    Demosaic_Print_Stats(&demosaic);
+
+    // ------------------------------- Image statistics -------------------------------------------------
+    Sim_Check(Sim_Stats_Tiles(), "Tile histograms, means, saturated and black counts");
+    Sim_Check(Sim_Stats_Bayer_Sampled(), "Bayer quads on every 4th line, I420 and bad configs refused");
+    Image_Stats_Print(&image_stats);
+
+    // ------------------------------- Auto exposure ----------------------------------------------------
+    Sim_Check(Sim_Auto_Exposure(), "Auto exposure settles both ways, rate limited, quiet once settled");
+    Sim_Check(Sim_Auto_Exposure_Queue_Full(), "Auto exposure defers a whole update when the IIC queue is short");
+    Auto_Exposure_Print_Stats(&auto_exposure);
+
+    // ------------------------------- Auto white balance -----------------------------------------------
+    Sim_Check(Sim_White_Balance(), "White balance on sensor gains, digital gain once they saturate");
+    Auto_White_Balance_Print_Stats(&auto_white_balance);
+
+    // ------------------------------- Color pipeline ---------------------------------------------------
+    Sim_Check(Sim_Color_Pipeline(), "Gamma LUT and colour matrix in one pass, tables swapped between frames");
+    Color_Pipeline_Print_Stats(&color_pipeline);
+
+    // ------------------------------- Motion detection -------------------------------------------------
+    Sim_Check(Sim_Motion(), "Motion blocks with hysteresis, one box per moving object, quiet once static");
+    Motion_Detect_Print_Stats(&motion_detect);
+
+    // ------------------------------- Bus numbers ------------------------------------------------------
+    Iic_Read_Benchmark(&ov7670_iic, REG_PID, 64);
+    Iic_Stats_Print(&iic_ctrl);
+
+    Sim_BusStats bus;
+    Sim_GetBusStats(&bus);
+    xil_printf("[INFO] Simulated bus: %u transfers, %u NACKs, %u bytes, %u interrupts, %u us busy, %u us elapsed\n",
+               bus.transfers, bus.nacks, bus.bytes, bus.interrupts, (u32)(bus.busy_ns / 1000ULL), (u32)(Sim_Now() / 1000ULL));
+
+    xil_printf("[INFO] %d check(s) failed\n", failures);
+    return failures;
+}
@@ -0,0 +1,128 @@
+#include <string.h>
+
+#include "sim_ov7670.h"
+
+// Registers the sensor ignores writes to
+#define REG_BAVE   0x05
+#define REG_GbAVE  0x06
+#define REG_RAVE   0x08
+#define REG_PID    0x0A
+#define REG_VER    0x0B
+#define REG_COM7   0x12
+#define REG_MIDH   0x1C
+#define REG_MIDL   0x1D
+
+#define COM7_RESET 0x80
+
+// Datasheet power on values, anything not listed reads 0x00
+static const u8 sim_ov7670_defaults[][2] = {
+    {0x01, 0x80}, {0x02, 0x80}, {0x09, 0x01}, {0x0A, 0x76}, {0x0B, 0x73}, {0x0E, 0x01}, {0x0F, 0x43},
+    {0x10, 0x40}, {0x11, 0x80}, {0x13, 0x8F}, {0x14, 0x4A}, {0x17, 0x11}, {0x18, 0x61}, {0x19, 0x03},
+    {0x1A, 0x7B}, {0x1C, 0x7F}, {0x1D, 0xA2}, {0x1E, 0x01}, {0x20, 0x04}, {0x21, 0x02}, {0x22, 0x01},
+    {0x24, 0x75}, {0x25, 0x63}, {0x26, 0xD4}, {0x32, 0x80}, {0x3A, 0x0D}, {0x3C, 0x68}, {0x3D, 0x88},
+    {0x40, 0xC0}, {0x41, 0x10}, {0x42, 0x08}, {0x4F, 0x40}, {0x50, 0x34}, {0x51, 0x0C}, {0x52, 0x17},
+    {0x53, 0x29}, {0x54, 0x40}, {0x58, 0x1E}, {0x70, 0x4A}, {0x71, 0x35}, {0x72, 0x11}, {0xA2, 0x02},
+};
+
+u8 Sim_OV7670_Default(u8 reg)
+{
+    for(unsigned i = 0; i < sizeof(sim_ov7670_defaults) / sizeof(sim_ov7670_defaults[0]); i++)
+    {
+        if(sim_ov7670_defaults[i][0] == reg) return sim_ov7670_defaults[i][1];
+    }
+    return 0x00;
+}
+
+static int Sim_OV7670_ReadOnly(u8 reg)
+{
+    return reg == REG_PID || reg == REG_VER || reg == REG_MIDH || reg == REG_MIDL ||
+           reg == REG_BAVE || reg == REG_GbAVE || reg == REG_RAVE;
+}
+
+// Back to power on values, busy for busy_us
+static void Sim_OV7670_Restart(Sim_OV7670 *cam, u32 busy_us)
+{
+    memset(cam->regs, 0, sizeof(cam->regs));
+    for(int reg = 0; reg < 256; reg++) cam->regs[reg] = Sim_OV7670_Default((u8)reg);
+    cam->regs[REG_VER] = cam->version;
+    cam->sub_addr = 0;
+    cam->ready_ns = Sim_Now() + (u64)busy_us * 1000ULL;
+    cam->resets++;
+}
+
+static int Sim_OV7670_Ack(void *ref)
+{
+    Sim_OV7670 *cam = (Sim_OV7670 *)ref;
+    return cam->powered && Sim_Now() >= cam->ready_ns;
+}
+
+// First byte is the register address, the rest are written from there with auto increment
+static void Sim_OV7670_Write(void *ref, const u8 *data, int n)
+{
+    Sim_OV7670 *cam = (Sim_OV7670 *)ref;
+
+    if(n <= 0) return;
+    cam->sub_addr = data[0];
+
+    for(int i = 1; i < n; i++)
+    {
+        u8 reg = cam->sub_addr++;
+        cam->reg_writes++;
+        cam->write_count[reg]++;
+
+        if(Sim_OV7670_ReadOnly(reg)) continue;
+
+        if(reg == REG_COM7 && (data[i] & COM7_RESET))
+        {
+            // Self clearing, takes the whole register file with it
+            Sim_OV7670_Restart(cam, cam->reset_us);
+            return;
+        }
+        cam->regs[reg] = data[i];
+    }
+}
+
+static void Sim_OV7670_Read(void *ref, u8 *data, int n)
+{
+    Sim_OV7670 *cam = (Sim_OV7670 *)ref;
+
+    for(int i = 0; i < n; i++)
+    {
+        data[i] = cam->regs[cam->sub_addr++];
+        cam->reg_reads++;
+    }
+}
+
+// GPIO channel 1, bit 1 RESET ( active low ), bit 0 PWDN ( active high )
+static void Sim_OV7670_Pins(void *ref, u32 gpio_out)
+{
+    Sim_OV7670 *cam = (Sim_OV7670 *)ref;
+    int powered = ((gpio_out & 0x2) != 0) && ((gpio_out & 0x1) == 0);
+
+    if(powered && !cam->powered) Sim_OV7670_Restart(cam, cam->boot_us);
+    cam->powered = powered;
+}
+
+void Sim_OV7670_ClearCounts(Sim_OV7670 *cam)
+{
+    cam->reg_writes = 0;
+    cam->reg_reads = 0;
+    memset(cam->write_count, 0, sizeof(cam->write_count));
+}
+
+void Sim_OV7670_Init(Sim_OV7670 *cam, u8 addr)
+{
+    memset(cam, 0, sizeof(*cam));
+    cam->boot_us = SIM_OV7670_BOOT_US;
+    cam->reset_us = SIM_OV7670_RESET_US;
+    cam->version = Sim_OV7670_Default(REG_VER);
+    for(int reg = 0; reg < 256; reg++) cam->regs[reg] = Sim_OV7670_Default((u8)reg);
+
+    cam->slave.addr = addr;
+    cam->slave.ack = Sim_OV7670_Ack;
+    cam->slave.write = Sim_OV7670_Write;
+    cam->slave.read = Sim_OV7670_Read;
+    cam->slave.pins = Sim_OV7670_Pins;
+    cam->slave.ref = cam;
+    Sim_AttachSlave(&cam->slave);
+}
@@ -0,0 +1,35 @@
+#ifndef __SIM_OV7670_H__
+#define __SIM_OV7670_H__
+
+#include "sim.h"
+
+#define SIM_OV7670_BOOT_US  1000 // RESET released -> first SCCB ACK
+#define SIM_OV7670_RESET_US 1000 // COM7 software reset -> first SCCB ACK
+
+// OV7670 SCCB register file
+typedef struct {
+    Sim_Slave slave;
+    u8 regs[256];
+    u8 sub_addr;            // Register pointer, set by a one byte write
+    int powered;            // RESET high and PWDN low
+    u64 ready_ns;           // NACKs every address phase until then
+    u32 boot_us;
+    u32 reset_us;
+    u8  version;            // REG_VER after power on and reset, another part when not 0x73
+
+    // What the driver did to the sensor
+    u32 reg_writes;
+    u32 reg_reads;
+    u32 resets;             // Hardware and COM7 software resets
+    u32 write_count[256];   // Writes per register since the last Sim_OV7670_ClearCounts
+} Sim_OV7670;
+
+// Attach a sensor at a 7 bit address, it powers up through GPIO channel 1 like the board
+void Sim_OV7670_Init(Sim_OV7670 *cam, u8 addr);
+
+// Power on register values, what a COM7 reset restores
+u8 Sim_OV7670_Default(u8 reg);
+
+void Sim_OV7670_ClearCounts(Sim_OV7670 *cam);
+
+#endif
@@ -0,0 +1,405 @@
+#include <string.h>
+
+#include "sim.h"
+#include "xiic.h"
+
+/*
+    AXI IIC controller model. One transfer is on the bus at a time, it takes
+    START + address + data + STOP byte times and raises the IIC interrupt when done.
+    Slave side effects ( register writes, read data ) land at completion.
+*/
+
+#define SIM_SR_BUS_BUSY 0x04 // XIIC_SR_BUS_BUSY_MASK
+
+static const Sim_BusTiming sim_default_timing = {
+    .byte_ns       = 90000,  // 8 data bits + ACK at 100 kHz
+    .start_stop_ns = 5000,
+    .irq_ns        = 1000,
+    .poll_ns       = 100,
+};
+
+// Transfer currently on the bus
+typedef struct {
+    int active;
+    int is_recv;
+    int nacked;
+    Sim_Slave *slave;
+    u8 *buf;
+    int count;
+    u64 done_ns;
+} Sim_Transfer;
+
+static Sim_BusTiming sim_timing;
+static Sim_BusStats sim_stats;
+static Sim_Slave *sim_slaves;
+static Sim_Transfer sim_xfer;
+static XIic *sim_iic;
+static XIic_Config sim_iic_cfg;
+static void *sim_gic;
+static u32 sim_irq_id;
+static int sim_in_service;
+static int sim_nack_inject;
+static u64 sim_busy_until_ns;   // Another master owns the bus until then
+static int sim_bnb_armed;       // Raise bus-not-busy once the other master lets go
+static int sim_intr_global;
+static int sim_dyn_init_fail;  // XIic_DynInit calls still to fail
+
+void Sim_Reset(void)
+{
+    Sim_Bsp_Reset();
+
+    sim_timing = sim_default_timing;
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    memset(&sim_xfer, 0, sizeof(sim_xfer));
+    sim_slaves = NULL;
+    sim_iic = NULL;
+    sim_gic = NULL;
+    sim_irq_id = 0;
+    sim_in_service = 0;
+    sim_nack_inject = 0;
+    sim_busy_until_ns = 0;
+    sim_bnb_armed = 0;
+    sim_intr_global = 1;
+    sim_dyn_init_fail = 0;
+}
+
+void Sim_SetTiming(const Sim_BusTiming *timing)
+{
+    sim_timing = *timing;
+}
+
+void Sim_GetTiming(Sim_BusTiming *timing)
+{
+    *timing = sim_timing;
+}
+
+void Sim_InjectNack(int count)
+{
+    sim_nack_inject += count;
+}
+
+void Sim_InjectDynInitFail(int count)
+{
+    sim_dyn_init_fail += count;
+}
+
+void Sim_InjectBusBusy(u32 ns)
+{
+    sim_busy_until_ns = Sim_Now() + ns;
+}
+
+void Sim_AttachSlave(Sim_Slave *slave)
+{
+    slave->next = sim_slaves;
+    sim_slaves = slave;
+}
+
+void Sim_GetBusStats(Sim_BusStats *stats)
+{
+    *stats = sim_stats;
+}
+
+void Sim_Iic_Connect(void *gic, u32 int_id, void *handler, void *ref)
+{
+    if(handler != (void *)XIic_InterruptHandler || ref != sim_iic) return;
+    sim_gic = gic;
+    sim_irq_id = int_id;
+}
+
+void Sim_Gpio_Write(u32 value)
+{
+    for(Sim_Slave *s = sim_slaves; s != NULL; s = s->next)
+    {
+        if(s->pins != NULL) s->pins(s->ref, value);
+    }
+}
+
+// Address phase, returns the addressed slave and whether the phase was NACKed
+static Sim_Slave *Sim_Address(u8 addr, int *nacked)
+{
+    Sim_Slave *slave = NULL;
+
+    sim_stats.transfers++;
+
+    for(Sim_Slave *s = sim_slaves; s != NULL; s = s->next)
+    {
+        if(s->addr == addr) slave = s;
+    }
+
+    *nacked = (slave == NULL) || (slave->ack != NULL && !slave->ack(slave->ref));
+    if(sim_nack_inject > 0)
+    {
+        sim_nack_inject--;
+        *nacked = 1;
+    }
+    if(*nacked) sim_stats.nacks++;
+
+    return slave;
+}
+
+static void Sim_Transfer_Effect(Sim_Slave *slave, int is_recv, u8 *buf, int count)
+{
+    sim_stats.bytes += count;
+
+    if(is_recv)
+    {
+        if(slave->read != NULL) slave->read(slave->ref, buf, count);
+        else memset(buf, 0xFF, count);
+    }
+    else if(slave->write != NULL)
+    {
+        slave->write(slave->ref, buf, count);
+    }
+}
+
+// Deliver the IIC interrupt for whatever finished, runs whenever time moves
+void Sim_Iic_Service(void)
+{
+    if(sim_in_service || sim_iic == NULL) return;
+    if(!sim_intr_global || !Sim_IrqDeliverable(sim_gic, sim_irq_id)) return;
+
+    sim_in_service = 1;
+
+    if(sim_xfer.active && Sim_Now() >= sim_xfer.done_ns + sim_timing.irq_ns)
+    {
+        Sim_Transfer xfer = sim_xfer;
+        sim_xfer.active = 0;
+        sim_stats.interrupts++;
+        sim_iic->Stats.IicInterrupts++;
+
+        if(xfer.nacked)
+        {
+            sim_iic->Stats.TxErrors++;
+            if(sim_iic->StatusHandler != NULL) sim_iic->StatusHandler(sim_iic->StatusCallBackRef, XII_SLAVE_NO_ACK_EVENT);
+        }
+        else if(xfer.is_recv)
+        {
+            Sim_Transfer_Effect(xfer.slave, 1, xfer.buf, xfer.count);
+            sim_iic->Stats.RecvBytes += xfer.count;
+            sim_iic->Stats.RecvInterrupts++;
+            if(sim_iic->RecvHandler != NULL) sim_iic->RecvHandler(sim_iic->RecvCallBackRef, 0);
+        }
+        else
+        {
+            Sim_Transfer_Effect(xfer.slave, 0, xfer.buf, xfer.count);
+            sim_iic->Stats.SendBytes += xfer.count;
+            sim_iic->Stats.SendInterrupts++;
+            if(sim_iic->SendHandler != NULL) sim_iic->SendHandler(sim_iic->SendCallBackRef, 0);
+        }
+    }
+
+    if(sim_bnb_armed && !sim_xfer.active && Sim_Now() >= sim_busy_until_ns)
+    {
+        sim_bnb_armed = 0;
+        sim_stats.interrupts++;
+        sim_iic->Stats.IicInterrupts++;
+        if(sim_iic->StatusHandler != NULL) sim_iic->StatusHandler(sim_iic->StatusCallBackRef, XII_BUS_NOT_BUSY_EVENT);
+    }
+
+    sim_in_service = 0;
+}
+
+// ------------------------------------------ Interrupt Driven API ----------------------------------
+
+XIic_Config *XIic_LookupConfig(UINTPTR BaseAddress)
+{
+    sim_iic_cfg.BaseAddress = BaseAddress;
+    sim_iic_cfg.Has10BitAddr = 0;
+    return &sim_iic_cfg;
+}
+
+int XIic_CfgInitialize(XIic *InstancePtr, XIic_Config *Config, UINTPTR EffectiveAddr)
+{
+    (void)Config;
+    memset(InstancePtr, 0, sizeof(*InstancePtr));
+    InstancePtr->BaseAddress = EffectiveAddr;
+    InstancePtr->IsReady = XIL_COMPONENT_IS_READY;
+    sim_iic = InstancePtr;
+    return XST_SUCCESS;
+}
+
+int XIic_Start(XIic *InstancePtr)
+{
+    InstancePtr->IsStarted = XIL_COMPONENT_IS_STARTED;
+    sim_intr_global = 1;
+    return XST_SUCCESS;
+}
+
+int XIic_Stop(XIic *InstancePtr)
+{
+    if(sim_xfer.active) return XST_IIC_BUS_BUSY;
+    InstancePtr->IsStarted = 0;
+    return XST_SUCCESS;
+}
+
+void XIic_Reset(XIic *InstancePtr)
+{
+    (void)InstancePtr;
+    sim_xfer.active = 0;
+    sim_bnb_armed = 0;
+}
+
+int XIic_SetAddress(XIic *InstancePtr, int AddressType, int Address)
+{
+    if(AddressType == XII_ADDR_TO_SEND_TYPE)
+    {
+        InstancePtr->AddrOfSlave = Address;
+        return XST_SUCCESS;
+    }
+    return (AddressType == XII_ADDR_TO_RESPOND_TYPE) ? XST_SUCCESS : XST_INVALID_PARAM;
+}
+
+static int Sim_Master_Transfer(XIic *InstancePtr, u8 *buf, int count, int is_recv)
+{
+    if(InstancePtr->IsStarted != XIL_COMPONENT_IS_STARTED) return XST_FAILURE;
+
+    // Bus owned by us or someone else, the driver arms bus-not-busy and backs off
+    if(sim_xfer.active || Sim_Now() < sim_busy_until_ns)
+    {
+        InstancePtr->Stats.BusBusy++;
+        sim_bnb_armed = 1;
+        return XST_IIC_BUS_BUSY;
+    }
+
+    sim_xfer.slave = Sim_Address((u8)InstancePtr->AddrOfSlave, &sim_xfer.nacked);
+    sim_xfer.is_recv = is_recv;
+    sim_xfer.buf = buf;
+    sim_xfer.count = count;
+
+    u64 duration = 2 * sim_timing.start_stop_ns + sim_timing.byte_ns;
+    if(!sim_xfer.nacked) duration += (u64)count * sim_timing.byte_ns;
+    sim_xfer.done_ns = Sim_Now() + duration;
+    sim_xfer.active = 1;
+    sim_stats.busy_ns += duration;
+
+    return XST_SUCCESS;
+}
+
+int XIic_MasterSend(XIic *InstancePtr, u8 *TxMsgPtr, int ByteCount)
+{
+    return Sim_Master_Transfer(InstancePtr, TxMsgPtr, ByteCount, 0);
+}
+
+int XIic_MasterRecv(XIic *InstancePtr, u8 *RxMsgPtr, int ByteCount)
+{
+    return Sim_Master_Transfer(InstancePtr, RxMsgPtr, ByteCount, 1);
+}
+
+u32 XIic_IsIicBusy(XIic *InstancePtr)
+{
+    (void)InstancePtr;
+    return (sim_xfer.active || Sim_Now() < sim_busy_until_ns) ? TRUE : FALSE;
+}
+
+void XIic_SetSendHandler(XIic *InstancePtr, void *CallBackRef, XIic_Handler FuncPtr)
+{
+    InstancePtr->SendHandler = FuncPtr;
+    InstancePtr->SendCallBackRef = CallBackRef;
+}
+
+void XIic_SetRecvHandler(XIic *InstancePtr, void *CallBackRef, XIic_Handler FuncPtr)
+{
+    InstancePtr->RecvHandler = FuncPtr;
+    InstancePtr->RecvCallBackRef = CallBackRef;
+}
+
+void XIic_SetStatusHandler(XIic *InstancePtr, void *CallBackRef, XIic_StatusHandler FuncPtr)
+{
+    InstancePtr->StatusHandler = FuncPtr;
+    InstancePtr->StatusCallBackRef = CallBackRef;
+}
+
+void XIic_InterruptHandler(void *InstancePtr)
+{
+    (void)InstancePtr;
+    Sim_Iic_Service();
+}
+
+void XIic_MultiMasterInclude(void)
+{
+}
+
+void XIic_GetStats(XIic *InstancePtr, XIicStats *StatsPtr)
+{
+    *StatsPtr = InstancePtr->Stats;
+}
+
+void XIic_ClearStats(XIic *InstancePtr)
+{
+    memset(&InstancePtr->Stats, 0, sizeof(InstancePtr->Stats));
+}
+
+// ------------------------------------------ Low Level / Dynamic API -------------------------------
+
+u32 XIic_ReadReg(UINTPTR BaseAddress, u32 RegOffset)
+{
+    (void)BaseAddress;
+    if(RegOffset == XIIC_SR_REG_OFFSET) return XIic_IsIicBusy(sim_iic) ? SIM_SR_BUS_BUSY : 0;
+    if(RegOffset == XIIC_DGIER_OFFSET) return sim_intr_global ? 0x80000000U : 0;
+    return 0;
+}
+
+void XIic_WriteReg(UINTPTR BaseAddress, u32 RegOffset, u32 RegisterValue)
+{
+    (void)BaseAddress;
+    if(RegOffset == XIIC_DGIER_OFFSET) sim_intr_global = (RegisterValue & 0x80000000U) != 0;
+}
+
+void XIic_IntrGlobalDisable(UINTPTR BaseAddress)
+{
+    XIic_WriteReg(BaseAddress, XIIC_DGIER_OFFSET, 0);
+}
+
+void XIic_IntrGlobalEnable(UINTPTR BaseAddress)
+{
+    XIic_WriteReg(BaseAddress, XIIC_DGIER_OFFSET, 0x80000000U);
+}
+
+int XIic_DynInit(UINTPTR BaseAddress)
+{
+    (void)BaseAddress;
+    if(sim_dyn_init_fail > 0)
+    {
+        sim_dyn_init_fail--;
+        return XST_FAILURE;
+    }
+    return XST_SUCCESS;
+}
+
+// Polled transfer, waits out another master first, returns the bytes moved
+static unsigned Sim_Dyn_Transfer(u8 addr, u8 *buf, u8 count, int is_recv, int stop)
+{
+    Sim_Slave *slave;
+    int nacked;
+
+    if(Sim_Now() < sim_busy_until_ns) Sim_Advance(sim_busy_until_ns - Sim_Now());
+
+    slave = Sim_Address(addr, &nacked);
+    if(nacked)
+    {
+        if(sim_iic != NULL) sim_iic->Stats.TxErrors++;
+        Sim_Advance(2 * sim_timing.start_stop_ns + sim_timing.byte_ns);
+        return 0;
+    }
+
+    u64 duration = sim_timing.start_stop_ns + (u64)(count + 1) * sim_timing.byte_ns;
+    if(stop) duration += sim_timing.start_stop_ns;
+    sim_stats.busy_ns += duration;
+    Sim_Advance(duration);
+
+    Sim_Transfer_Effect(slave, is_recv, buf, count);
+    return count;
+}
+
+unsigned XIic_DynSend(UINTPTR BaseAddress, u16 Address, u8 *BufferPtr, u8 ByteCount, u8 Option)
+{
+    (void)BaseAddress;
+    if(Option == XIIC_REPEATED_START && sim_iic != NULL) sim_iic->Stats.RepeatedStarts++;
+    return Sim_Dyn_Transfer((u8)Address, BufferPtr, ByteCount, 0, Option != XIIC_REPEATED_START);
+}
+
+unsigned XIic_DynRecv(UINTPTR BaseAddress, u8 Address, u8 *BufferPtr, u8 ByteCount)
+{
+    (void)BaseAddress;
+    return Sim_Dyn_Transfer(Address, BufferPtr, ByteCount, 1, 1);
+}
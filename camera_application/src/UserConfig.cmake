@@ -32,6 +32,22 @@ set(USER_COMPILE_SOURCES
 "main.c"
 "ov7670.c"
 "iic_helper.c"
+"ov7670_profiles.c"
+"frame_pool.c"
+"frame_ring.c"
+"dma_helper.c"
+"capture.c"
+"dma_service.c"
+"cache_policy.c"
+"mem_bench.c"
+"pixel_convert.c"
+"resize.c"
+"demosaic.c"
+"image_stats.c"
+"auto_exposure.c"
+"auto_white_balance.c"
+"color_pipeline.c"
+"motion_detect.c"
 )
 
 # -----------------------------------------
@@ -65,6 +81,18 @@ set(USER_COMPILE_OPTIMIZATION_LEVEL "-O0")
 # Other flags related to optimization
 set(USER_COMPILE_OPTIMIZATION_OTHER_FLAGS "")
 
+# Per pixel kernels, built at -O3 whatever the level above is ( comes later on the command line )
+set_source_files_properties(
+    "pixel_convert.c"
+    "resize.c"
+    "demosaic.c"
+    "image_stats.c"
+    "auto_white_balance.c"
+    "color_pipeline.c"
+    "motion_detect.c"
+    PROPERTIES COMPILE_OPTIONS "-O3"
+)
+
 # -----------------------------------------
 
 # Debug level "" [None], "-g1" [Minimum], "g2" [Default], "g3" [Maximum]
@@ -89,7 +117,8 @@ set(USER_COMPILE_RELAXATION "-Wl,--no-relax")
 set(USER_COMPILE_GARBAGE "")
 # Add any compiler options that are not covered by the above variables, they will be added as extra compiler options
 # To enable profiling -pg [ for gprof ]  or -p [ for prof information ]
-set(USER_COMPILE_OTHER_FLAGS "")
+# -mfpu=neon: VFPv3 plus Advanced SIMD, same registers and ABI as the BSP's vfpv3, for the pixel kernels
+set(USER_COMPILE_OTHER_FLAGS "-mfpu=neon")
 
 # -----------------------------------------
 
@@ -0,0 +1,232 @@
+#include "auto_exposure.h"
+#include <string.h>
+
+#define AUTO_EXPOSURE_MAX_GAIN (31U * AUTO_EXPOSURE_GAIN_ONE)  // 4 doubling stages of 1 15/16x
+#define AUTO_EXPOSURE_MAX_STEP 4U                              // Largest exposure x gain change per update
+
+static const AutoExposureConfig auto_exposure_default = {
+    .target = 118,
+    .hold_band = 6,
+    .wake_band = 16,
+    .damping = 128,
+    .interval = 3,
+    .max_exposure = 500,
+    .band_rows = 76,
+    .max_gain = 8U * AUTO_EXPOSURE_GAIN_ONE,
+};
+
+u8 Auto_Exposure_GainCode(u32 gain)
+{
+    u32 stages = 0;
+
+    if(gain < AUTO_EXPOSURE_GAIN_ONE) gain = AUTO_EXPOSURE_GAIN_ONE;
+    while(gain >= 2U * AUTO_EXPOSURE_GAIN_ONE && stages < 4U)
+    {
+        gain = (gain + 1U) >> 1;
+        stages++;
+    }
+    if(gain > 2U * AUTO_EXPOSURE_GAIN_ONE - 1U) gain = 2U * AUTO_EXPOSURE_GAIN_ONE - 1U;
+    return (u8)((((1U << stages) - 1U) << 4) | (gain - AUTO_EXPOSURE_GAIN_ONE));
+}
+
+// Q4 gain of a GAIN register value
+static u32 Auto_Exposure_GainValue(u8 code)
+{
+    u32 gain = AUTO_EXPOSURE_GAIN_ONE + (code & 0x0FU);
+
+    for(u32 bit = 0x10U; bit <= 0x80U; bit <<= 1)
+        if(code & bit) gain <<= 1;
+    return gain;
+}
+
+// Nearest gain the register holds, within 1x .. max_gain
+static u32 Auto_Exposure_GainLimit(const AutoExposureConfig *cfg, u32 gain)
+{
+    if(gain > cfg->max_gain) gain = cfg->max_gain;
+    gain = Auto_Exposure_GainValue(Auto_Exposure_GainCode(gain));
+    while(gain > cfg->max_gain) gain = Auto_Exposure_GainValue(Auto_Exposure_GainCode(gain - 1U));
+    return gain;
+}
+
+u32 Auto_Exposure_Meter(const ImageStats *stats)
+{
+    u32 tiles_x = stats->cfg.tiles_x, tiles_y = stats->cfg.tiles_y;
+    u64 sum = 0, pixels = 0;
+
+    for(u32 ty = 0; ty < tiles_y; ty++)
+    {
+        for(u32 tx = 0; tx < tiles_x; tx++)
+        {
+            const ImageStatsTile *tile = Image_Stats_Tile(stats, tx, ty);
+            u32 inner = tx > 0 && tx + 1 < tiles_x && ty > 0 && ty + 1 < tiles_y;
+            u32 weight = inner ? 2U : 1U;
+
+            sum += (u64)tile->sum[IMAGE_STATS_Y] * weight;
+            pixels += (u64)tile->pixels * weight;
+        }
+    }
+    return pixels != 0 ? (u32)((sum + pixels / 2U) / pixels) : 0U;
+}
+
+int Auto_Exposure_Init(AutoExposure *ae, OV7670 *cam, const AutoExposureConfig *cfg)
+{
+    u8 com8, com1, aech, aechh, gain;
+    u32 exposure;
+    int status;
+
+    if(ae == NULL || cam == NULL) return XST_INVALID_PARAM;
+    if(cfg == NULL) cfg = &auto_exposure_default;
+    if(cfg->target == 0 || cfg->damping == 0 || cfg->interval == 0 || cfg->wake_band < cfg->hold_band || cfg->max_exposure == 0 ||
+       cfg->max_gain < AUTO_EXPOSURE_GAIN_ONE || cfg->max_gain > AUTO_EXPOSURE_MAX_GAIN)
+    {
+        xil_printf("[ERROR] Auto exposure: config refused\n");
+        return XST_INVALID_PARAM;
+    }
+
+    memset(ae, 0, sizeof(*ae));
+    ae->cam = cam;
+    ae->cfg = *cfg;
+    ae->wait = cfg->interval;
+
+    // Stop the sensor's loops first so the values read back stay put
+    status = OV7670_ReadReg(cam, REG_COM8, &com8);
+    if(status == XST_SUCCESS) status = OV7670_WriteReg(cam, REG_COM8, com8 & (u8)~(REG_COM8_AEC_EN | REG_COM8_AGC_EN));
+    if(status == XST_SUCCESS) status = OV7670_ReadReg(cam, REG_COM1, &com1);
+    if(status == XST_SUCCESS) status = OV7670_ReadReg(cam, REG_AECH, &aech);
+    if(status == XST_SUCCESS) status = OV7670_ReadReg(cam, REG_AECHH, &aechh);
+    if(status == XST_SUCCESS) status = OV7670_ReadReg(cam, REG_GAIN, &gain);
+    if(status != XST_SUCCESS)
+    {
+        xil_printf("[ERROR] Auto exposure: sensor access failed with status: %d\n", status);
+        return status;
+    }
+
+    // Carry on from where the sensor's AEC / AGC left off, inside our limits
+    ae->com1 = com1 & (u8)~0x03U;
+    ae->aechh = aechh & (u8)~0x3FU;
+    exposure = ((u32)(aechh & 0x3FU) << 10) | ((u32)aech << 2) | (com1 & 0x03U);
+    ae->exposure = (u16)(exposure == 0 ? 1U : (exposure > cfg->max_exposure ? cfg->max_exposure : exposure));
+    ae->gain = (u16)Auto_Exposure_GainLimit(cfg, Auto_Exposure_GainValue(gain));
+
+    status = OV7670_WriteReg(cam, REG_AECHH, (u8)(ae->aechh | ((ae->exposure >> 10) & 0x3FU)));
+    if(status == XST_SUCCESS) status = OV7670_WriteReg(cam, REG_AECH, (u8)(ae->exposure >> 2));
+    if(status == XST_SUCCESS) status = OV7670_WriteReg(cam, REG_COM1, (u8)(ae->com1 | (ae->exposure & 0x03U)));
+    if(status == XST_SUCCESS) status = OV7670_WriteReg(cam, REG_GAIN, Auto_Exposure_GainCode(ae->gain));
+    return status;
+}
+
+// Exposure rows and Q4 gain for an exposure x gain product, exposure first
+static void Auto_Exposure_Split(const AutoExposure *ae, u64 product, u16 *exposure, u16 *gain)
+{
+    const AutoExposureConfig *cfg = &ae->cfg;
+    u64 rows = product / AUTO_EXPOSURE_GAIN_ONE, g;
+
+    if(rows < 1) rows = 1;
+    if(rows > cfg->max_exposure) rows = cfg->max_exposure;
+    if(cfg->band_rows != 0 && rows >= cfg->band_rows) rows -= rows % cfg->band_rows;
+
+    g = (product + rows / 2U) / rows;
+
+    *exposure = (u16)rows;
+    *gain = (u16)Auto_Exposure_GainLimit(cfg, g > cfg->max_gain ? cfg->max_gain : (u32)g);
+}
+
+static int Auto_Exposure_Write(AutoExposure *ae, u32 *slot, u8 reg, u8 value, u8 old_value)
+{
+    u8 tx_buf[] = { reg, value };
+    int status;
+
+    if(value == old_value) return XST_SUCCESS;
+    status = Iic_Queue_Write(ae->cam->iic_dev, &ae->txn[*slot], tx_buf, 2, NULL, NULL);
+    if(status != XST_SUCCESS)
+    {
+        ae->stats.errors++;
+        return status;
+    }
+    (*slot)++;
+    return XST_SUCCESS;
+}
+
+int Auto_Exposure_Update(AutoExposure *ae, const ImageStats *stats)
+{
+    const AutoExposureConfig *cfg = &ae->cfg;
+    u64 product, desired, next;
+    u16 exposure, gain;
+    u32 luma, error, slot = 0;
+    int status;
+
+    ae->stats.frames++;
+    if(ae->wait > 1)
+    {
+        ae->wait--;
+        return XST_SUCCESS;
+    }
+
+    // The last update must be on the sensor before the next one is worked out
+    for(u32 i = 0; i < AUTO_EXPOSURE_TXNS; i++)
+    {
+        status = Iic_Txn_Poll(&ae->txn[i]);
+        if(status == XST_DEVICE_BUSY)
+        {
+            ae->stats.deferred++;
+            return XST_SUCCESS;
+        }
+        if(status != XST_SUCCESS)
+        {
+            ae->stats.errors++;
+            ae->txn[i].status = XST_SUCCESS;
+        }
+    }
+    // All writes of an update are queued or none, a half applied exposure would not match the model
+    if(Iic_Queue_Room(ae->cam->iic_dev) < AUTO_EXPOSURE_TXNS)
+    {
+        ae->stats.deferred++;
+        return XST_SUCCESS;
+    }
+    ae->wait = cfg->interval;
+    if(stats->total.pixels == 0) return XST_SUCCESS;
+
+    luma = Auto_Exposure_Meter(stats);
+    ae->stats.luma = luma;
+    error = luma > cfg->target ? luma - cfg->target : cfg->target - luma;
+    if(error <= (ae->settled ? cfg->wake_band : cfg->hold_band))
+    {
+        ae->settled = TRUE;
+        ae->stats.holds++;
+        return XST_SUCCESS;
+    }
+    ae->settled = FALSE;
+
+    // Damped move of the exposure x gain product towards target / luma, limited either way
+    product = (u64)ae->exposure * ae->gain;
+    desired = luma != 0 ? product * cfg->target / luma : product * AUTO_EXPOSURE_MAX_STEP;
+    if(desired > product * AUTO_EXPOSURE_MAX_STEP) desired = product * AUTO_EXPOSURE_MAX_STEP;
+    if(desired < product / AUTO_EXPOSURE_MAX_STEP) desired = product / AUTO_EXPOSURE_MAX_STEP;
+    next = desired >= product ? product + (((desired - product) * cfg->damping + 255U) >> 8)
+                              : product - (((product - desired) * cfg->damping + 255U) >> 8);
+
+    Auto_Exposure_Split(ae, next, &exposure, &gain);
+    if(exposure == ae->exposure && gain == ae->gain) return XST_SUCCESS;
+
+    // Exposure spans three registers, AECHH and COM1 keep their other bits
+    status = Auto_Exposure_Write(ae, &slot, REG_AECHH, (u8)(ae->aechh | ((exposure >> 10) & 0x3FU)),
+                                 (u8)(ae->aechh | ((ae->exposure >> 10) & 0x3FU)));
+    if(status == XST_SUCCESS) status = Auto_Exposure_Write(ae, &slot, REG_AECH, (u8)(exposure >> 2), (u8)(ae->exposure >> 2));
+    if(status == XST_SUCCESS) status = Auto_Exposure_Write(ae, &slot, REG_COM1, (u8)(ae->com1 | (exposure & 0x03U)),
+                                                           (u8)(ae->com1 | (ae->exposure & 0x03U)));
+    if(status == XST_SUCCESS) status = Auto_Exposure_Write(ae, &slot, REG_GAIN, Auto_Exposure_GainCode(gain), Auto_Exposure_GainCode(ae->gain));
+    if(status != XST_SUCCESS) return status;
+
+    ae->exposure = exposure;
+    ae->gain = gain;
+    ae->stats.updates++;
+    return XST_SUCCESS;
+}
+
+void Auto_Exposure_Print_Stats(const AutoExposure *ae)
+{
+    xil_printf("[INFO] Auto exposure: luma %u ( target %u ), exposure %u rows, gain %u/16, %s\n", ae->stats.luma, ae->cfg.target,
+               ae->exposure, ae->gain, ae->settled ? "settled" : "moving");
+    xil_printf("[INFO]   %u frames, %u updates, %u holds, %u deferred, %u errors\n", ae->stats.frames, ae->stats.updates,
+               ae->stats.holds, ae->stats.deferred, ae->stats.errors);
+}
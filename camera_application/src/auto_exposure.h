@@ -0,0 +1,83 @@
+#ifndef __AUTO_EXPOSURE_H__
+#define __AUTO_EXPOSURE_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "iic_helper.h"
+#include "ov7670.h"
+#include "image_stats.h"
+
+/*
+    Software exposure / gain loop replacing the sensor's own AEC / AGC ( cleared in COM8 ), which
+    hunts under flickering light. Once per interval frames the centre weighted mean luma of the
+    frame statistics is compared with the target:
+
+    - Hysteresis: a converged loop holds until the error leaves wake_band, a moving loop stops
+      once it is back inside hold_band.
+    - Damped: the exposure x gain product moves by damping / 256 of the correction, at most 4x
+      either way per update.
+    - Exposure is spent before gain. With band_rows set, exposures of at least one flicker period
+      are whole periods, so every row integrates the same amount of light.
+
+    Register writes ( AECHH, AECH, COM1 for the exposure, GAIN ) go out on the IIC queue without
+    waiting. An update is deferred while the previous one is still on the bus or the device queue
+    has no room for all four, and the interval leaves the sensor a frame or two to latch the new
+    values before they are measured.
+*/
+
+#define AUTO_EXPOSURE_TXNS 4U   // Register writes per update
+
+// OV7670 gain in Q4, 16 = 1x
+#define AUTO_EXPOSURE_GAIN_ONE 16U
+
+typedef struct {
+    u8  target;          // Mean luma aimed for
+    u8  hold_band;       // |error| at which a moving loop settles
+    u8  wake_band;       // |error| at which a settled loop moves again, >= hold_band
+    u8  damping;         // Fraction of the correction applied per update, Q8, 1 .. 255
+    u8  interval;        // Frames between updates, >= 1
+    u16 max_exposure;    // Rows, up to the frame length
+    u16 band_rows;       // Rows per flicker period ( 100 / 120 Hz ), 0 to use any exposure
+    u16 max_gain;        // Q4, AUTO_EXPOSURE_GAIN_ONE .. 31x
+} AutoExposureConfig;
+
+typedef struct {
+    u32 frames;          // Statistics offered
+    u32 updates;         // Register sets queued
+    u32 holds;           // Updates skipped inside the band
+    u32 deferred;        // Updates skipped, the previous writes were still queued or no queue room
+    u32 errors;          // Writes refused or failed on the bus
+    u32 luma;            // Last metered luma
+} AutoExposureStats;
+
+typedef struct {
+    OV7670 *cam;
+    AutoExposureConfig cfg;
+    u16 exposure;        // Rows, last written
+    u16 gain;            // Q4, last written
+    u8  com1;            // COM1 bits other than AEC[1:0]
+    u8  aechh;           // AECHH bits other than AEC[15:10]
+    u8  settled;         // Inside the band, holding
+    u8  wait;            // Frames until the next update
+    IicTxn txn[AUTO_EXPOSURE_TXNS];
+    AutoExposureStats stats;
+} AutoExposure;
+
+// Take exposure and gain over from the sensor ( blocking register access, init time only ).
+// NULL cfg: target 118, bands 6 / 16, half the correction per update, every 3rd frame, 500 rows,
+// 10 ms bands ( 50 Hz mains, 76 rows of 131 us at VGA 15 fps ), up to 8x gain.
+int Auto_Exposure_Init(AutoExposure *ae, OV7670 *cam, const AutoExposureConfig *cfg);
+
+// Once per measured frame, queues the new registers when an update is due
+int Auto_Exposure_Update(AutoExposure *ae, const ImageStats *stats);
+
+// Centre weighted mean luma of the tiles, inner tiles count twice
+u32 Auto_Exposure_Meter(const ImageStats *stats);
+
+// OV7670 GAIN register value for a Q4 gain: one doubling stage per bit of [7:4], [3:0] in 1/16
+u8 Auto_Exposure_GainCode(u32 gain);
+
+void Auto_Exposure_Print_Stats(const AutoExposure *ae);
+
+#endif
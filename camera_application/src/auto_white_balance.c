@@ -0,0 +1,283 @@
+#include "auto_white_balance.h"
+#include <string.h>
+
+#ifdef PIX_NEON
+#include <arm_neon.h>
+#endif
+
+#define AUTO_WHITE_BALANCE_DIGITAL_ONE (1U << AUTO_WHITE_BALANCE_DIGITAL_SHIFT)
+#define AUTO_WHITE_BALANCE_MAX         (AUTO_WHITE_BALANCE_SENSOR_MAX * 255U / AUTO_WHITE_BALANCE_DIGITAL_ONE)
+#define AUTO_WHITE_BALANCE_PREFETCH    128U
+
+static const AutoWhiteBalanceConfig auto_white_balance_default = {
+    .method = AUTO_WHITE_BALANCE_GRAY_WORLD,
+    .damping = 128,
+    .interval = 4,
+    .percentile = 98,
+    .dark_level = 24,
+    .hold_permille = 10,
+};
+
+static const u8 auto_white_balance_regs[AUTO_WHITE_BALANCE_CHANNELS] = { REG_RED, REG_BLUE };
+
+// --------------------------------------- Digital gain -----------------------------------------------
+
+static inline u32 Auto_White_Balance_Scale(u32 value, u32 gain, u32 max)
+{
+    value = (value * gain + AUTO_WHITE_BALANCE_DIGITAL_ONE / 2U) >> AUTO_WHITE_BALANCE_DIGITAL_SHIFT;
+    return value > max ? max : value;
+}
+
+void Auto_White_Balance_Rgb888_Line_C(u8 *pixels, u32 count, u8 red, u8 blue)
+{
+    for(u32 i = 0; i < count; i++, pixels += 3)
+    {
+        pixels[0] = (u8)Auto_White_Balance_Scale(pixels[0], red, 255U);
+        pixels[2] = (u8)Auto_White_Balance_Scale(pixels[2], blue, 255U);
+    }
+}
+
+void Auto_White_Balance_Rgb565_Line_C(u16 *pixels, u32 count, u8 red, u8 blue)
+{
+    for(u32 i = 0; i < count; i++)
+    {
+        u32 p = pixels[i];
+
+        pixels[i] = (u16)((Auto_White_Balance_Scale(p >> 11, red, 31U) << 11) | (p & 0x07E0U) |
+                          Auto_White_Balance_Scale(p & 0x1FU, blue, 31U));
+    }
+}
+
+void Auto_White_Balance_Rgb888_Line(u8 *pixels, u32 count, u8 red, u8 blue)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    uint8x8_t r_gain = vdup_n_u8(red), b_gain = vdup_n_u8(blue);
+
+    for(; i + 8 <= count; i += 8)
+    {
+        __builtin_prefetch(pixels + 3 * i + AUTO_WHITE_BALANCE_PREFETCH);
+        uint8x8x3_t p = vld3_u8(pixels + 3 * i);
+
+        p.val[0] = vqrshrn_n_u16(vmull_u8(p.val[0], r_gain), AUTO_WHITE_BALANCE_DIGITAL_SHIFT);
+        p.val[2] = vqrshrn_n_u16(vmull_u8(p.val[2], b_gain), AUTO_WHITE_BALANCE_DIGITAL_SHIFT);
+        vst3_u8(pixels + 3 * i, p);
+    }
+#endif
+    Auto_White_Balance_Rgb888_Line_C(pixels + 3 * i, count - i, red, blue);
+}
+
+void Auto_White_Balance_Rgb565_Line(u16 *pixels, u32 count, u8 red, u8 blue)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    uint16x8_t five = vdupq_n_u16(0x1FU), green = vdupq_n_u16(0x07E0U);
+
+    for(; i + 8 <= count; i += 8)
+    {
+        __builtin_prefetch((u8 *)(pixels + i) + AUTO_WHITE_BALANCE_PREFETCH);
+        uint16x8_t p = vld1q_u16(pixels + i);
+        uint16x8_t r = vminq_u16(vrshrq_n_u16(vmulq_n_u16(vshrq_n_u16(p, 11), red), AUTO_WHITE_BALANCE_DIGITAL_SHIFT), five);
+        uint16x8_t b = vminq_u16(vrshrq_n_u16(vmulq_n_u16(vandq_u16(p, five), blue), AUTO_WHITE_BALANCE_DIGITAL_SHIFT), five);
+
+        vst1q_u16(pixels + i, vorrq_u16(vorrq_u16(vshlq_n_u16(r, 11), vandq_u16(p, green)), b));
+    }
+#endif
+    Auto_White_Balance_Rgb565_Line_C(pixels + i, count - i, red, blue);
+}
+
+int Auto_White_Balance_Apply(AutoWhiteBalance *awb, PixImage *img)
+{
+    u8 red = awb->digital[AUTO_WHITE_BALANCE_RED], blue = awb->digital[AUTO_WHITE_BALANCE_BLUE];
+
+    if(img->format != PIX_FMT_RGB888 && img->format != PIX_FMT_RGB565) return XST_NO_FEATURE;
+    if(red == AUTO_WHITE_BALANCE_DIGITAL_ONE && blue == AUTO_WHITE_BALANCE_DIGITAL_ONE) return XST_SUCCESS;
+
+    for(u32 y = 0; y < img->height; y++)
+    {
+        u8 *line = img->planes[0] + y * img->strides[0];
+
+        if(img->format == PIX_FMT_RGB888) Auto_White_Balance_Rgb888_Line(line, img->width, red, blue);
+        else Auto_White_Balance_Rgb565_Line((u16 *)line, img->width, red, blue);
+    }
+    awb->stats.digital_frames++;
+    return XST_SUCCESS;
+}
+
+// --------------------------------------- Control ----------------------------------------------------
+
+// Sensor part of a total gain at register resolution, the rest digital
+static void Auto_White_Balance_Split(AutoWhiteBalance *awb, u32 ch)
+{
+    u32 gain = awb->gain[ch], sensor, digital;
+
+    sensor = gain < AUTO_WHITE_BALANCE_SENSOR_MIN ? AUTO_WHITE_BALANCE_SENSOR_MIN : gain;
+    if(sensor > AUTO_WHITE_BALANCE_SENSOR_MAX) sensor = AUTO_WHITE_BALANCE_SENSOR_MAX;
+    sensor = ((sensor + 1U) >> 1) << 1;
+
+    digital = (gain * AUTO_WHITE_BALANCE_DIGITAL_ONE + sensor / 2U) / sensor;
+    if(digital < AUTO_WHITE_BALANCE_DIGITAL_ONE) digital = AUTO_WHITE_BALANCE_DIGITAL_ONE;
+    if(digital > 255U) digital = 255U;
+
+    awb->sensor[ch] = (u16)sensor;
+    awb->digital[ch] = (u8)digital;
+}
+
+int Auto_White_Balance_Init(AutoWhiteBalance *awb, OV7670 *cam, const AutoWhiteBalanceConfig *cfg)
+{
+    u8 com8, value;
+    int status;
+
+    if(awb == NULL || cam == NULL) return XST_INVALID_PARAM;
+    if(cfg == NULL) cfg = &auto_white_balance_default;
+    if(cfg->damping == 0 || cfg->interval == 0 || cfg->percentile == 0 || cfg->percentile > 100)
+    {
+        xil_printf("[ERROR] Auto white balance: config refused\n");
+        return XST_INVALID_PARAM;
+    }
+
+    memset(awb, 0, sizeof(*awb));
+    awb->cam = cam;
+    awb->cfg = *cfg;
+    awb->wait = cfg->interval;
+
+    status = OV7670_ReadReg(cam, REG_COM8, &com8);
+    if(status == XST_SUCCESS) status = OV7670_WriteReg(cam, REG_COM8, com8 & (u8)~REG_COM8_AWB_EN);
+
+    // Start from the gains the sensor's AWB left, at register resolution
+    for(u32 ch = 0; ch < AUTO_WHITE_BALANCE_CHANNELS && status == XST_SUCCESS; ch++)
+    {
+        status = OV7670_ReadReg(cam, auto_white_balance_regs[ch], &value);
+        if(status != XST_SUCCESS) break;
+        awb->gain[ch] = (u16)((u32)value << 1);
+        Auto_White_Balance_Split(awb, ch);
+        awb->gain[ch] = awb->sensor[ch];
+        awb->digital[ch] = AUTO_WHITE_BALANCE_DIGITAL_ONE;
+        status = OV7670_WriteReg(cam, auto_white_balance_regs[ch], (u8)(awb->sensor[ch] >> 1));
+    }
+    if(status != XST_SUCCESS) xil_printf("[ERROR] Auto white balance: sensor access failed with status: %d\n", status);
+    return status;
+}
+
+// Green over red and blue, Q8, from the frame statistics. FALSE when nothing usable was measured.
+static int Auto_White_Balance_Measure(const AutoWhiteBalance *awb, const ImageStats *stats, u32 ratio[AUTO_WHITE_BALANCE_CHANNELS])
+{
+    u64 r = 0, g = 0, b = 0;
+
+    if(awb->cfg.method == AUTO_WHITE_BALANCE_WHITE_PATCH)
+    {
+        r = Image_Stats_Percentile(&stats->total, IMAGE_STATS_R, awb->cfg.percentile) + 1U;
+        g = Image_Stats_Percentile(&stats->total, IMAGE_STATS_G, awb->cfg.percentile) + 1U;
+        b = Image_Stats_Percentile(&stats->total, IMAGE_STATS_B, awb->cfg.percentile) + 1U;
+        if(stats->total.pixels == 0) return FALSE;
+    }
+    else
+    {
+        // Clipped tiles lie about their colour, dark ones are mostly noise
+        for(u32 t = 0; t < (u32)stats->cfg.tiles_x * stats->cfg.tiles_y; t++)
+        {
+            const ImageStatsTile *tile = &stats->tiles[t];
+
+            if(tile->pixels == 0 || tile->saturated * 16U > tile->pixels ||
+               Image_Stats_Mean(tile, IMAGE_STATS_Y) < awb->cfg.dark_level) continue;
+            r += tile->sum[IMAGE_STATS_R];
+            g += tile->sum[IMAGE_STATS_G];
+            b += tile->sum[IMAGE_STATS_B];
+        }
+        if(r == 0 || g == 0 || b == 0) return FALSE;
+    }
+
+    ratio[AUTO_WHITE_BALANCE_RED] = (u32)((g * AUTO_WHITE_BALANCE_ONE + r / 2U) / r);
+    ratio[AUTO_WHITE_BALANCE_BLUE] = (u32)((g * AUTO_WHITE_BALANCE_ONE + b / 2U) / b);
+    return TRUE;
+}
+
+int Auto_White_Balance_Update(AutoWhiteBalance *awb, const ImageStats *stats)
+{
+    const AutoWhiteBalanceConfig *cfg = &awb->cfg;
+    u32 ratio[AUTO_WHITE_BALANCE_CHANNELS], target[AUTO_WHITE_BALANCE_CHANNELS];
+    u32 moving = FALSE;
+    int status;
+
+    awb->stats.frames++;
+    if(awb->wait > 1)
+    {
+        awb->wait--;
+        return XST_SUCCESS;
+    }
+
+    // The last gains must be on the sensor before they are measured again
+    for(u32 ch = 0; ch < AUTO_WHITE_BALANCE_CHANNELS; ch++)
+    {
+        status = Iic_Txn_Poll(&awb->txn[ch]);
+        if(status == XST_DEVICE_BUSY)
+        {
+            awb->stats.deferred++;
+            return XST_SUCCESS;
+        }
+        if(status != XST_SUCCESS)
+        {
+            awb->stats.errors++;
+            awb->txn[ch].status = XST_SUCCESS;
+        }
+    }
+    awb->wait = cfg->interval;
+
+    // The frame went through the sensor gains only, the digital part is applied after the statistics
+    if(!Auto_White_Balance_Measure(awb, stats, ratio))
+    {
+        awb->stats.holds++;
+        return XST_SUCCESS;
+    }
+    for(u32 ch = 0; ch < AUTO_WHITE_BALANCE_CHANNELS; ch++)
+    {
+        u32 gain = awb->gain[ch];
+
+        target[ch] = (awb->sensor[ch] * ratio[ch] + AUTO_WHITE_BALANCE_ONE / 2U) / AUTO_WHITE_BALANCE_ONE;
+        if(target[ch] < AUTO_WHITE_BALANCE_SENSOR_MIN) target[ch] = AUTO_WHITE_BALANCE_SENSOR_MIN;
+        if(target[ch] > AUTO_WHITE_BALANCE_MAX) target[ch] = AUTO_WHITE_BALANCE_MAX;
+        if((target[ch] > gain ? target[ch] - gain : gain - target[ch]) * 1000U > gain * cfg->hold_permille) moving = TRUE;
+    }
+    if(!moving)
+    {
+        awb->stats.holds++;
+        return XST_SUCCESS;
+    }
+
+    for(u32 ch = 0; ch < AUTO_WHITE_BALANCE_CHANNELS; ch++)
+    {
+        u32 gain = awb->gain[ch], old_gain = gain, old_sensor = awb->sensor[ch];
+        u8 tx_buf[2];
+
+        gain = target[ch] >= gain ? gain + (((target[ch] - gain) * cfg->damping + 255U) >> 8)
+                                  : gain - (((gain - target[ch]) * cfg->damping + 255U) >> 8);
+        awb->gain[ch] = (u16)gain;
+        Auto_White_Balance_Split(awb, ch);
+        if(awb->sensor[ch] == old_sensor) continue;
+
+        tx_buf[0] = auto_white_balance_regs[ch];
+        tx_buf[1] = (u8)(awb->sensor[ch] >> 1);
+        status = Iic_Queue_Write(awb->cam->iic_dev, &awb->txn[ch], tx_buf, 2, NULL, NULL);
+        if(status != XST_SUCCESS)
+        {
+            // Keep the gains in step with the register, try again next update
+            awb->stats.errors++;
+            awb->gain[ch] = (u16)old_gain;
+            Auto_White_Balance_Split(awb, ch);
+        }
+    }
+    awb->stats.updates++;
+    return XST_SUCCESS;
+}
+
+void Auto_White_Balance_Print_Stats(const AutoWhiteBalance *awb)
+{
+    xil_printf("[INFO] Auto white balance ( %s ): red %u/256 ( sensor 0x%02X, digital %u/64 ), blue %u/256 ( sensor 0x%02X, digital %u/64 )\n",
+               awb->cfg.method == AUTO_WHITE_BALANCE_GRAY_WORLD ? "gray world" : "white patch",
+               awb->gain[AUTO_WHITE_BALANCE_RED], awb->sensor[AUTO_WHITE_BALANCE_RED] >> 1, awb->digital[AUTO_WHITE_BALANCE_RED],
+               awb->gain[AUTO_WHITE_BALANCE_BLUE], awb->sensor[AUTO_WHITE_BALANCE_BLUE] >> 1, awb->digital[AUTO_WHITE_BALANCE_BLUE]);
+    xil_printf("[INFO]   %u frames, %u updates, %u holds, %u deferred, %u errors, %u digitally scaled\n", awb->stats.frames,
+               awb->stats.updates, awb->stats.holds, awb->stats.deferred, awb->stats.errors, awb->stats.digital_frames);
+}
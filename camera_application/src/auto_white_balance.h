@@ -0,0 +1,91 @@
+#ifndef __AUTO_WHITE_BALANCE_H__
+#define __AUTO_WHITE_BALANCE_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "iic_helper.h"
+#include "ov7670.h"
+#include "image_stats.h"
+#include "pixel_convert.h"
+
+/*
+    Software white balance on the sensor's red and blue channel gains ( REG_RED / REG_BLUE, 0x80 is
+    1x ), replacing its own AWB ( cleared in COM8 ). Green is the reference. Once per interval frames
+    the red and blue gains needed to match green are estimated from the frame statistics:
+
+    - Gray world: channel sums over the tiles that are neither clipped nor dark.
+    - White patch: the high percentile of each channel histogram.
+
+    and the total gains move by damping / 256 of the way there, holding while both are within
+    hold_permille. Hardware gains cost nothing per pixel, so they carry as much of the total as the
+    registers allow ( ~2x ). The rest becomes a digital gain applied to the frame by
+    Auto_White_Balance_Apply, a pass that only runs while a sensor gain is saturated.
+
+    Gains are Q8 ( 256 = 1x ) in the API, the register writes go out on the IIC queue without waiting.
+*/
+
+#define AUTO_WHITE_BALANCE_ONE           256U   // 1x in Q8
+#define AUTO_WHITE_BALANCE_SENSOR_MAX    510U   // REG_RED / REG_BLUE 0xFF, Q7
+#define AUTO_WHITE_BALANCE_SENSOR_MIN    64U    // 0x20, 0.25x
+#define AUTO_WHITE_BALANCE_DIGITAL_SHIFT 6      // Digital gains are Q6 in 8 bits, up to ~4x
+
+typedef enum {
+    AUTO_WHITE_BALANCE_GRAY_WORLD,
+    AUTO_WHITE_BALANCE_WHITE_PATCH,
+} AutoWhiteBalanceMethod;
+
+typedef enum {
+    AUTO_WHITE_BALANCE_RED,
+    AUTO_WHITE_BALANCE_BLUE,
+    AUTO_WHITE_BALANCE_CHANNELS,
+} AutoWhiteBalanceChannel;
+
+typedef struct {
+    AutoWhiteBalanceMethod method;
+    u8  damping;         // Fraction of the correction applied per update, Q8, 1 .. 255
+    u8  interval;        // Frames between updates, >= 1
+    u8  percentile;      // White patch: level of each channel taken as white
+    u8  dark_level;      // Gray world: tiles with a mean luma below this are skipped
+    u16 hold_permille;   // No update while both gains are within this of their target
+} AutoWhiteBalanceConfig;
+
+typedef struct {
+    u32 frames;          // Statistics offered
+    u32 updates;         // Gain sets applied
+    u32 holds;           // Updates skipped inside the band, or nothing usable measured
+    u32 deferred;        // Updates skipped, the previous writes were still queued
+    u32 errors;          // Writes refused or failed on the bus
+    u32 digital_frames;  // Frames Auto_White_Balance_Apply had to scale
+} AutoWhiteBalanceStats;
+
+typedef struct {
+    OV7670 *cam;
+    AutoWhiteBalanceConfig cfg;
+    u16 gain[AUTO_WHITE_BALANCE_CHANNELS];      // Total, Q8
+    u16 sensor[AUTO_WHITE_BALANCE_CHANNELS];    // Part in the sensor, Q8 with Q7 resolution
+    u8  digital[AUTO_WHITE_BALANCE_CHANNELS];   // Part left for the pixels, Q6
+    u8  wait;                                   // Frames until the next update
+    IicTxn txn[AUTO_WHITE_BALANCE_CHANNELS];
+    AutoWhiteBalanceStats stats;
+} AutoWhiteBalance;
+
+// Take the red / blue gains over from the sensor ( blocking register access, init time only ).
+// NULL cfg: gray world, half the correction per update, every 4th frame, 1 % band.
+int Auto_White_Balance_Init(AutoWhiteBalance *awb, OV7670 *cam, const AutoWhiteBalanceConfig *cfg);
+
+// Once per measured frame, queues the new sensor gains when an update is due
+int Auto_White_Balance_Update(AutoWhiteBalance *awb, const ImageStats *stats);
+
+// Scale red and blue of an RGB888 or RGB565 frame by the digital gains, nothing to do at 1x
+int Auto_White_Balance_Apply(AutoWhiteBalance *awb, PixImage *img);
+
+// Red and blue times Q6 gains, saturating. The RGB565 versions work on the 5 bit fields.
+void Auto_White_Balance_Rgb888_Line(u8 *pixels, u32 count, u8 red, u8 blue);
+void Auto_White_Balance_Rgb565_Line(u16 *pixels, u32 count, u8 red, u8 blue);
+void Auto_White_Balance_Rgb888_Line_C(u8 *pixels, u32 count, u8 red, u8 blue);
+void Auto_White_Balance_Rgb565_Line_C(u16 *pixels, u32 count, u8 red, u8 blue);
+
+void Auto_White_Balance_Print_Stats(const AutoWhiteBalance *awb);
+
+#endif
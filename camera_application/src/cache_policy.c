@@ -0,0 +1,256 @@
+#include "cache_policy.h"
+#include "xil_cache.h"
+#include "xil_mmu.h"
+#include "xpseudo_asm.h"
+#include <string.h>
+
+typedef struct {
+    UINTPTR base;
+    UINTPTR end;
+    CacheMode mode;
+} CacheRegion;
+
+// Sections not in the table are write-back
+static CacheRegion cache_regions[CACHE_MAX_REGIONS];
+static u32 cache_num_regions;
+static CachePolicyStats cache_stats;
+
+static const u32 cache_mode_attr[] = { NORM_WB_CACHE, NORM_WT_CACHE, NORM_NONCACHE };
+static const char *cache_mode_name[] = { "WB", "WT", "NC" };
+
+void Cache_Policy_Init(void)
+{
+    cache_num_regions = 0;
+    cache_stats.range_ops = 0;
+    cache_stats.full_ops = 0;
+    cache_stats.skipped = 0;
+    cache_stats.threshold = CACHE_FULL_THRESHOLD_DEF;
+}
+
+int Cache_Region_SetMode(void *base, u32 bytes, CacheMode mode)
+{
+    UINTPTR start = (UINTPTR)base;
+    u32 i;
+
+    if(bytes == 0 || (start & (CACHE_SECTION - 1U)) != 0 || (bytes & (CACHE_SECTION - 1U)) != 0) return XST_INVALID_PARAM;
+
+    // Nothing of the range may stay in the cache once it is no longer written back
+    Xil_DCacheFlushRange(start, bytes);
+    for(u32 off = 0; off < bytes; off += CACHE_SECTION)
+    {
+        Xil_SetTlbAttributes(start + off, cache_mode_attr[mode]);
+    }
+
+    // Replace an entry for the same range, write-back needs none
+    for(i = 0; i < cache_num_regions; i++)
+    {
+        if(cache_regions[i].base == start && cache_regions[i].end == start + bytes) break;
+    }
+    if(mode == CACHE_MODE_WB)
+    {
+        if(i < cache_num_regions) cache_regions[i] = cache_regions[--cache_num_regions];
+        return XST_SUCCESS;
+    }
+    if(i == cache_num_regions)
+    {
+        if(cache_num_regions == CACHE_MAX_REGIONS) return XST_FAILURE;
+        cache_num_regions++;
+    }
+    cache_regions[i].base = start;
+    cache_regions[i].end = start + bytes;
+    cache_regions[i].mode = mode;
+    return XST_SUCCESS;
+}
+
+CacheMode Cache_Region_GetMode(const void *addr, u32 bytes)
+{
+    UINTPTR start = (UINTPTR)addr;
+
+    for(u32 i = 0; i < cache_num_regions; i++)
+    {
+        if(start < cache_regions[i].base || start >= cache_regions[i].end) continue;
+
+        // Running out of the region reaches write-back memory or another mode, the range needs full maintenance
+        if(bytes > cache_regions[i].end - start) return CACHE_MODE_WB;
+        return cache_regions[i].mode;
+    }
+    return CACHE_MODE_WB;
+}
+
+void Cache_Sync_ForDevice(const void *addr, u32 bytes)
+{
+    if(bytes == 0) return;
+
+    // Write-through lines are never dirty, non-cacheable ones do not exist, only the store buffer is left
+    if(Cache_Region_GetMode(addr, bytes) != CACHE_MODE_WB)
+    {
+        dsb();
+        __atomic_fetch_add(&cache_stats.skipped, 1, __ATOMIC_RELAXED);
+    }
+    else if(bytes >= cache_stats.threshold)
+    {
+        Xil_DCacheFlush();
+        __atomic_fetch_add(&cache_stats.full_ops, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        Xil_DCacheFlushRange((INTPTR)addr, bytes);
+        __atomic_fetch_add(&cache_stats.range_ops, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void Cache_Sync_ForCpu(const void *addr, u32 bytes)
+{
+    if(bytes == 0) return;
+
+    // Write-through regions can still hold stale clean lines, only non-cacheable ones are exempt
+    if(Cache_Region_GetMode(addr, bytes) == CACHE_MODE_NC)
+    {
+        __atomic_fetch_add(&cache_stats.skipped, 1, __ATOMIC_RELAXED);
+    }
+    else if(bytes >= cache_stats.threshold)
+    {
+        // Clean and invalidate, a plain full invalidate would lose everybody else's dirty lines
+        Xil_DCacheFlush();
+        __atomic_fetch_add(&cache_stats.full_ops, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        Xil_DCacheInvalidateRange((INTPTR)addr, bytes);
+        __atomic_fetch_add(&cache_stats.range_ops, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void Cache_Policy_SetThreshold(u32 bytes)
+{
+    cache_stats.threshold = (bytes + CACHE_LINE - 1U) & ~(CACHE_LINE - 1U);
+}
+
+u32 Cache_Policy_GetThreshold(void)
+{
+    return cache_stats.threshold;
+}
+
+static u32 Cache_Ticks_To_Us(XTime ticks)
+{
+    return (u32)(ticks / (COUNTS_PER_SECOND / 1000000));
+}
+
+// Ticks of a range clean over bytes freshly dirtied
+static XTime Cache_Time_RangeClean(u8 *buf, u32 bytes)
+{
+    XTime t0, t1;
+
+    memset(buf, 0xA5, bytes);
+    XTime_GetTime(&t0);
+    Xil_DCacheFlushRange((INTPTR)buf, bytes);
+    XTime_GetTime(&t1);
+    return t1 - t0;
+}
+
+// Ticks of a full clean and invalidate with bytes dirty
+static XTime Cache_Time_Full(u8 *buf, u32 bytes)
+{
+    XTime t0, t1;
+
+    memset(buf, 0x5A, bytes);
+    XTime_GetTime(&t0);
+    Xil_DCacheFlush();
+    XTime_GetTime(&t1);
+    return t1 - t0;
+}
+
+u32 Cache_Policy_Calibrate(void *scratch, u32 bytes)
+{
+    XTime t_range, t_full;
+    u64 threshold;
+
+    if(scratch == NULL || bytes < CACHE_LINE) return cache_stats.threshold;
+
+    t_range = Cache_Time_RangeClean((u8 *)scratch, bytes);
+    t_full = Cache_Time_Full((u8 *)scratch, bytes);
+    if(t_range == 0) return cache_stats.threshold;
+
+    // Range cost grows with the size, the full operation is flat: they meet at t_full / ( t_range / bytes )
+    threshold = ((u64)t_full * bytes) / t_range;
+    if(threshold > 0xFFFFFFFFULL) threshold = 0xFFFFFFFFULL & ~(u64)(CACHE_LINE - 1U);
+    Cache_Policy_SetThreshold((u32)threshold);
+
+    xil_printf("[INFO] Cache calibration: range clean of %u KB %u us, full clean %u us, full from %u KB\n",
+               bytes >> 10, Cache_Ticks_To_Us(t_range), Cache_Ticks_To_Us(t_full), cache_stats.threshold >> 10);
+    return cache_stats.threshold;
+}
+
+// Ticks of a CPU write pass and a read pass over buf
+static void Cache_Time_CpuAccess(u8 *buf, u32 bytes, XTime *t_write, XTime *t_read)
+{
+    volatile u32 sum = 0;
+    const u32 *words = (const u32 *)buf;
+    XTime t0, t1, t2;
+
+    XTime_GetTime(&t0);
+    memset(buf, 0x3C, bytes);
+    XTime_GetTime(&t1);
+    for(u32 i = 0; i < bytes / 4; i++) sum += words[i];
+    XTime_GetTime(&t2);
+
+    *t_write = t1 - t0;
+    *t_read = t2 - t1;
+}
+
+void Cache_Policy_Benchmark(void *section, u32 bytes)
+{
+    u8 *buf = (u8 *)section;
+    XTime t0, t1;
+
+    if(buf == NULL || ((UINTPTR)buf & (CACHE_SECTION - 1U)) != 0 || bytes < CACHE_SECTION)
+    {
+        xil_printf("[ERROR] Cache benchmark needs a section aligned buffer of at least 1 MB\n");
+        return;
+    }
+
+    xil_printf("[INFO] Cache maintenance cost ( us )\n");
+    xil_printf("[INFO]     KB   range clean   range inval   full clean\n");
+    for(u32 size = 4096; size <= bytes; size <<= 2)
+    {
+        XTime t_clean = Cache_Time_RangeClean(buf, size);
+
+        // Lines now clean and absent, the walk itself is what is left
+        XTime_GetTime(&t0);
+        Xil_DCacheInvalidateRange((INTPTR)buf, size);
+        XTime_GetTime(&t1);
+
+        xil_printf("[INFO] %6u  %12u  %12u  %11u\n", size >> 10, Cache_Ticks_To_Us(t_clean),
+                   Cache_Ticks_To_Us(t1 - t0), Cache_Ticks_To_Us(Cache_Time_Full(buf, size)));
+    }
+
+    // The price of skipping maintenance: CPU access to the section under each attribute
+    xil_printf("[INFO] CPU access to %u KB ( us )\n", CACHE_SECTION >> 10);
+    xil_printf("[INFO] mode   write    read\n");
+    for(int mode = CACHE_MODE_WB; mode <= CACHE_MODE_NC; mode++)
+    {
+        XTime t_write, t_read;
+
+        if(Cache_Region_SetMode(buf, CACHE_SECTION, (CacheMode)mode) != XST_SUCCESS) break;
+        Cache_Time_CpuAccess(buf, CACHE_SECTION, &t_write, &t_read);
+        xil_printf("[INFO]   %s  %6u  %6u\n", cache_mode_name[mode], Cache_Ticks_To_Us(t_write), Cache_Ticks_To_Us(t_read));
+    }
+    Cache_Region_SetMode(buf, CACHE_SECTION, CACHE_MODE_WB);
+}
+
+void Cache_Policy_GetStats(CachePolicyStats *stats)
+{
+    stats->range_ops = cache_stats.range_ops;
+    stats->full_ops = cache_stats.full_ops;
+    stats->skipped = cache_stats.skipped;
+    stats->threshold = cache_stats.threshold;
+}
+
+void Cache_Policy_Print_Stats(void)
+{
+    CachePolicyStats stats;
+
+    Cache_Policy_GetStats(&stats);
+    xil_printf("[INFO] Cache syncs: %u range, %u full, %u skipped, full from %u KB\n",
+               stats.range_ops, stats.full_ops, stats.skipped, stats.threshold >> 10);
+}
@@ -0,0 +1,61 @@
+#ifndef __CACHE_POLICY_H__
+#define __CACHE_POLICY_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "xiltimer.h"
+
+/*
+    Cache maintenance for buffers shared with the DMA. Xil_DCache*Range walks L1 and the PL310
+    line by line, ~19k operations for a VGA frame, so above a measured size a full clean and
+    invalidate is cheaper. Regions marked write-through need no clean, non-cacheable ones need
+    nothing at all, at the price of slower CPU access ( see Cache_Policy_Benchmark ).
+*/
+
+#define CACHE_LINE               32U
+#define CACHE_SECTION            0x100000U      // Xil_SetTlbAttributes granularity
+#define CACHE_MAX_REGIONS        4U
+#define CACHE_FULL_THRESHOLD_DEF (256U * 1024U) // Used until Cache_Policy_Calibrate runs
+
+typedef enum {
+    CACHE_MODE_WB,       // Write-back, the default for DDR
+    CACHE_MODE_WT,       // Write-through, never dirty
+    CACHE_MODE_NC,       // Non-cacheable
+} CacheMode;
+
+typedef struct {
+    u32 range_ops;       // Syncs done line by line
+    u32 full_ops;        // Syncs done with a full clean and invalidate
+    u32 skipped;         // Syncs the region attributes made unnecessary
+    u32 threshold;       // Bytes from which a sync goes full
+} CachePolicyStats;
+
+void Cache_Policy_Init(void);
+
+// Change the attributes of 1 MB sections, base and bytes section aligned. The range is cleaned first.
+int Cache_Region_SetMode(void *base, u32 bytes, CacheMode mode);
+
+// Mode of [addr, addr + bytes), write-back unless the whole range lies inside one region
+CacheMode Cache_Region_GetMode(const void *addr, u32 bytes);
+
+// Before the DMA reads or writes the range: dirty lines to DDR and out of the cache
+void Cache_Sync_ForDevice(const void *addr, u32 bytes);
+
+// After the DMA wrote the range: drop lines the CPU may have pulled in meanwhile
+void Cache_Sync_ForCpu(const void *addr, u32 bytes);
+
+// Size from which syncs use the full operation
+void Cache_Policy_SetThreshold(u32 bytes);
+u32 Cache_Policy_GetThreshold(void);
+
+// Time a range clean of a dirty scratch buffer against a full clean, set and return the break-even size
+u32 Cache_Policy_Calibrate(void *scratch, u32 bytes);
+
+// Cost of every option for sizes up to bytes, section must be section aligned scratch of at least 1 MB
+void Cache_Policy_Benchmark(void *section, u32 bytes);
+
+void Cache_Policy_GetStats(CachePolicyStats *stats);
+void Cache_Policy_Print_Stats(void);
+
+#endif
@@ -0,0 +1,311 @@
+#include "capture.h"
+#include "xil_cache.h"
+#include "cache_policy.h"
+
+// Frames nobody has a buffer for still have to be drained from the FIFO, every line lands here
+static u8 capture_drop_line[CAPTURE_MAX_LINE_BYTES] __attribute__((aligned(FRAME_ALIGN)));
+
+// Handoff event a slot's program waits on before its first line
+static u8 Capture_Event(CaptureSlot *slot)
+{
+    return (u8)(DMA_EVENT_HANDOFF_BASE + slot->channel);
+}
+
+/*
+    Channel program for one frame:
+
+        DMAMOV CCR / SAR / DAR
+        DMAWFE  own handoff event           ( DMANOPs on the very first frame )
+        DMAFLUSHP
+        per segment of up to 256 lines:
+            DMALP lines
+                DMAWFP periph               one FIFO request per line
+                DMALP bursts
+                    DMALD, DMAST
+                DMALPEND
+                DMAADDH DAR, stride pad     ( DMAMOV DAR drop line when dropping )
+            DMALPEND
+        DMAWMB
+        DMASEV  other slot's handoff event, it starts on the next line request
+        DMASEV  own channel, done interrupt
+        DMAEND
+*/
+static int Capture_Build(Capture *cap, CaptureSlot *slot, CaptureProgKind kind)
+{
+    CaptureSlot *other = &cap->slots[(slot == &cap->slots[0]) ? 1 : 0];
+    u32 burst_bytes = cap->chan_ctrl.DstBurstSize * cap->chan_ctrl.DstBurstLen;
+    u32 bursts = cap->line_bytes / burst_bytes;
+    u32 pad = cap->cfg.dst_stride - cap->line_bytes;
+    u32 drop_line = (u32)(UINTPTR)capture_drop_line;
+    DmaProg prog;
+
+    Dma_Prog_Init(&prog, slot->prog[kind], CAPTURE_PROG_LEN);
+    Dma_Prog_Mov(&prog, DMA_REG_CCR, Dma_Ccr(&cap->chan_ctrl));
+    Dma_Prog_Mov(&prog, DMA_REG_SAR, (u32)cap->cfg.fifo_addr);
+    slot->dar_off[kind] = (u16)Dma_Prog_Mov(&prog, DMA_REG_DAR, drop_line);
+    slot->wfe_off[kind] = (u16)Dma_Prog_Wfe(&prog, Capture_Event(slot));
+    Dma_Prog_FlushP(&prog, cap->cfg.periph);
+
+    for(u32 line = 0; line < cap->cfg.height; line += 256)
+    {
+        u32 lines = cap->cfg.height - line;
+        if(lines > 256) lines = 256;
+
+        int outer = Dma_Prog_Lp(&prog, 1, lines);
+        Dma_Prog_WfP(&prog, cap->cfg.periph);
+        int inner = Dma_Prog_Lp(&prog, 0, bursts);
+        Dma_Prog_Ld(&prog);
+        Dma_Prog_St(&prog);
+        Dma_Prog_LpEnd(&prog, 0, inner);
+        if(kind == CAPTURE_PROG_DROP) Dma_Prog_Mov(&prog, DMA_REG_DAR, drop_line);
+        else if(pad != 0) Dma_Prog_AddH(&prog, DMA_REG_DAR, (u16)pad);
+        Dma_Prog_LpEnd(&prog, 1, outer);
+    }
+
+    Dma_Prog_Wmb(&prog);
+    Dma_Prog_Sev(&prog, Capture_Event(other));
+    Dma_Prog_Sev(&prog, (u8)slot->channel);
+    Dma_Prog_End(&prog);
+
+    if(prog.overflow)
+    {
+        xil_printf("[ERROR] Capture program does not fit in %d bytes\n", CAPTURE_PROG_LEN);
+        return XST_FAILURE;
+    }
+    slot->prog_len[kind] = (u16)prog.len;
+    Xil_DCacheFlushRange((INTPTR)slot->prog[kind], prog.len);
+    return XST_SUCCESS;
+}
+
+// Give a slot a new buffer and start its channel, wait = FALSE lets it run without the handoff
+static int Capture_Arm(Capture *cap, CaptureSlot *slot, int wait)
+{
+    XDmaPs_Cmd *cmd = &slot->cmd;
+    CaptureProgKind kind;
+    u8 *prog;
+    u32 dst, length;
+    int status;
+
+    slot->buf = FramePool_Alloc(cap->pool);
+    if(slot->buf != NULL)
+    {
+        kind = CAPTURE_PROG_FRAME;
+        dst = (u32)(UINTPTR)slot->buf->data;
+        length = cap->frame_bytes;
+    }
+    else
+    {
+        kind = CAPTURE_PROG_DROP;
+        dst = (u32)(UINTPTR)capture_drop_line;
+        length = cap->line_bytes;
+    }
+
+    // DAR and the handoff wait sit next to each other, one cache line to clean
+    prog = slot->prog[kind];
+    Dma_Prog_Patch32(prog, slot->dar_off[kind], dst);
+    Dma_Prog_SetWfe(prog, slot->wfe_off[kind], Capture_Event(slot), wait);
+    Xil_DCacheFlushRange((INTPTR)prog + slot->dar_off[kind], slot->wfe_off[kind] + 2 - slot->dar_off[kind]);
+
+    // No dirty line may be evicted over the frame while the DMA writes it, the driver's own range walk is skipped
+    Cache_Sync_ForDevice((const void *)(UINTPTR)dst, length);
+    cmd->ChanCtrl = cap->chan_ctrl;
+    cmd->ChanCtrl.DstInc = 0;
+    cmd->BD.SrcAddr = (u32)cap->cfg.fifo_addr;
+    cmd->BD.DstAddr = dst;
+    cmd->BD.Length = length;
+    cmd->UserDmaProg = prog;
+    cmd->UserDmaProgLength = slot->prog_len[kind];
+    cmd->GeneratedDmaProg = NULL;
+    cmd->GeneratedDmaProgLength = 0;
+
+    status = Dma_Channel_WaitStopped(cap->dma, slot->channel);
+    if(status == XST_SUCCESS) status = XDmaPs_Start(&cap->dma->dma_instance, slot->channel, cmd, TRUE);
+    if(status != XST_SUCCESS)
+    {
+        // Also runs from the done and fault interrupts, only counted here, Capture_Start reports its own
+        cap->stats.arm_errors++;
+        if(slot->buf != NULL) FrameBuf_Release(slot->buf);
+        slot->buf = NULL;
+    }
+    return status;
+}
+
+static void Capture_DoneHandler(unsigned int channel, XDmaPs_Cmd *cmd, void *callback_ref)
+{
+    CaptureSlot *slot = (CaptureSlot *)callback_ref;
+    Capture *cap = slot->cap;
+    CaptureSlot *other = &cap->slots[(slot == &cap->slots[0]) ? 1 : 0];
+    FrameBuf *buf = slot->buf;
+    (void)channel;
+    (void)cmd;
+
+    slot->buf = NULL;
+    if(buf != NULL)
+    {
+        // Lines the A9 speculatively pulled in while the DMA was writing are stale
+        Cache_Sync_ForCpu(buf->data, cap->frame_bytes);
+
+        buf->width = cap->cfg.width;
+        buf->height = cap->cfg.height;
+        buf->stride = cap->cfg.dst_stride;
+        buf->format = cap->cfg.format;
+        buf->sequence = cap->sequence;
+        XTime_GetTime(&buf->timestamp);
+
+        FrameRing_Publish(cap->ring, buf);
+        cap->stats.frames++;
+    }
+    else
+    {
+        cap->stats.dropped++;
+    }
+    cap->sequence++;
+
+    if(!cap->running) return;
+
+    // The other channel consumed the event already, ours will start on the next frame immediately
+    if(!XDmaPs_IsActive(&cap->dma->dma_instance, other->channel)) cap->stats.late_arms++;
+
+    Capture_Arm(cap, slot, TRUE);
+}
+
+// The driver killed the channel, restart it without the handoff so the ping-pong keeps going
+static void Capture_FaultHandler(unsigned channel, XDmaPs_Cmd *cmd, void *callback_ref)
+{
+    CaptureSlot *slot = (CaptureSlot *)callback_ref;
+    Capture *cap = slot->cap;
+    (void)channel;
+    (void)cmd;
+
+    cap->stats.faults++;
+    if(slot->buf != NULL) FrameBuf_Release(slot->buf);
+    slot->buf = NULL;
+
+    if(cap->running) Capture_Arm(cap, slot, FALSE);
+}
+
+int Capture_Init(Capture *cap, DmaCtrl *dma, FramePool *pool, FrameRing *ring, const CaptureConfig *cfg)
+{
+    u32 beats;
+
+    cap->dma = dma;
+    cap->pool = pool;
+    cap->ring = ring;
+    cap->cfg = *cfg;
+    cap->running = FALSE;
+    cap->sequence = 0;
+    cap->stats.frames = 0;
+    cap->stats.dropped = 0;
+    cap->stats.late_arms = 0;
+    cap->stats.faults = 0;
+    cap->stats.arm_errors = 0;
+
+    cap->line_bytes = (u32)cfg->width * cfg->bytes_per_pixel;
+    if(cap->cfg.dst_stride == 0) cap->cfg.dst_stride = (u16)cap->line_bytes;
+    cap->frame_bytes = (u32)cap->cfg.dst_stride * cfg->height;
+
+    if(cap->line_bytes == 0 || cap->line_bytes > CAPTURE_MAX_LINE_BYTES || cap->line_bytes % CAPTURE_BEAT_BYTES != 0 ||
+       cap->cfg.dst_stride < cap->line_bytes || cfg->height == 0)
+    {
+        xil_printf("[ERROR] Unsupported capture geometry %ux%u, stride: %u\n", cfg->width, cfg->height, cap->cfg.dst_stride);
+        return XST_INVALID_PARAM;
+    }
+    if(cap->frame_bytes > pool->block_size)
+    {
+        xil_printf("[ERROR] Capture frame of %u bytes does not fit pool %s blocks\n", cap->frame_bytes, pool->name);
+        return XST_INVALID_PARAM;
+    }
+    if(cfg->channels[0] >= DMA_NUM_CHANNELS || cfg->channels[1] >= DMA_NUM_CHANNELS || cfg->channels[0] == cfg->channels[1])
+    {
+        return XST_INVALID_PARAM;
+    }
+
+    // Fixed FIFO source, incrementing destination, bursts as long as the line allows
+    beats = cap->line_bytes / CAPTURE_BEAT_BYTES;
+    cap->chan_ctrl.SrcBurstSize = CAPTURE_BEAT_BYTES;
+    cap->chan_ctrl.SrcBurstLen = Dma_BurstLen(cap->line_bytes, CAPTURE_BEAT_BYTES);
+    cap->chan_ctrl.SrcInc = 0;
+    cap->chan_ctrl.DstBurstSize = CAPTURE_BEAT_BYTES;
+    cap->chan_ctrl.DstBurstLen = cap->chan_ctrl.SrcBurstLen;
+    cap->chan_ctrl.DstInc = 1;
+    cap->chan_ctrl.EndianSwapSize = 0;
+    cap->chan_ctrl.SrcCacheCtrl = 0;
+    cap->chan_ctrl.DstCacheCtrl = 0;
+    cap->chan_ctrl.SrcProtCtrl = 0;
+    cap->chan_ctrl.DstProtCtrl = 0;
+    if(beats / cap->chan_ctrl.DstBurstLen > 256) return XST_INVALID_PARAM;
+
+    for(u32 i = 0; i < CAPTURE_SLOTS; i++)
+    {
+        CaptureSlot *slot = &cap->slots[i];
+        slot->cap = cap;
+        slot->channel = cfg->channels[i];
+        slot->buf = NULL;
+    }
+    for(u32 i = 0; i < CAPTURE_SLOTS; i++)
+    {
+        CaptureSlot *slot = &cap->slots[i];
+        for(int kind = 0; kind < CAPTURE_PROG_COUNT; kind++)
+        {
+            if(Capture_Build(cap, slot, (CaptureProgKind)kind) != XST_SUCCESS) return XST_FAILURE;
+        }
+        XDmaPs_SetDoneHandler(&dma->dma_instance, slot->channel, Capture_DoneHandler, slot);
+        Dma_SetFaultCallback(dma, slot->channel, Capture_FaultHandler, slot);
+    }
+
+    xil_printf("[INFO] Capture %ux%u, %u byte lines in %u byte bursts, channels %u/%u\n", cfg->width, cfg->height,
+               cap->line_bytes, cap->chan_ctrl.DstBurstSize * cap->chan_ctrl.DstBurstLen, cfg->channels[0], cfg->channels[1]);
+    return XST_SUCCESS;
+}
+
+int Capture_Start(Capture *cap)
+{
+    int status;
+
+    cap->running = TRUE;
+
+    // Second channel first so its WFE is in place before the first one can signal it
+    status = Capture_Arm(cap, &cap->slots[1], TRUE);
+    if(status == XST_SUCCESS) status = Capture_Arm(cap, &cap->slots[0], FALSE);
+    if(status != XST_SUCCESS)
+    {
+        xil_printf("[ERROR] Failed to start capture with status: %d\n", status);
+        Capture_Stop(cap);
+        return status;
+    }
+    return XST_SUCCESS;
+}
+
+void Capture_Stop(Capture *cap)
+{
+    cap->running = FALSE;
+
+    for(u32 i = 0; i < CAPTURE_SLOTS; i++)
+    {
+        CaptureSlot *slot = &cap->slots[i];
+
+        Dma_Channel_Lock(cap->dma, slot->channel);
+        XDmaPs_ResetChannel(&cap->dma->dma_instance, slot->channel);
+        if(slot->buf != NULL) FrameBuf_Release(slot->buf);
+        slot->buf = NULL;
+        Dma_Channel_Unlock(cap->dma, slot->channel);
+    }
+}
+
+void Capture_GetStats(Capture *cap, CaptureStats *stats)
+{
+    stats->frames = cap->stats.frames;
+    stats->dropped = cap->stats.dropped;
+    stats->late_arms = cap->stats.late_arms;
+    stats->faults = cap->stats.faults;
+    stats->arm_errors = cap->stats.arm_errors;
+}
+
+void Capture_Print_Stats(Capture *cap)
+{
+    CaptureStats stats;
+
+    Capture_GetStats(cap, &stats);
+    xil_printf("[INFO] Capture: %u frames, %u dropped, %u late arms, %u faults, %u arm errors\n",
+               stats.frames, stats.dropped, stats.late_arms, stats.faults, stats.arm_errors);
+}
@@ -0,0 +1,85 @@
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include "dma_helper.h"
+#include "frame_pool.h"
+#include "frame_ring.h"
+
+/*
+    Frame capture from the PL pixel FIFO into pool buffers with the PS DMA ( PL330 ).
+    Two channels alternate frames: while one moves frame N line by line, the other is
+    already armed with a fresh buffer and waits on a DMAC event that the first fires at
+    its end of frame, so the CPU only hands over finished buffers and re-arms.
+*/
+
+#define CAPTURE_SLOTS          2U     // Channels in the ping-pong
+#define CAPTURE_PROG_LEN       192U   // Bytes per channel program, up to 8 line segments
+#define CAPTURE_MAX_LINE_BYTES 1280U  // VGA at 2 bytes per pixel, also the drop line size
+#define CAPTURE_BEAT_BYTES     8U     // 64 bit AXI beats
+
+typedef struct {
+    UINTPTR fifo_addr;      // AXI address of the PL pixel FIFO read port, fixed source
+    u8  periph;             // PL330 peripheral request from the FIFO ( 0..3 ), one request per line
+    u16 width;
+    u16 height;
+    u8  bytes_per_pixel;
+    u8  format;             // OV7670_Format, carried into the frames
+    u16 dst_stride;         // Bytes between lines in the buffer, 0 for packed lines
+    unsigned channels[CAPTURE_SLOTS];
+} CaptureConfig;
+
+typedef struct {
+    u32 frames;             // Frames published to the ring
+    u32 dropped;            // Frames captured into the drop line because the pool was empty
+    u32 late_arms;          // Re-arm happened after the other channel had already finished
+    u32 faults;             // Channel faults, the frame is lost and the channel restarted
+    u32 arm_errors;         // Re-arms the driver refused, the slot stays idle until the next start
+} CaptureStats;
+
+typedef struct Capture Capture;
+
+// Per slot programs, built once by Capture_Init, re-arming only patches them
+typedef enum {
+    CAPTURE_PROG_FRAME,     // Lines into a pool buffer, DAR patched per frame
+    CAPTURE_PROG_DROP,      // Every line into the drop line
+    CAPTURE_PROG_COUNT
+} CaptureProgKind;
+
+typedef struct {
+    Capture *cap;
+    unsigned channel;
+    FrameBuf *buf;          // Frame being filled, NULL when writing into the drop line
+    XDmaPs_Cmd cmd;
+    u16 prog_len[CAPTURE_PROG_COUNT];
+    u16 dar_off[CAPTURE_PROG_COUNT];
+    u16 wfe_off[CAPTURE_PROG_COUNT];
+    u8 prog[CAPTURE_PROG_COUNT][CAPTURE_PROG_LEN] __attribute__((aligned(FRAME_ALIGN)));
+} CaptureSlot;
+
+struct Capture {
+    DmaCtrl *dma;
+    FramePool *pool;
+    FrameRing *ring;
+    CaptureConfig cfg;
+    u32 line_bytes;
+    u32 frame_bytes;
+    XDmaPs_ChanCtrl chan_ctrl;
+    CaptureSlot slots[CAPTURE_SLOTS];
+    volatile u32 running;
+    u32 sequence;           // Sensor frames seen, dropped ones included
+    volatile CaptureStats stats;
+};
+
+// Validate the geometry against the pool and the DMA limits and build the channel programs, no hardware access
+int Capture_Init(Capture *cap, DmaCtrl *dma, FramePool *pool, FrameRing *ring, const CaptureConfig *cfg);
+
+// Arm both channels, the first one starts with the next line requests from the FIFO
+int Capture_Start(Capture *cap);
+
+// Kill both channels, a frame in flight is lost and its buffer returned
+void Capture_Stop(Capture *cap);
+
+void Capture_GetStats(Capture *cap, CaptureStats *stats);
+void Capture_Print_Stats(Capture *cap);
+
+#endif
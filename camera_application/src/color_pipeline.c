@@ -0,0 +1,347 @@
+#include "color_pipeline.h"
+#include <string.h>
+
+#ifdef PIX_NEON
+#include <arm_neon.h>
+#endif
+
+#define COLOR_PIPELINE_PREFETCH 128U
+
+// BT.601 luma weights in Q8, the same as the gray conversions
+static const s16 color_pipeline_luma[COLOR_PIPELINE_CHANNELS] = { 77, 150, 29 };
+
+// 2 ^ -( 1 / 2 ^ k ) in Q30 for k = 1 .. 16, one per fraction bit of a Q16 exponent
+static const u32 color_pipeline_exp2[16] = {
+    759250125U, 902905651U, 984625594U, 1028218693U, 1050733751U, 1062175491U, 1067942999U, 1070838486U,
+    1072289173U, 1073015252U, 1073378477U, 1073560135U, 1073650976U, 1073696399U, 1073719111U, 1073730468U,
+};
+
+// --------------------------------------- Scalar references ------------------------------------------
+
+static inline u8 Color_Pipeline_Clamp(s32 x)
+{
+    return (u8)(x < 0 ? 0 : (x > 255 ? 255 : x));
+}
+
+// Matrix then LUT for one pixel, the rounding matches the NEON narrowing shift
+static inline void Color_Pipeline_Pixel(const ColorPipelineTables *t, u32 r, u32 g, u32 b, u8 out[COLOR_PIPELINE_CHANNELS])
+{
+    for(u32 c = 0; c < COLOR_PIPELINE_CHANNELS; c++)
+    {
+        s32 acc = t->matrix[c][0] * (s32)r + t->matrix[c][1] * (s32)g + t->matrix[c][2] * (s32)b;
+
+        out[c] = t->lut[c][Color_Pipeline_Clamp((acc + (COLOR_PIPELINE_ONE / 2)) >> COLOR_PIPELINE_SHIFT)];
+    }
+}
+
+void Color_Pipeline_Rgb888_Line_C(u8 *dst, const u8 *src, u32 count, const ColorPipelineTables *t)
+{
+    for(u32 i = 0; i < count; i++, src += 3, dst += 3)
+    {
+        u8 out[COLOR_PIPELINE_CHANNELS];
+
+        Color_Pipeline_Pixel(t, src[0], src[1], src[2], out);
+        dst[0] = out[0];
+        dst[1] = out[1];
+        dst[2] = out[2];
+    }
+}
+
+void Color_Pipeline_Rgb565_Line_C(u16 *dst, const u16 *src, u32 count, const ColorPipelineTables *t)
+{
+    for(u32 i = 0; i < count; i++)
+    {
+        u32 p = src[i], r = p >> 11, g = (p >> 5) & 0x3FU, b = p & 0x1FU;
+        u8 out[COLOR_PIPELINE_CHANNELS];
+
+        // Expanded like Pix_Rgb565ToRgb888_Line, truncated back like Pix_Rgb888ToRgb565_Line
+        Color_Pipeline_Pixel(t, (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), out);
+        dst[i] = (u16)(((u32)(out[0] >> 3) << 11) | ((u32)(out[1] >> 2) << 5) | (u32)(out[2] >> 3));
+    }
+}
+
+// --------------------------------------- NEON kernels -----------------------------------------------
+
+#ifdef PIX_NEON
+// One output channel of the matrix for 8 pixels, rounded and clamped to 0 .. 255
+static inline uint8x8_t Color_Pipeline_Neon_Row(int16x8_t r, int16x8_t g, int16x8_t b, const s16 row[COLOR_PIPELINE_CHANNELS])
+{
+    int32x4_t lo = vmull_n_s16(vget_low_s16(r), row[0]);
+    int32x4_t hi = vmull_n_s16(vget_high_s16(r), row[0]);
+
+    lo = vmlal_n_s16(lo, vget_low_s16(g), row[1]);
+    hi = vmlal_n_s16(hi, vget_high_s16(g), row[1]);
+    lo = vmlal_n_s16(lo, vget_low_s16(b), row[2]);
+    hi = vmlal_n_s16(hi, vget_high_s16(b), row[2]);
+    return vqmovun_s16(vcombine_s16(vqrshrn_n_s32(lo, COLOR_PIPELINE_SHIFT), vqrshrn_n_s32(hi, COLOR_PIPELINE_SHIFT)));
+}
+
+static inline uint8x8x3_t Color_Pipeline_Neon_Pixels(uint8x8x3_t p, const ColorPipelineTables *t)
+{
+    if(!t->unit_matrix)
+    {
+        int16x8_t r = vreinterpretq_s16_u16(vmovl_u8(p.val[0]));
+        int16x8_t g = vreinterpretq_s16_u16(vmovl_u8(p.val[1]));
+        int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(p.val[2]));
+
+        p.val[0] = Color_Pipeline_Neon_Row(r, g, b, t->matrix[0]);
+        p.val[1] = Color_Pipeline_Neon_Row(r, g, b, t->matrix[1]);
+        p.val[2] = Color_Pipeline_Neon_Row(r, g, b, t->matrix[2]);
+    }
+    if(!t->unit_lut)
+    {
+        // No 256 entry table lookup on ARMv7, the indices go through a block in L1
+        u8 block[COLOR_PIPELINE_CHANNELS][8];
+
+        for(u32 c = 0; c < COLOR_PIPELINE_CHANNELS; c++)
+        {
+            const u8 *lut = t->lut[c];
+
+            vst1_u8(block[c], p.val[c]);
+            for(u32 i = 0; i < 8; i++) block[c][i] = lut[block[c][i]];
+            p.val[c] = vld1_u8(block[c]);
+        }
+    }
+    return p;
+}
+#endif
+
+void Color_Pipeline_Rgb888_Line(u8 *dst, const u8 *src, u32 count, const ColorPipelineTables *t)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 8 <= count; i += 8)
+    {
+        __builtin_prefetch(src + 3 * i + COLOR_PIPELINE_PREFETCH);
+        vst3_u8(dst + 3 * i, Color_Pipeline_Neon_Pixels(vld3_u8(src + 3 * i), t));
+    }
+#endif
+    Color_Pipeline_Rgb888_Line_C(dst + 3 * i, src + 3 * i, count - i, t);
+}
+
+void Color_Pipeline_Rgb565_Line(u16 *dst, const u16 *src, u32 count, const ColorPipelineTables *t)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 8 <= count; i += 8)
+    {
+        __builtin_prefetch((const u8 *)(src + i) + COLOR_PIPELINE_PREFETCH);
+        uint16x8_t p = vld1q_u16(src + i);
+        uint8x8x3_t rgb;
+
+        // Fields to the top of a byte, their top bits repeated below
+        rgb.val[0] = vshrn_n_u16(p, 8);
+        rgb.val[1] = vshrn_n_u16(vshlq_n_u16(p, 5), 8);
+        rgb.val[2] = vshrn_n_u16(vshlq_n_u16(p, 11), 8);
+        rgb.val[0] = vsri_n_u8(rgb.val[0], rgb.val[0], 5);
+        rgb.val[1] = vsri_n_u8(rgb.val[1], rgb.val[1], 6);
+        rgb.val[2] = vsri_n_u8(rgb.val[2], rgb.val[2], 5);
+
+        rgb = Color_Pipeline_Neon_Pixels(rgb, t);
+
+        p = vshll_n_u8(rgb.val[0], 8);
+        p = vsriq_n_u16(p, vshll_n_u8(rgb.val[1], 8), 5);
+        p = vsriq_n_u16(p, vshll_n_u8(rgb.val[2], 8), 11);
+        vst1q_u16(dst + i, p);
+    }
+#endif
+    Color_Pipeline_Rgb565_Line_C(dst + i, src + i, count - i, t);
+}
+
+// --------------------------------------- Tables -----------------------------------------------------
+
+static void Color_Pipeline_Unit(ColorPipelineTables *t)
+{
+    u32 unit = TRUE;
+
+    for(u32 c = 0; c < COLOR_PIPELINE_CHANNELS; c++)
+        for(u32 k = 0; k < COLOR_PIPELINE_CHANNELS; k++)
+            if(t->matrix[c][k] != (c == k ? COLOR_PIPELINE_ONE : 0)) unit = FALSE;
+    t->unit_matrix = (u8)unit;
+
+    unit = TRUE;
+    for(u32 c = 0; c < COLOR_PIPELINE_CHANNELS; c++)
+        for(u32 x = 0; x < 256; x++)
+            if(t->lut[c][x] != x) unit = FALSE;
+    t->unit_lut = (u8)unit;
+}
+
+// The set edited by Color_Pipeline_Set_*, it starts as a copy of the active one unless edits are pending
+static ColorPipelineTables *Color_Pipeline_Spare(ColorPipeline *cp)
+{
+    ColorPipelineTables *spare = &cp->tables[cp->active ^ 1U];
+
+    if(!cp->pending)
+    {
+        memcpy(spare, &cp->tables[cp->active], sizeof(*spare));
+        cp->pending = TRUE;
+    }
+    return spare;
+}
+
+int Color_Pipeline_Init(ColorPipeline *cp)
+{
+    ColorPipelineTables *t;
+
+    if(cp == NULL) return XST_INVALID_PARAM;
+
+    memset(cp, 0, sizeof(*cp));
+    t = &cp->tables[0];
+    for(u32 c = 0; c < COLOR_PIPELINE_CHANNELS; c++)
+    {
+        t->matrix[c][c] = COLOR_PIPELINE_ONE;
+        for(u32 x = 0; x < 256; x++) t->lut[c][x] = (u8)x;
+    }
+    t->unit_matrix = TRUE;
+    t->unit_lut = TRUE;
+    return XST_SUCCESS;
+}
+
+int Color_Pipeline_Set_Matrix(ColorPipeline *cp, const s16 matrix[COLOR_PIPELINE_CHANNELS][COLOR_PIPELINE_CHANNELS])
+{
+    ColorPipelineTables *t;
+
+    if(cp == NULL || matrix == NULL) return XST_INVALID_PARAM;
+    for(u32 c = 0; c < COLOR_PIPELINE_CHANNELS; c++)
+    {
+        for(u32 k = 0; k < COLOR_PIPELINE_CHANNELS; k++)
+        {
+            if(matrix[c][k] > COLOR_PIPELINE_COEFF_MAX || matrix[c][k] < -COLOR_PIPELINE_COEFF_MAX)
+            {
+                xil_printf("[ERROR] Color pipeline: matrix coefficient %d out of range\n", matrix[c][k]);
+                return XST_INVALID_PARAM;
+            }
+        }
+    }
+
+    t = Color_Pipeline_Spare(cp);
+    memcpy(t->matrix, matrix, sizeof(t->matrix));
+    Color_Pipeline_Unit(t);
+    return XST_SUCCESS;
+}
+
+int Color_Pipeline_Set_Lut(ColorPipeline *cp, const u8 *red, const u8 *green, const u8 *blue)
+{
+    const u8 *luts[COLOR_PIPELINE_CHANNELS] = { red, green, blue };
+    ColorPipelineTables *t;
+
+    if(cp == NULL) return XST_INVALID_PARAM;
+
+    t = Color_Pipeline_Spare(cp);
+    for(u32 c = 0; c < COLOR_PIPELINE_CHANNELS; c++)
+        if(luts[c] != NULL) memcpy(t->lut[c], luts[c], sizeof(t->lut[c]));
+    Color_Pipeline_Unit(t);
+    return XST_SUCCESS;
+}
+
+// log2( x ) in Q16 for x >= 1, one result bit per squaring of the normalised mantissa
+static u32 Color_Pipeline_Log2(u32 x)
+{
+    u32 n = 0, result;
+    u64 v;
+
+    while((x >> n) > 1U) n++;
+    v = (u64)x << (30U - n);
+    result = n << 16;
+    for(u32 bit = 1U << 15; bit != 0; bit >>= 1)
+    {
+        v = (v * v) >> 30;
+        if(v >= (2ULL << 30))
+        {
+            v >>= 1;
+            result |= bit;
+        }
+    }
+    return result;
+}
+
+// 2 ^ -e in Q30 for e in Q16
+static u32 Color_Pipeline_Exp2_Neg(u32 e)
+{
+    u64 v = 1ULL << 30;
+
+    if((e >> 16) >= 31U) return 0;
+    for(u32 k = 0; k < 16; k++)
+        if(e & (1U << (15U - k))) v = (v * color_pipeline_exp2[k] + (1ULL << 29)) >> 30;
+    return (u32)(v >> (e >> 16));
+}
+
+void Color_Pipeline_Gamma_Lut(u8 lut[256], u32 gamma)
+{
+    u32 full = Color_Pipeline_Log2(255U);
+
+    if(gamma == 0) gamma = COLOR_PIPELINE_ONE;
+    lut[0] = 0;
+    for(u32 x = 1; x < 256; x++)
+    {
+        // log2( x / 255 ) / gamma, as a positive exponent of 1 / 2
+        u32 e = (u32)(((u64)(full - Color_Pipeline_Log2(x)) * COLOR_PIPELINE_ONE + gamma / 2U) / gamma);
+
+        lut[x] = (u8)((255ULL * Color_Pipeline_Exp2_Neg(e) + (1ULL << 29)) >> 30);
+    }
+}
+
+void Color_Pipeline_Saturation_Matrix(s16 matrix[COLOR_PIPELINE_CHANNELS][COLOR_PIPELINE_CHANNELS], u32 saturation)
+{
+    s32 gray = COLOR_PIPELINE_ONE - (s32)(saturation > 4U * COLOR_PIPELINE_ONE ? 4U * COLOR_PIPELINE_ONE : saturation);
+
+    // Off diagonal terms pull towards luma, the diagonal takes the rest so every row sums to 1.0
+    for(u32 c = 0; c < COLOR_PIPELINE_CHANNELS; c++)
+    {
+        s32 row = 0;
+
+        for(u32 k = 0; k < COLOR_PIPELINE_CHANNELS; k++)
+        {
+            s32 term = gray * color_pipeline_luma[k];
+
+            matrix[c][k] = (s16)((term + (term < 0 ? -COLOR_PIPELINE_ONE / 2 : COLOR_PIPELINE_ONE / 2)) / COLOR_PIPELINE_ONE);
+            if(k != c) row += matrix[c][k];
+        }
+        matrix[c][c] = (s16)(COLOR_PIPELINE_ONE - row);
+    }
+}
+
+// --------------------------------------- Frames -----------------------------------------------------
+
+int Color_Pipeline_Frame(ColorPipeline *cp, PixImage *img)
+{
+    const ColorPipelineTables *t;
+
+    if(cp == NULL || img == NULL) return XST_INVALID_PARAM;
+    if(img->format != PIX_FMT_RGB888 && img->format != PIX_FMT_RGB565) return XST_NO_FEATURE;
+
+    // New tables only between frames
+    if(cp->pending)
+    {
+        cp->active ^= 1U;
+        cp->pending = FALSE;
+        cp->stats.swaps++;
+    }
+    t = &cp->tables[cp->active];
+    if(t->unit_matrix && t->unit_lut)
+    {
+        cp->stats.skipped++;
+        return XST_SUCCESS;
+    }
+
+    for(u32 y = 0; y < img->height; y++)
+    {
+        u8 *line = img->planes[0] + y * img->strides[0];
+
+        if(img->format == PIX_FMT_RGB888) Color_Pipeline_Rgb888_Line(line, line, img->width, t);
+        else Color_Pipeline_Rgb565_Line((u16 *)line, (const u16 *)line, img->width, t);
+    }
+    cp->stats.frames++;
+    return XST_SUCCESS;
+}
+
+void Color_Pipeline_Print_Stats(const ColorPipeline *cp)
+{
+    const ColorPipelineTables *t = &cp->tables[cp->active];
+
+    xil_printf("[INFO] Color pipeline: %s matrix, %s LUTs%s\n", t->unit_matrix ? "unit" : "custom", t->unit_lut ? "unit" : "custom",
+               cp->pending ? ", new tables pending" : "");
+    xil_printf("[INFO]   %u frames corrected, %u left alone, %u table swaps\n", cp->stats.frames, cp->stats.skipped, cp->stats.swaps);
+}
@@ -0,0 +1,80 @@
+#ifndef __COLOR_PIPELINE_H__
+#define __COLOR_PIPELINE_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "pixel_convert.h"
+
+/*
+    Colour correction and tone stage for RGB888 / RGB565 frames, in place and in one pass:
+
+        out[c] = lut[c][ clamp( sum over k of matrix[c][k] * in[k] ) ]
+
+    The 3x3 matrix is Q8 ( 256 = 1.0, rows summing to 256 keep white white ), the per channel
+    LUTs carry gamma or any other tone curve. Everything is integer, the VFP is never touched per
+    pixel. NEON works out the matrix for 8 pixels at a time. ARMv7 has no 256 entry table lookup,
+    so the LUT is read with scalar loads from a block on the stack, still inside the same pass.
+
+    Tables are double buffered: Color_Pipeline_Set_* edit the spare set and the next
+    Color_Pipeline_Frame switches to it, so a frame never mixes old and new tables. Unit matrix
+    plus unit LUTs costs nothing, the frame is left alone.
+*/
+
+#define COLOR_PIPELINE_SHIFT      8
+#define COLOR_PIPELINE_ONE        (1 << COLOR_PIPELINE_SHIFT)   // 1.0 in Q8
+#define COLOR_PIPELINE_COEFF_MAX  2047                          // |coefficient|, just under 8.0
+#define COLOR_PIPELINE_GAMMA_SRGB 563                           // 2.2 in Q8
+
+typedef enum {
+    COLOR_PIPELINE_RED,
+    COLOR_PIPELINE_GREEN,
+    COLOR_PIPELINE_BLUE,
+    COLOR_PIPELINE_CHANNELS,
+} ColorPipelineChannel;
+
+// One complete set, what a frame is processed with
+typedef struct {
+    s16 matrix[COLOR_PIPELINE_CHANNELS][COLOR_PIPELINE_CHANNELS];   // [out][in], Q8
+    u8  lut[COLOR_PIPELINE_CHANNELS][256];
+    u8  unit_matrix;                                                // matrix is the identity
+    u8  unit_lut;                                                   // every LUT maps x to x
+} ColorPipelineTables;
+
+typedef struct {
+    u32 frames;          // Frames processed
+    u32 skipped;         // Frames left alone, unit tables
+    u32 swaps;           // Table sets taken over at a frame start
+} ColorPipelineStats;
+
+typedef struct {
+    ColorPipelineTables tables[2];
+    u8 active;           // Set in use by Color_Pipeline_Frame
+    u8 pending;          // The other set was edited, switch at the next frame
+    ColorPipelineStats stats;
+} ColorPipeline;
+
+// Unit matrix and LUTs
+int Color_Pipeline_Init(ColorPipeline *cp);
+
+// Queue a new matrix / new LUTs for the next frame. A NULL LUT keeps that channel's current one.
+int Color_Pipeline_Set_Matrix(ColorPipeline *cp, const s16 matrix[COLOR_PIPELINE_CHANNELS][COLOR_PIPELINE_CHANNELS]);
+int Color_Pipeline_Set_Lut(ColorPipeline *cp, const u8 *red, const u8 *green, const u8 *blue);
+
+// Correct an RGB888 or RGB565 frame with the current tables
+int Color_Pipeline_Frame(ColorPipeline *cp, PixImage *img);
+
+// Table builders, integer only ( no libm ): 255 * ( x / 255 ) ^ ( 256 / gamma ), gamma in Q8 > 0.
+// The saturation matrix blends towards BT.601 luma, 256 keeps the colours, 0 is gray.
+void Color_Pipeline_Gamma_Lut(u8 lut[256], u32 gamma);
+void Color_Pipeline_Saturation_Matrix(s16 matrix[COLOR_PIPELINE_CHANNELS][COLOR_PIPELINE_CHANNELS], u32 saturation);
+
+// One line through a table set, in place allowed
+void Color_Pipeline_Rgb888_Line(u8 *dst, const u8 *src, u32 count, const ColorPipelineTables *t);
+void Color_Pipeline_Rgb565_Line(u16 *dst, const u16 *src, u32 count, const ColorPipelineTables *t);
+void Color_Pipeline_Rgb888_Line_C(u8 *dst, const u8 *src, u32 count, const ColorPipelineTables *t);
+void Color_Pipeline_Rgb565_Line_C(u16 *dst, const u16 *src, u32 count, const ColorPipelineTables *t);
+
+void Color_Pipeline_Print_Stats(const ColorPipeline *cp);
+
+#endif
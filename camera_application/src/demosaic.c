@@ -0,0 +1,392 @@
+#include "demosaic.h"
+#include <string.h>
+
+#ifdef PIX_NEON
+#include <arm_neon.h>
+#endif
+
+/*
+    Sites of a BGGR mosaic: even lines are B G B G, odd lines G R G R. A "chroma" site holds B
+    ( even line, even x ) or R ( odd line, odd x ), the others hold G. The NEON loops split a line
+    into even and odd column lanes with vld2, loaded again two pixels to the left and right for
+    the neighbours, so every lane of a vector is the same kind of site.
+*/
+
+#define DEMOSAIC_NEON_MIN 20U   // Narrower lines stay scalar, the NEON loop needs 2 pixels each side
+
+// Mirrored neighbours, the width is even so the mirror has the same colour
+static inline u32 Demosaic_Left(u32 x)
+{
+    return x == 0 ? 1U : x - 1U;
+}
+
+static inline u32 Demosaic_Right(u32 x, u32 width)
+{
+    return x + 1U >= width ? width - 2U : x + 1U;
+}
+
+static inline u8 Demosaic_Avg2(u32 a, u32 b)
+{
+    return (u8)((a + b + 1U) >> 1);
+}
+
+static inline u8 Demosaic_Avg4(u32 a, u32 b, u32 c, u32 d)
+{
+    return (u8)((a + b + c + d + 2U) >> 2);
+}
+
+// Green plus a colour difference, clamped
+static inline u8 Demosaic_Add_Diff(u32 g, s32 diff)
+{
+    s32 v = (s32)g + diff;
+
+    return (u8)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+static inline void Demosaic_Put(u8 *o, u32 odd_row, u8 own_or_h, u8 g, u8 other_or_v)
+{
+    // Even lines: B first, odd lines: R first
+    o[odd_row ? 0 : 2] = own_or_h;
+    o[1] = g;
+    o[odd_row ? 2 : 0] = other_or_v;
+}
+
+// --------------------------------------- Scalar -----------------------------------------------------
+
+static void Demosaic_Bilinear_Span(u8 *dst, const u8 *p, const u8 *c, const u8 *n, u32 width, u32 odd_row, u32 x0, u32 x1)
+{
+    for(u32 x = x0; x < x1; x++)
+    {
+        u32 l = Demosaic_Left(x), r = Demosaic_Right(x, width);
+
+        if((x & 1U) == odd_row)
+        {
+            // Own colour, green from the cross, the other colour from the diagonals
+            Demosaic_Put(dst + 3 * x, odd_row, c[x], Demosaic_Avg4(c[l], c[r], p[x], n[x]), Demosaic_Avg4(p[l], p[r], n[l], n[r]));
+        }
+        else
+        {
+            // Green site: the line's own colour left and right, the other above and below
+            Demosaic_Put(dst + 3 * x, odd_row, Demosaic_Avg2(c[l], c[r]), c[x], Demosaic_Avg2(p[x], n[x]));
+        }
+    }
+}
+
+static void Demosaic_Green_Span(u8 *g, const u8 *p, const u8 *c, const u8 *n, u32 width, u32 odd_row, u32 x0, u32 x1)
+{
+    for(u32 x = x0; x < x1; x++)
+    {
+        u32 l = Demosaic_Left(x), r = Demosaic_Right(x, width);
+        u32 dh, dv;
+
+        if((x & 1U) != odd_row)
+        {
+            g[x] = c[x];
+            continue;
+        }
+
+        dh = c[l] > c[r] ? c[l] - c[r] : c[r] - c[l];
+        dv = p[x] > n[x] ? p[x] - n[x] : n[x] - p[x];
+        if(dh < dv) g[x] = Demosaic_Avg2(c[l], c[r]);
+        else if(dv < dh) g[x] = Demosaic_Avg2(p[x], n[x]);
+        else g[x] = Demosaic_Avg4(c[l], c[r], p[x], n[x]);
+    }
+}
+
+static void Demosaic_EdgeAware_Span(u8 *dst, const u8 *p, const u8 *c, const u8 *n, const u8 *gp, const u8 *gc, const u8 *gn,
+                                    u32 width, u32 odd_row, u32 x0, u32 x1)
+{
+    for(u32 x = x0; x < x1; x++)
+    {
+        u32 l = Demosaic_Left(x), r = Demosaic_Right(x, width);
+
+        if((x & 1U) == odd_row)
+        {
+            s32 diag = ((s32)p[l] - gp[l]) + ((s32)p[r] - gp[r]) + ((s32)n[l] - gn[l]) + ((s32)n[r] - gn[r]);
+
+            Demosaic_Put(dst + 3 * x, odd_row, c[x], gc[x], Demosaic_Add_Diff(gc[x], (diag + 2) >> 2));
+        }
+        else
+        {
+            s32 h = ((s32)c[l] - gc[l]) + ((s32)c[r] - gc[r]);
+            s32 v = ((s32)p[x] - gp[x]) + ((s32)n[x] - gn[x]);
+
+            Demosaic_Put(dst + 3 * x, odd_row, Demosaic_Add_Diff(c[x], (h + 1) >> 1), c[x], Demosaic_Add_Diff(c[x], (v + 1) >> 1));
+        }
+    }
+}
+
+void Demosaic_Bilinear_Line_C(u8 *dst, const u8 *prev, const u8 *cur, const u8 *next, u32 width, u32 odd_row)
+{
+    Demosaic_Bilinear_Span(dst, prev, cur, next, width, odd_row, 0, width);
+}
+
+void Demosaic_Green_Line_C(u8 *green, const u8 *prev, const u8 *cur, const u8 *next, u32 width, u32 odd_row)
+{
+    Demosaic_Green_Span(green, prev, cur, next, width, odd_row, 0, width);
+}
+
+void Demosaic_EdgeAware_Line_C(u8 *dst, const u8 *prev, const u8 *cur, const u8 *next,
+                               const u8 *gprev, const u8 *gcur, const u8 *gnext, u32 width, u32 odd_row)
+{
+    Demosaic_EdgeAware_Span(dst, prev, cur, next, gprev, gcur, gnext, width, odd_row, 0, width);
+}
+
+// --------------------------------------- NEON -------------------------------------------------------
+
+#ifdef PIX_NEON
+// Even / odd columns of 16 pixels at x, and the neighbouring lanes two pixels either side
+typedef struct {
+    uint8x8_t e;         // x, x + 2, ...
+    uint8x8_t o;         // x + 1, x + 3, ...
+    uint8x8_t ol;        // x - 1, x + 1, ... odd column left of each even one
+    uint8x8_t er;        // x + 2, x + 4, ... even column right of each odd one
+} DemosaicLanes;
+
+static inline DemosaicLanes Demosaic_Neon_Load(const u8 *line, u32 x)
+{
+    DemosaicLanes v;
+    uint8x8x2_t mid = vld2_u8(line + x);
+
+    v.e = mid.val[0];
+    v.o = mid.val[1];
+    v.ol = vld2_u8(line + x - 2).val[1];
+    v.er = vld2_u8(line + x + 2).val[0];
+    return v;
+}
+
+static inline uint8x8_t Demosaic_Neon_Avg4(uint8x8_t a, uint8x8_t b, uint8x8_t c, uint8x8_t d)
+{
+    return vrshrn_n_u16(vaddq_u16(vaddl_u8(a, b), vaddl_u8(c, d)), 2);
+}
+
+// a - b widened to signed
+static inline int16x8_t Demosaic_Neon_Diff(uint8x8_t a, uint8x8_t b)
+{
+    return vreinterpretq_s16_u16(vsubl_u8(a, b));
+}
+
+// g + rounded mean of 2 or 4 differences, clamped
+static inline uint8x8_t Demosaic_Neon_Add2(uint8x8_t g, int16x8_t d0, int16x8_t d1)
+{
+    return vqmovun_s16(vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(g)), vrshrq_n_s16(vaddq_s16(d0, d1), 1)));
+}
+
+static inline uint8x8_t Demosaic_Neon_Add4(uint8x8_t g, int16x8_t d0, int16x8_t d1, int16x8_t d2, int16x8_t d3)
+{
+    return vqmovun_s16(vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(g)), vrshrq_n_s16(vaddq_s16(vaddq_s16(d0, d1), vaddq_s16(d2, d3)), 2)));
+}
+
+// 16 RGB888 pixels from even and odd column lanes of each channel
+static inline void Demosaic_Neon_Store(u8 *dst, uint8x8_t r_e, uint8x8_t r_o, uint8x8_t g_e, uint8x8_t g_o, uint8x8_t b_e, uint8x8_t b_o)
+{
+    uint8x8x2_t r = vzip_u8(r_e, r_o), g = vzip_u8(g_e, g_o), b = vzip_u8(b_e, b_o);
+    uint8x8x3_t lo = { { r.val[0], g.val[0], b.val[0] } };
+    uint8x8x3_t hi = { { r.val[1], g.val[1], b.val[1] } };
+
+    vst3_u8(dst, lo);
+    vst3_u8(dst + 24, hi);
+}
+#endif
+
+void Demosaic_Bilinear_Line(u8 *dst, const u8 *prev, const u8 *cur, const u8 *next, u32 width, u32 odd_row)
+{
+    u32 x = 0;
+
+#ifdef PIX_NEON
+    if(width >= DEMOSAIC_NEON_MIN)
+    {
+        Demosaic_Bilinear_Span(dst, prev, cur, next, width, odd_row, 0, 2);
+        for(x = 2; x + 18 <= width; x += 16)
+        {
+            __builtin_prefetch(cur + x + 64);
+            DemosaicLanes p = Demosaic_Neon_Load(prev, x), c = Demosaic_Neon_Load(cur, x), n = Demosaic_Neon_Load(next, x);
+
+            if(!odd_row)
+            {
+                // Even lanes B, odd lanes G
+                Demosaic_Neon_Store(dst + 3 * x,
+                                    Demosaic_Neon_Avg4(p.ol, p.o, n.ol, n.o), vrhadd_u8(p.o, n.o),
+                                    Demosaic_Neon_Avg4(c.ol, c.o, p.e, n.e), c.o,
+                                    c.e, vrhadd_u8(c.e, c.er));
+            }
+            else
+            {
+                // Even lanes G, odd lanes R
+                Demosaic_Neon_Store(dst + 3 * x,
+                                    vrhadd_u8(c.ol, c.o), c.o,
+                                    c.e, Demosaic_Neon_Avg4(c.e, c.er, p.o, n.o),
+                                    vrhadd_u8(p.e, n.e), Demosaic_Neon_Avg4(p.e, p.er, n.e, n.er));
+            }
+        }
+    }
+#endif
+    Demosaic_Bilinear_Span(dst, prev, cur, next, width, odd_row, x, width);
+}
+
+void Demosaic_Green_Line(u8 *green, const u8 *prev, const u8 *cur, const u8 *next, u32 width, u32 odd_row)
+{
+    u32 x = 0;
+
+#ifdef PIX_NEON
+    if(width >= DEMOSAIC_NEON_MIN)
+    {
+        Demosaic_Green_Span(green, prev, cur, next, width, odd_row, 0, 2);
+        for(x = 2; x + 18 <= width; x += 16)
+        {
+            DemosaicLanes p = Demosaic_Neon_Load(prev, x), c = Demosaic_Neon_Load(cur, x), n = Demosaic_Neon_Load(next, x);
+            // Chroma lanes and their horizontal / vertical green neighbours
+            uint8x8_t h0 = odd_row ? c.e : c.ol, h1 = odd_row ? c.er : c.o;
+            uint8x8_t v0 = odd_row ? p.o : p.e, v1 = odd_row ? n.o : n.e;
+            uint8x8_t dh = vabd_u8(h0, h1), dv = vabd_u8(v0, v1);
+            uint8x8_t g = vbsl_u8(vclt_u8(dh, dv), vrhadd_u8(h0, h1),
+                                  vbsl_u8(vclt_u8(dv, dh), vrhadd_u8(v0, v1), Demosaic_Neon_Avg4(h0, h1, v0, v1)));
+            uint8x8x2_t z = odd_row ? vzip_u8(c.e, g) : vzip_u8(g, c.o);
+
+            vst1q_u8(green + x, vcombine_u8(z.val[0], z.val[1]));
+        }
+    }
+#endif
+    Demosaic_Green_Span(green, prev, cur, next, width, odd_row, x, width);
+}
+
+void Demosaic_EdgeAware_Line(u8 *dst, const u8 *prev, const u8 *cur, const u8 *next,
+                             const u8 *gprev, const u8 *gcur, const u8 *gnext, u32 width, u32 odd_row)
+{
+    u32 x = 0;
+
+#ifdef PIX_NEON
+    if(width >= DEMOSAIC_NEON_MIN)
+    {
+        Demosaic_EdgeAware_Span(dst, prev, cur, next, gprev, gcur, gnext, width, odd_row, 0, 2);
+        for(x = 2; x + 18 <= width; x += 16)
+        {
+            __builtin_prefetch(cur + x + 64);
+            DemosaicLanes p = Demosaic_Neon_Load(prev, x), c = Demosaic_Neon_Load(cur, x), n = Demosaic_Neon_Load(next, x);
+            DemosaicLanes gp = Demosaic_Neon_Load(gprev, x), gc = Demosaic_Neon_Load(gcur, x), gn = Demosaic_Neon_Load(gnext, x);
+
+            if(!odd_row)
+            {
+                // Even lanes B with R from the diagonals, odd lanes G with B left / right and R above / below
+                uint8x8_t r_e = Demosaic_Neon_Add4(gc.e, Demosaic_Neon_Diff(p.ol, gp.ol), Demosaic_Neon_Diff(p.o, gp.o),
+                                                   Demosaic_Neon_Diff(n.ol, gn.ol), Demosaic_Neon_Diff(n.o, gn.o));
+                uint8x8_t b_o = Demosaic_Neon_Add2(c.o, Demosaic_Neon_Diff(c.e, gc.e), Demosaic_Neon_Diff(c.er, gc.er));
+                uint8x8_t r_o = Demosaic_Neon_Add2(c.o, Demosaic_Neon_Diff(p.o, gp.o), Demosaic_Neon_Diff(n.o, gn.o));
+
+                Demosaic_Neon_Store(dst + 3 * x, r_e, r_o, gc.e, c.o, c.e, b_o);
+            }
+            else
+            {
+                // Even lanes G with R left / right and B above / below, odd lanes R with B from the diagonals
+                uint8x8_t r_e = Demosaic_Neon_Add2(c.e, Demosaic_Neon_Diff(c.ol, gc.ol), Demosaic_Neon_Diff(c.o, gc.o));
+                uint8x8_t b_e = Demosaic_Neon_Add2(c.e, Demosaic_Neon_Diff(p.e, gp.e), Demosaic_Neon_Diff(n.e, gn.e));
+                uint8x8_t b_o = Demosaic_Neon_Add4(gc.o, Demosaic_Neon_Diff(p.e, gp.e), Demosaic_Neon_Diff(p.er, gp.er),
+                                                   Demosaic_Neon_Diff(n.e, gn.e), Demosaic_Neon_Diff(n.er, gn.er));
+
+                Demosaic_Neon_Store(dst + 3 * x, r_e, c.o, c.e, gc.o, b_e, b_o);
+            }
+        }
+    }
+#endif
+    Demosaic_EdgeAware_Span(dst, prev, cur, next, gprev, gcur, gnext, width, odd_row, x, width);
+}
+
+// --------------------------------------- Frames -----------------------------------------------------
+
+void Demosaic_Init(Demosaic *dm, DemosaicMethod method)
+{
+    dm->method = method;
+    dm->green_row[0] = -1;
+    dm->green_row[1] = -1;
+    dm->green_row[2] = -1;
+    memset(&dm->stats, 0, sizeof(dm->stats));
+}
+
+// Line index mirrored into the frame, same colour phase
+static inline u32 Demosaic_Mirror(s32 y, u32 height)
+{
+    if(y < 0) return (u32)-y;
+    if((u32)y >= height) return 2U * height - 2U - (u32)y;
+    return (u32)y;
+}
+
+static inline const u8 *Demosaic_Raw(const PixImage *bayer, u32 y)
+{
+    return bayer->planes[0] + y * bayer->strides[0];
+}
+
+// Green plane of raw line y, computed once per frame
+static const u8 *Demosaic_Green(Demosaic *dm, const PixImage *bayer, u32 y)
+{
+    u32 slot = y % 3U;
+
+    if(dm->green_row[slot] != (s32)y)
+    {
+        Demosaic_Green_Line(dm->green[slot], Demosaic_Raw(bayer, Demosaic_Mirror((s32)y - 1, bayer->height)), Demosaic_Raw(bayer, y),
+                            Demosaic_Raw(bayer, Demosaic_Mirror((s32)y + 1, bayer->height)), bayer->width, y & 1U);
+        dm->green_row[slot] = (s32)y;
+    }
+    return dm->green[slot];
+}
+
+int Demosaic_Frame(Demosaic *dm, const PixImage *bayer, PixImage *rgb)
+{
+    XTime t0, t1;
+    u32 w, h;
+
+    if(dm == NULL || bayer == NULL || rgb == NULL) return XST_INVALID_PARAM;
+    w = bayer->width;
+    h = bayer->height;
+    if(bayer->format != PIX_FMT_BAYER_BGGR || (rgb->format != PIX_FMT_RGB888 && rgb->format != PIX_FMT_RGB565) ||
+       rgb->width != w || rgb->height != h || w < 2 || h < 2 || ((w | h) & 1U) != 0 || w > DEMOSAIC_MAX_WIDTH)
+    {
+        dm->stats.errors++;
+        return XST_INVALID_PARAM;
+    }
+
+    XTime_GetTime(&t0);
+    dm->green_row[0] = -1;
+    dm->green_row[1] = -1;
+    dm->green_row[2] = -1;
+
+    for(u32 y = 0; y < h; y++)
+    {
+        u32 yp = Demosaic_Mirror((s32)y - 1, h), yn = Demosaic_Mirror((s32)y + 1, h);
+        u8 *out = rgb->format == PIX_FMT_RGB888 ? rgb->planes[0] + y * rgb->strides[0] : dm->rgb;
+
+        if(dm->method == DEMOSAIC_BILINEAR)
+        {
+            Demosaic_Bilinear_Line(out, Demosaic_Raw(bayer, yp), Demosaic_Raw(bayer, y), Demosaic_Raw(bayer, yn), w, y & 1U);
+        }
+        else
+        {
+            const u8 *gp = Demosaic_Green(dm, bayer, yp);
+            const u8 *gc = Demosaic_Green(dm, bayer, y);
+            const u8 *gn = Demosaic_Green(dm, bayer, yn);
+
+            Demosaic_EdgeAware_Line(out, Demosaic_Raw(bayer, yp), Demosaic_Raw(bayer, y), Demosaic_Raw(bayer, yn), gp, gc, gn, w, y & 1U);
+        }
+
+        if(rgb->format == PIX_FMT_RGB565) Pix_Rgb888ToRgb565_Line((u16 *)(rgb->planes[0] + y * rgb->strides[0]), dm->rgb, w);
+    }
+
+    XTime_GetTime(&t1);
+    dm->stats.frames++;
+    dm->stats.busy_ticks += t1 - t0;
+    return XST_SUCCESS;
+}
+
+void Demosaic_GetStats(const Demosaic *dm, DemosaicStats *stats)
+{
+    *stats = dm->stats;
+}
+
+void Demosaic_Print_Stats(const Demosaic *dm)
+{
+    DemosaicStats stats;
+
+    Demosaic_GetStats(dm, &stats);
+    xil_printf("[INFO] Demosaic ( %s ): %u frames, %u refused, %u us per frame\n",
+               dm->method == DEMOSAIC_BILINEAR ? "bilinear" : "edge aware", stats.frames, stats.errors,
+               stats.frames != 0 ? (u32)(stats.busy_ticks / stats.frames / (COUNTS_PER_SECOND / 1000000)) : 0U);
+}
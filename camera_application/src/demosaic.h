@@ -0,0 +1,66 @@
+#ifndef __DEMOSAIC_H__
+#define __DEMOSAIC_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "xiltimer.h"
+#include "pixel_convert.h"
+
+/*
+    Demosaic of the OV7670 raw Bayer output ( OV7670_FMT_BAYER_RAW, BGGR ) to RGB888 or RGB565, so
+    raw frames feed the same consumers as the sensor's own RGB modes. Streamed a line at a time, each
+    output line reads the raw lines above and below it, borders are mirrored.
+
+    - Bilinear: missing colours are the mean of their 2 or 4 nearest samples.
+    - Edge aware: green at red / blue sites is interpolated along the direction with the smaller
+      green gradient, then red and blue are filled in as colour differences to that green plane,
+      which keeps edges free of the colour fringes bilinear leaves. The green plane is held for
+      three lines only.
+
+    Line kernels have scalar references ( *_C ) and NEON versions with the same results.
+*/
+
+#define DEMOSAIC_MAX_WIDTH 640U
+
+typedef enum {
+    DEMOSAIC_BILINEAR,
+    DEMOSAIC_EDGE_AWARE,
+} DemosaicMethod;
+
+typedef struct {
+    u32 frames;
+    u32 errors;          // Requests refused
+    u64 busy_ticks;      // Global timer ticks spent demosaicing
+} DemosaicStats;
+
+typedef struct {
+    DemosaicMethod method;
+    u8  green[3][DEMOSAIC_MAX_WIDTH];    // Edge aware: green plane of three raw lines, row r in slot r % 3
+    s32 green_row[3];                    // Raw line held by each slot, -1 when empty
+    u8  rgb[DEMOSAIC_MAX_WIDTH * 3];     // RGB565 output line before packing
+    DemosaicStats stats;
+} Demosaic;
+
+void Demosaic_Init(Demosaic *dm, DemosaicMethod method);
+
+// Whole frame, bayer is PIX_FMT_BAYER_BGGR, rgb PIX_FMT_RGB888 or PIX_FMT_RGB565 of the same even size
+int Demosaic_Frame(Demosaic *dm, const PixImage *bayer, PixImage *rgb);
+
+// RGB888 line from the raw line cur and its neighbours, odd_row is 1 on G R lines
+void Demosaic_Bilinear_Line(u8 *dst, const u8 *prev, const u8 *cur, const u8 *next, u32 width, u32 odd_row);
+
+// Edge aware green of one raw line, then the RGB888 line from the raw and green lines
+void Demosaic_Green_Line(u8 *green, const u8 *prev, const u8 *cur, const u8 *next, u32 width, u32 odd_row);
+void Demosaic_EdgeAware_Line(u8 *dst, const u8 *prev, const u8 *cur, const u8 *next,
+                             const u8 *gprev, const u8 *gcur, const u8 *gnext, u32 width, u32 odd_row);
+
+void Demosaic_Bilinear_Line_C(u8 *dst, const u8 *prev, const u8 *cur, const u8 *next, u32 width, u32 odd_row);
+void Demosaic_Green_Line_C(u8 *green, const u8 *prev, const u8 *cur, const u8 *next, u32 width, u32 odd_row);
+void Demosaic_EdgeAware_Line_C(u8 *dst, const u8 *prev, const u8 *cur, const u8 *next,
+                               const u8 *gprev, const u8 *gcur, const u8 *gnext, u32 width, u32 odd_row);
+
+void Demosaic_GetStats(const Demosaic *dm, DemosaicStats *stats);
+void Demosaic_Print_Stats(const Demosaic *dm);
+
+#endif
@@ -0,0 +1,548 @@
+#include "dma_helper.h"
+#include "xparameters_ps.h"
+#include "xil_cache.h"
+#include "xdmaps_hw.h"
+
+#define DMA_STOP_POLLS 1000  // Channel status reads before giving up on DMAEND
+
+// Exported by xdmaps.c but not declared in xdmaps.h
+extern u32 XDmaPs_ToCCRValue(XDmaPs_ChanCtrl *ChanCtrl);
+
+// GIC lines of the channel done interrupts
+static const u32 dma_done_intr[DMA_NUM_CHANNELS] = {
+    XPS_DMA0_INT_ID, XPS_DMA1_INT_ID, XPS_DMA2_INT_ID, XPS_DMA3_INT_ID,
+    XPS_DMA4_INT_ID, XPS_DMA5_INT_ID, XPS_DMA6_INT_ID, XPS_DMA7_INT_ID,
+};
+
+static const Xil_InterruptHandler dma_done_isr[DMA_NUM_CHANNELS] = {
+    (Xil_InterruptHandler)XDmaPs_DoneISR_0, (Xil_InterruptHandler)XDmaPs_DoneISR_1,
+    (Xil_InterruptHandler)XDmaPs_DoneISR_2, (Xil_InterruptHandler)XDmaPs_DoneISR_3,
+    (Xil_InterruptHandler)XDmaPs_DoneISR_4, (Xil_InterruptHandler)XDmaPs_DoneISR_5,
+    (Xil_InterruptHandler)XDmaPs_DoneISR_6, (Xil_InterruptHandler)XDmaPs_DoneISR_7,
+};
+
+static void Dma_FaultHandler(unsigned int channel, XDmaPs_Cmd *cmd, void *callback_ref)
+{
+    DmaCtrl *inst = (DmaCtrl *)callback_ref;
+
+    inst->faults++;
+    if(channel >= DMA_NUM_CHANNELS) return;
+
+    // Reported by Dma_Fault_Print_Stats, nothing is printed from interrupt context
+    inst->chan_stats[channel].faults++;
+    inst->chan_stats[channel].fault_type = cmd->ChanFaultType;
+    inst->chan_stats[channel].fault_pc = cmd->ChanFaultPCAddr;
+
+    if(inst->fault_cb[channel] != NULL)
+    {
+        inst->fault_cb[channel](channel, cmd, inst->fault_ref[channel]);
+    }
+}
+
+int Dma_Helper_Init(DmaCtrl *instance_ptr, UINTPTR dma_base_addr, XScuGic *intc_ptr)
+{
+    XDmaPs_Config *dma_cfg_ptr;
+    int status;
+
+    instance_ptr->intc_ptr = intc_ptr;
+    instance_ptr->faults = 0;
+    for(int i = 0; i < DMA_NUM_CHANNELS; i++)
+    {
+        DmaProgCache *cache = &instance_ptr->prog_cache[i];
+
+        instance_ptr->fault_cb[i] = NULL;
+        instance_ptr->fault_ref[i] = NULL;
+        instance_ptr->chan_stats[i].faults = 0;
+        instance_ptr->chan_stats[i].fault_type = 0;
+        instance_ptr->chan_stats[i].fault_pc = 0;
+        for(u32 j = 0; j < DMA_PROG_CACHE_WAYS; j++) cache->entries[j].valid = FALSE;
+        cache->use_clock = 0;
+        cache->hits = 0;
+        cache->misses = 0;
+        cache->evictions = 0;
+        cache->overflows = 0;
+    }
+
+    dma_cfg_ptr = XDmaPs_LookupConfig(dma_base_addr);
+    if(dma_cfg_ptr == NULL)
+    {
+        xil_printf("[ERROR] Could not lookup DMA config, validate baseaddr: 0x%08X\n", dma_base_addr);
+        return XST_FAILURE;
+    }
+    status = XDmaPs_CfgInitialize(&instance_ptr->dma_instance, dma_cfg_ptr, dma_cfg_ptr->BaseAddress);
+    if(status != XST_SUCCESS)
+    {
+        xil_printf("[ERROR] Failed to initialize dma_instance with status: %d\n", status);
+        return status;
+    }
+
+    // Faults kill the channel in the driver, we only count and forward them
+    status = XScuGic_Connect(intc_ptr, XPS_DMA0_ABORT_INT_ID, (Xil_InterruptHandler)XDmaPs_FaultISR, &instance_ptr->dma_instance);
+    if(status != XST_SUCCESS)
+    {
+        xil_printf("[ERROR] Failed to connect the DMA fault interrupt with status: %d.\n", status);
+        return status;
+    }
+    XDmaPs_SetFaultHandler(&instance_ptr->dma_instance, Dma_FaultHandler, instance_ptr);
+    XScuGic_Enable(intc_ptr, XPS_DMA0_ABORT_INT_ID);
+
+    for(int i = 0; i < DMA_NUM_CHANNELS; i++)
+    {
+        status = XScuGic_Connect(intc_ptr, dma_done_intr[i], dma_done_isr[i], &instance_ptr->dma_instance);
+        if(status != XST_SUCCESS)
+        {
+            xil_printf("[ERROR] Failed to connect DMA channel %d done interrupt with status: %d.\n", i, status);
+            return status;
+        }
+        XScuGic_Enable(intc_ptr, dma_done_intr[i]);
+    }
+
+    xil_printf("[INFO] Successfully initialised DMA Helper!\n");
+    return XST_SUCCESS;
+}
+
+u32 Dma_Done_IntrId(unsigned channel)
+{
+    return dma_done_intr[channel];
+}
+
+void Dma_Channel_Lock(DmaCtrl *instance_ptr, unsigned channel)
+{
+    XScuGic_Disable(instance_ptr->intc_ptr, XPS_DMA0_ABORT_INT_ID);
+    XScuGic_Disable(instance_ptr->intc_ptr, dma_done_intr[channel]);
+}
+
+void Dma_Channel_Unlock(DmaCtrl *instance_ptr, unsigned channel)
+{
+    XScuGic_Enable(instance_ptr->intc_ptr, dma_done_intr[channel]);
+    XScuGic_Enable(instance_ptr->intc_ptr, XPS_DMA0_ABORT_INT_ID);
+}
+
+int Dma_Channel_WaitStopped(DmaCtrl *instance_ptr, unsigned channel)
+{
+    UINTPTR base = instance_ptr->dma_instance.Config.BaseAddress;
+
+    for(int i = 0; i < DMA_STOP_POLLS; i++)
+    {
+        u32 cs = XDmaPs_ReadReg(base, XDmaPs_CSn_OFFSET(channel));
+        if((cs & XDMAPS_DS_DMA_STATUS) == XDMAPS_DS_DMA_STATUS_STOPPED) return XST_SUCCESS;
+    }
+    return XST_DEVICE_BUSY;
+}
+
+void Dma_SetFaultCallback(DmaCtrl *instance_ptr, unsigned channel, DmaFaultCallback callback, void *callback_ref)
+{
+    if(channel >= DMA_NUM_CHANNELS) return;
+    instance_ptr->fault_ref[channel] = callback_ref;
+    instance_ptr->fault_cb[channel] = callback;
+}
+
+// ------------------------------------------ Program Assembler -------------------------------------
+
+// Reserve n bytes, NULL and overflow set when they do not fit
+static u8* Dma_Prog_Emit(DmaProg *prog, int n)
+{
+    if(prog->len + n > prog->cap)
+    {
+        prog->overflow = TRUE;
+        return NULL;
+    }
+    u8 *p = prog->buf + prog->len;
+    prog->len += n;
+    return p;
+}
+
+void Dma_Prog_Init(DmaProg *prog, u8 *buf, int cap)
+{
+    prog->buf = buf;
+    prog->len = 0;
+    prog->cap = cap;
+    prog->overflow = FALSE;
+}
+
+int Dma_Prog_Mov(DmaProg *prog, u8 reg, u32 imm)
+{
+    u8 *p = Dma_Prog_Emit(prog, 6);
+    if(p == NULL) return -1;
+    p[0] = 0xBC;
+    p[1] = reg & 0x7;
+    p[2] = (u8)imm;
+    p[3] = (u8)(imm >> 8);
+    p[4] = (u8)(imm >> 16);
+    p[5] = (u8)(imm >> 24);
+    return prog->len - 4;
+}
+
+int Dma_Prog_Lp(DmaProg *prog, u8 lc, u32 iterations)
+{
+    u8 *p = Dma_Prog_Emit(prog, 2);
+    if(p != NULL)
+    {
+        p[0] = 0x20 | ((lc & 1) << 1);
+        p[1] = (u8)(iterations - 1);
+    }
+    return prog->len;
+}
+
+void Dma_Prog_LpEnd(DmaProg *prog, u8 lc, int body)
+{
+    int jump = prog->len - body;
+    u8 *p = Dma_Prog_Emit(prog, 2);
+    if(p == NULL) return;
+    if(jump > 255) prog->overflow = TRUE;
+    p[0] = 0x38 | ((lc & 1) << 2);
+    p[1] = (u8)jump;
+}
+
+void Dma_Prog_Ld(DmaProg *prog)
+{
+    u8 *p = Dma_Prog_Emit(prog, 1);
+    if(p != NULL) p[0] = 0x04;
+}
+
+void Dma_Prog_St(DmaProg *prog)
+{
+    u8 *p = Dma_Prog_Emit(prog, 1);
+    if(p != NULL) p[0] = 0x08;
+}
+
+void Dma_Prog_AddH(DmaProg *prog, u8 reg, u16 imm)
+{
+    u8 *p = Dma_Prog_Emit(prog, 3);
+    if(p == NULL) return;
+    p[0] = 0x54 | ((reg == DMA_REG_DAR) ? 0x2 : 0x0);
+    p[1] = (u8)imm;
+    p[2] = (u8)(imm >> 8);
+}
+
+void Dma_Prog_FlushP(DmaProg *prog, u8 periph)
+{
+    u8 *p = Dma_Prog_Emit(prog, 2);
+    if(p == NULL) return;
+    p[0] = 0x35;
+    p[1] = (u8)((periph & 0x1F) << 3);
+}
+
+void Dma_Prog_WfP(DmaProg *prog, u8 periph)
+{
+    u8 *p = Dma_Prog_Emit(prog, 2);
+    if(p == NULL) return;
+    p[0] = 0x31;
+    p[1] = (u8)((periph & 0x1F) << 3);
+}
+
+int Dma_Prog_Wfe(DmaProg *prog, u8 event)
+{
+    u8 *p = Dma_Prog_Emit(prog, 2);
+    if(p == NULL) return -1;
+    Dma_Prog_SetWfe(prog->buf, prog->len - 2, event, TRUE);
+    return prog->len - 2;
+}
+
+void Dma_Prog_Sev(DmaProg *prog, u8 event)
+{
+    u8 *p = Dma_Prog_Emit(prog, 2);
+    if(p == NULL) return;
+    p[0] = 0x34;
+    p[1] = (u8)((event & 0x1F) << 3);
+}
+
+void Dma_Prog_Wmb(DmaProg *prog)
+{
+    u8 *p = Dma_Prog_Emit(prog, 1);
+    if(p != NULL) p[0] = 0x13;
+}
+
+void Dma_Prog_End(DmaProg *prog)
+{
+    u8 *p = Dma_Prog_Emit(prog, 1);
+    if(p != NULL) p[0] = 0x00;
+}
+
+void Dma_Prog_Patch32(u8 *prog, int offset, u32 value)
+{
+    prog[offset] = (u8)value;
+    prog[offset + 1] = (u8)(value >> 8);
+    prog[offset + 2] = (u8)(value >> 16);
+    prog[offset + 3] = (u8)(value >> 24);
+}
+
+void Dma_Prog_SetWfe(u8 *prog, int offset, u8 event, int enable)
+{
+    if(enable)
+    {
+        prog[offset] = 0x36;
+        prog[offset + 1] = (u8)(((event & 0x1F) << 3) | 0x2);
+    }
+    else
+    {
+        prog[offset] = 0x18;
+        prog[offset + 1] = 0x18;
+    }
+}
+
+u32 Dma_Ccr(XDmaPs_ChanCtrl *chan_ctrl)
+{
+    return XDmaPs_ToCCRValue(chan_ctrl);
+}
+
+u32 Dma_BurstLen(u32 bytes, u32 beat_bytes)
+{
+    u32 beats = bytes / beat_bytes;
+
+    for(u32 len = 16; len > 1; len--)
+    {
+        if(beats % len == 0) return len;
+    }
+    return 1;
+}
+
+// -------------------------------------------- Program Cache ---------------------------------------
+
+// Row of bytes: full bursts in a loop, then the leftover beats as one shorter burst
+static void Dma_Prog_Row(DmaProg *prog, XDmaPs_ChanCtrl *chan_ctrl, u32 ccr, u32 bytes)
+{
+    u32 beat = chan_ctrl->SrcBurstSize;
+    u32 burst_bytes = beat * chan_ctrl->SrcBurstLen;
+    u32 bursts = bytes / burst_bytes;
+    u32 rem_beats = (bytes % burst_bytes) / beat;
+
+    if(bursts == 1)
+    {
+        Dma_Prog_Ld(prog);
+        Dma_Prog_St(prog);
+    }
+    else if(bursts > 1)
+    {
+        int body = Dma_Prog_Lp(prog, 0, bursts);
+        Dma_Prog_Ld(prog);
+        Dma_Prog_St(prog);
+        Dma_Prog_LpEnd(prog, 0, body);
+    }
+
+    if(rem_beats != 0)
+    {
+        XDmaPs_ChanCtrl rem_ctrl = *chan_ctrl;
+        rem_ctrl.SrcBurstLen = rem_beats;
+        rem_ctrl.DstBurstLen = rem_beats;
+        Dma_Prog_Mov(prog, DMA_REG_CCR, Dma_Ccr(&rem_ctrl));
+        Dma_Prog_Ld(prog);
+        Dma_Prog_St(prog);
+        Dma_Prog_Mov(prog, DMA_REG_CCR, ccr);
+    }
+}
+
+// Rows, pads and tail of a shape, SAR / DAR already loaded
+static void Dma_Prog_ShapeBody(DmaProg *prog, const DmaShape *shape, XDmaPs_ChanCtrl *chan_ctrl)
+{
+    // DMALP counts stop at 256, longer row counts become several loops
+    for(u32 row = 0; row < shape->rows; row += 256)
+    {
+        u32 rows = shape->rows - row;
+        if(rows > 256) rows = 256;
+
+        int body = Dma_Prog_Lp(prog, 1, rows);
+        Dma_Prog_Row(prog, chan_ctrl, shape->ccr, shape->row_bytes);
+        if(shape->src_pad != 0) Dma_Prog_AddH(prog, DMA_REG_SAR, shape->src_pad);
+        if(shape->dst_pad != 0) Dma_Prog_AddH(prog, DMA_REG_DAR, shape->dst_pad);
+        Dma_Prog_LpEnd(prog, 1, body);
+    }
+    if(shape->tail_bytes != 0) Dma_Prog_Row(prog, chan_ctrl, shape->ccr, shape->tail_bytes);
+}
+
+static int Dma_Prog_BuildShape(DmaProgEntry *entry, const DmaShape *shape, XDmaPs_ChanCtrl *chan_ctrl, unsigned channel)
+{
+    DmaProg prog;
+
+    Dma_Prog_Init(&prog, entry->prog, DMA_PROG_SLOT_LEN);
+    Dma_Prog_Mov(&prog, DMA_REG_CCR, shape->ccr);
+    entry->sar_off = (u16)Dma_Prog_Mov(&prog, DMA_REG_SAR, 0);
+    entry->dar_off = (u16)Dma_Prog_Mov(&prog, DMA_REG_DAR, 0);
+    Dma_Prog_ShapeBody(&prog, shape, chan_ctrl);
+
+    Dma_Prog_Wmb(&prog);
+    Dma_Prog_Sev(&prog, (u8)channel);
+    Dma_Prog_End(&prog);
+
+    if(prog.overflow) return XST_FAILURE;
+    entry->len = (u16)prog.len;
+    return XST_SUCCESS;
+}
+
+// Both sides move the same beats, the program only has one CCR
+static int Dma_Shape_CheckCtrl(XDmaPs_ChanCtrl *chan_ctrl)
+{
+    if(chan_ctrl->SrcBurstSize != chan_ctrl->DstBurstSize || chan_ctrl->SrcBurstLen != chan_ctrl->DstBurstLen) return FALSE;
+    if(chan_ctrl->SrcBurstSize == 0 || chan_ctrl->SrcBurstSize > 8) return FALSE;
+    if(chan_ctrl->SrcBurstLen == 0 || chan_ctrl->SrcBurstLen > 16) return FALSE;
+    return TRUE;
+}
+
+int Dma_Shape_Linear(DmaShape *shape, XDmaPs_ChanCtrl *chan_ctrl, u32 bytes)
+{
+    u32 row_bytes;
+
+    if(!Dma_Shape_CheckCtrl(chan_ctrl) || bytes == 0 || bytes % chan_ctrl->SrcBurstSize != 0) return XST_INVALID_PARAM;
+
+    row_bytes = 256U * chan_ctrl->SrcBurstSize * chan_ctrl->SrcBurstLen;
+    shape->ccr = Dma_Ccr(chan_ctrl);
+    shape->row_bytes = row_bytes;
+    shape->rows = bytes / row_bytes;
+    shape->tail_bytes = bytes % row_bytes;
+    shape->src_pad = 0;
+    shape->dst_pad = 0;
+    return XST_SUCCESS;
+}
+
+int Dma_Shape_2D(DmaShape *shape, XDmaPs_ChanCtrl *chan_ctrl, u32 row_bytes, u32 rows, u32 src_stride, u32 dst_stride)
+{
+    u32 beat;
+
+    if(!Dma_Shape_CheckCtrl(chan_ctrl) || row_bytes == 0 || rows == 0) return XST_INVALID_PARAM;
+
+    beat = chan_ctrl->SrcBurstSize;
+    if(row_bytes % beat != 0 || row_bytes > 256U * beat * chan_ctrl->SrcBurstLen) return XST_INVALID_PARAM;
+    if(src_stride < row_bytes || src_stride - row_bytes > 0xFFFF) return XST_INVALID_PARAM;
+    if(dst_stride < row_bytes || dst_stride - row_bytes > 0xFFFF) return XST_INVALID_PARAM;
+
+    shape->ccr = Dma_Ccr(chan_ctrl);
+    shape->row_bytes = row_bytes;
+    shape->rows = rows;
+    shape->tail_bytes = 0;
+    shape->src_pad = (u16)(src_stride - row_bytes);
+    shape->dst_pad = (u16)(dst_stride - row_bytes);
+    return XST_SUCCESS;
+}
+
+static int Dma_Shape_Equal(const DmaShape *a, const DmaShape *b)
+{
+    return a->ccr == b->ccr && a->row_bytes == b->row_bytes && a->rows == b->rows &&
+           a->tail_bytes == b->tail_bytes && a->src_pad == b->src_pad && a->dst_pad == b->dst_pad;
+}
+
+int Dma_Prog_Prepare(DmaCtrl *instance_ptr, unsigned channel, const DmaShape *shape,
+                     XDmaPs_ChanCtrl *chan_ctrl, u32 src, u32 dst, XDmaPs_Cmd *cmd)
+{
+    DmaProgCache *cache;
+    DmaProgEntry *entry = NULL;
+    DmaProgEntry *victim;
+    u32 beat = chan_ctrl->SrcBurstSize;
+    int built = FALSE;
+
+    if(channel >= DMA_NUM_CHANNELS || beat == 0 || src % beat != 0 || dst % beat != 0) return XST_INVALID_PARAM;
+
+    cache = &instance_ptr->prog_cache[channel];
+    victim = &cache->entries[0];
+    for(u32 i = 0; i < DMA_PROG_CACHE_WAYS; i++)
+    {
+        DmaProgEntry *e = &cache->entries[i];
+        if(e->valid && Dma_Shape_Equal(&e->shape, shape))
+        {
+            entry = e;
+            break;
+        }
+        // Invalid entries first, then the least recently used one
+        if(victim->valid && (!e->valid || e->last_use < victim->last_use)) victim = e;
+    }
+
+    if(entry != NULL)
+    {
+        cache->hits++;
+    }
+    else
+    {
+        if(victim->valid) cache->evictions++;
+        victim->valid = FALSE;
+        if(Dma_Prog_BuildShape(victim, shape, chan_ctrl, channel) != XST_SUCCESS)
+        {
+            // Also reached from the done and fault handlers, reported by Dma_ProgCache_Print_Stats
+            cache->overflows++;
+            return XST_FAILURE;
+        }
+        cache->misses++;
+        victim->shape = *shape;
+        victim->valid = TRUE;
+        entry = victim;
+        built = TRUE;
+    }
+    entry->last_use = ++cache->use_clock;
+
+    // Only the two addresses change, the rest of the program is already in memory
+    Dma_Prog_Patch32(entry->prog, entry->sar_off, src);
+    Dma_Prog_Patch32(entry->prog, entry->dar_off, dst);
+    if(built)
+    {
+        Xil_DCacheFlushRange((INTPTR)entry->prog, entry->len);
+    }
+    else
+    {
+        Xil_DCacheFlushRange((INTPTR)entry->prog + entry->sar_off, entry->dar_off + 4 - entry->sar_off);
+    }
+
+    cmd->ChanCtrl = *chan_ctrl;
+    if(shape->src_pad != 0 || shape->dst_pad != 0)
+    {
+        cmd->ChanCtrl.SrcInc = 0;
+        cmd->ChanCtrl.DstInc = 0;
+    }
+    cmd->BD.SrcAddr = src;
+    cmd->BD.DstAddr = dst;
+    cmd->BD.Length = shape->rows * shape->row_bytes + shape->tail_bytes;
+    cmd->UserDmaProg = entry->prog;
+    cmd->UserDmaProgLength = entry->len;
+    cmd->GeneratedDmaProg = NULL;
+    cmd->GeneratedDmaProgLength = 0;
+    return XST_SUCCESS;
+}
+
+int Dma_Prog_BuildGather(u8 *buf, int cap, XDmaPs_ChanCtrl *chan_ctrl, const DmaRect *rects, u32 count, unsigned channel)
+{
+    DmaProg prog;
+
+    Dma_Prog_Init(&prog, buf, cap);
+    Dma_Prog_Mov(&prog, DMA_REG_CCR, Dma_Ccr(chan_ctrl));
+
+    for(u32 i = 0; i < count; i++)
+    {
+        const DmaRect *rect = &rects[i];
+        DmaShape shape;
+
+        if(Dma_Shape_2D(&shape, chan_ctrl, rect->row_bytes, rect->rows, rect->src_stride, rect->dst_stride) != XST_SUCCESS) return -1;
+        if(rect->src % chan_ctrl->SrcBurstSize != 0 || rect->dst % chan_ctrl->SrcBurstSize != 0) return -1;
+
+        Dma_Prog_Mov(&prog, DMA_REG_SAR, rect->src);
+        Dma_Prog_Mov(&prog, DMA_REG_DAR, rect->dst);
+        Dma_Prog_ShapeBody(&prog, &shape, chan_ctrl);
+    }
+
+    Dma_Prog_Wmb(&prog);
+    Dma_Prog_Sev(&prog, (u8)channel);
+    Dma_Prog_End(&prog);
+
+    if(prog.overflow) return -1;
+    return prog.len;
+}
+
+void Dma_ProgCache_Print_Stats(DmaCtrl *instance_ptr)
+{
+    for(int i = 0; i < DMA_NUM_CHANNELS; i++)
+    {
+        DmaProgCache *cache = &instance_ptr->prog_cache[i];
+        if(cache->hits == 0 && cache->misses == 0 && cache->overflows == 0) continue;
+        xil_printf("[INFO] DMA channel %d programs: %u hits, %u built, %u evicted\n", i, cache->hits, cache->misses, cache->evictions);
+        if(cache->overflows != 0)
+        {
+            xil_printf("[ERROR] DMA channel %d: %u programs did not fit in %u bytes\n", i, cache->overflows, DMA_PROG_SLOT_LEN);
+        }
+    }
+}
+
+void Dma_Fault_Print_Stats(DmaCtrl *instance_ptr)
+{
+    for(int i = 0; i < DMA_NUM_CHANNELS; i++)
+    {
+        DmaChanStats *stats = &instance_ptr->chan_stats[i];
+        if(stats->faults == 0) continue;
+        xil_printf("[ERROR] DMA channel %d: %u faults, last type: 0x%08X, PC: 0x%08X\n", i, stats->faults, stats->fault_type, stats->fault_pc);
+    }
+}
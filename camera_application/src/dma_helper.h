@@ -0,0 +1,166 @@
+#ifndef __DMA_HELPER_H__
+#define __DMA_HELPER_H__
+
+#include "xdmaps.h"
+#include "xscugic.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include <xil_types.h>
+
+#define DMA_NUM_CHANNELS XDMAPS_CHANNELS_PER_DEV
+
+// PL330 events past the interrupt lines, used to chain channel programs without the CPU
+#define DMA_EVENT_HANDOFF_BASE 8U
+
+/*
+    Program cache, one per channel. XDmaPs_GenDmaProg encodes a fresh program for every command;
+    here a program is built once per transfer shape and later commands with the same shape only
+    patch SAR / DAR in place. A channel runs one command at a time and only its owner prepares
+    the next one, so a per channel cache needs no locking and never patches a running program.
+*/
+
+#ifndef DMA_PROG_CACHE_WAYS
+#define DMA_PROG_CACHE_WAYS 4U    // Cached programs per channel
+#endif
+#ifndef DMA_PROG_SLOT_LEN
+#define DMA_PROG_SLOT_LEN   256U  // Bytes per cached program, the driver's own buffers are 128
+#endif
+
+// Transfer shape, the cache key: rows of row_bytes then tail_bytes, all with the same beats
+typedef struct {
+    u32 ccr;            // Increments, beat size, burst length, cache and protection bits
+    u32 row_bytes;
+    u32 rows;
+    u32 tail_bytes;     // Contiguous remainder after the rows
+    u16 src_pad;        // Skipped between rows, stride - row_bytes
+    u16 dst_pad;
+} DmaShape;
+
+typedef struct {
+    DmaShape shape;
+    u16 len;
+    u16 sar_off;
+    u16 dar_off;
+    u8  valid;
+    u32 last_use;
+    u8  prog[DMA_PROG_SLOT_LEN] __attribute__((aligned(32)));
+} DmaProgEntry;
+
+typedef struct {
+    DmaProgEntry entries[DMA_PROG_CACHE_WAYS];
+    u32 use_clock;
+    u32 hits;
+    u32 misses;         // Programs built
+    u32 evictions;
+    u32 overflows;      // Shapes whose program did not fit in DMA_PROG_SLOT_LEN, the request failed
+} DmaProgCache;
+
+// Faults seen on a channel, counted by the fault interrupt, printed from task context
+typedef struct {
+    u32 faults;
+    u32 fault_type;     // FTR of the last fault
+    u32 fault_pc;       // Program counter of the last fault
+} DmaChanStats;
+
+// Channel fault notification, runs in interrupt context after the driver killed the channel
+typedef void (*DmaFaultCallback)(unsigned channel, XDmaPs_Cmd *cmd, void *callback_ref);
+
+// Structure to hold the PS DMA controller ( PL330 ) and its interrupt wiring
+typedef struct {
+    XDmaPs dma_instance;                  // Actual XDmaPs Driver Instance
+    XScuGic *intc_ptr;                    // Pointer to the system interrupt controller
+    DmaFaultCallback fault_cb[DMA_NUM_CHANNELS];
+    void *fault_ref[DMA_NUM_CHANNELS];
+    volatile u32 faults;                  // All channels
+    DmaChanStats chan_stats[DMA_NUM_CHANNELS];
+    DmaProgCache prog_cache[DMA_NUM_CHANNELS];
+} DmaCtrl;
+
+// Initialise the driver and connect the done / fault interrupts of every channel
+int Dma_Helper_Init(DmaCtrl *instance_ptr, UINTPTR dma_base_addr, XScuGic *intc_ptr);
+
+// GIC line of a channel's done interrupt
+u32 Dma_Done_IntrId(unsigned channel);
+
+// Mask / unmask a channel's done interrupt and the fault interrupt shared by all channels, around
+// task context updates of state that the channel's done and fault callbacks also touch
+void Dma_Channel_Lock(DmaCtrl *instance_ptr, unsigned channel);
+void Dma_Channel_Unlock(DmaCtrl *instance_ptr, unsigned channel);
+
+// The done interrupt comes from a DMASEV just before DMAEND, wait for the thread to stop before the next DMAGO
+int Dma_Channel_WaitStopped(DmaCtrl *instance_ptr, unsigned channel);
+
+// Route a channel's faults to its owner
+void Dma_SetFaultCallback(DmaCtrl *instance_ptr, unsigned channel, DmaFaultCallback callback, void *callback_ref);
+
+/*
+    Minimal PL330 program assembler for programs the driver cannot generate ( strides, peripheral
+    flow control, events ). Emitters append to the buffer and flag overflow instead of writing past it.
+*/
+
+#define DMA_REG_SAR 0U
+#define DMA_REG_CCR 1U
+#define DMA_REG_DAR 2U
+
+typedef struct {
+    u8 *buf;
+    int len;
+    int cap;
+    int overflow;
+} DmaProg;
+
+void Dma_Prog_Init(DmaProg *prog, u8 *buf, int cap);
+int  Dma_Prog_Mov(DmaProg *prog, u8 reg, u32 imm);       // DMAMOV SAR / CCR / DAR, returns the imm32 offset
+int  Dma_Prog_Lp(DmaProg *prog, u8 lc, u32 iterations);  // DMALP, returns the loop body start offset
+void Dma_Prog_LpEnd(DmaProg *prog, u8 lc, int body);     // DMALPEND back to body
+void Dma_Prog_Ld(DmaProg *prog);                         // DMALD
+void Dma_Prog_St(DmaProg *prog);                         // DMAST
+void Dma_Prog_AddH(DmaProg *prog, u8 reg, u16 imm);      // DMAADDH SAR / DAR
+void Dma_Prog_FlushP(DmaProg *prog, u8 periph);          // DMAFLUSHP
+void Dma_Prog_WfP(DmaProg *prog, u8 periph);             // DMAWFP periph, wait for a peripheral request
+int  Dma_Prog_Wfe(DmaProg *prog, u8 event);              // DMAWFE, invalidating the DMAC icache, returns its offset
+void Dma_Prog_Sev(DmaProg *prog, u8 event);              // DMASEV, event or interrupt
+void Dma_Prog_Wmb(DmaProg *prog);                        // DMAWMB
+void Dma_Prog_End(DmaProg *prog);                        // DMAEND
+
+// In place edits of a built program, flush the range before the next XDmaPs_Start
+void Dma_Prog_Patch32(u8 *prog, int offset, u32 value);           // imm32 of a DMAMOV
+void Dma_Prog_SetWfe(u8 *prog, int offset, u8 event, int enable); // DMAWFE or two DMANOPs
+
+// Channel control register value, see XDmaPs_ChanCtrl
+u32 Dma_Ccr(XDmaPs_ChanCtrl *chan_ctrl);
+
+// Largest AXI burst length ( 1..16 beats of beat_bytes ) that divides bytes evenly
+u32 Dma_BurstLen(u32 bytes, u32 beat_bytes);
+
+// Contiguous copy of bytes, a multiple of the beat size, in rows of up to 256 bursts
+int Dma_Shape_Linear(DmaShape *shape, XDmaPs_ChanCtrl *chan_ctrl, u32 bytes);
+
+// rows x row_bytes rectangle, strides are row start to row start
+int Dma_Shape_2D(DmaShape *shape, XDmaPs_ChanCtrl *chan_ctrl, u32 row_bytes, u32 rows, u32 src_stride, u32 dst_stride);
+
+// One rectangle of a gather, DMA addresses
+typedef struct {
+    u32 src;
+    u32 dst;
+    u32 row_bytes;
+    u32 rows;
+    u32 src_stride;     // Row start to row start
+    u32 dst_stride;
+} DmaRect;
+
+// Several rectangles back to back in one program, not cached. Returns the length, -1 when a rect
+// does not fit the beats of chan_ctrl or the program does not fit in cap bytes.
+int Dma_Prog_BuildGather(u8 *buf, int cap, XDmaPs_ChanCtrl *chan_ctrl, const DmaRect *rects, u32 count, unsigned channel);
+
+// Fill cmd with the cached program for shape, built on a miss, pointed at src / dst. Strided shapes
+// clear the increments in cmd->ChanCtrl so XDmaPs_Start leaves cache maintenance to the caller.
+int Dma_Prog_Prepare(DmaCtrl *instance_ptr, unsigned channel, const DmaShape *shape,
+                     XDmaPs_ChanCtrl *chan_ctrl, u32 src, u32 dst, XDmaPs_Cmd *cmd);
+
+void Dma_ProgCache_Print_Stats(DmaCtrl *instance_ptr);
+
+// Channels that faulted since init, with the last fault of each
+void Dma_Fault_Print_Stats(DmaCtrl *instance_ptr);
+
+#endif
@@ -0,0 +1,501 @@
+#include "dma_service.h"
+#include "cache_policy.h"
+#include "xil_cache.h"
+#include <string.h>
+
+// Widest beat ( 8, 4, 2 or 1 bytes ) all of the OR'ed addresses, lengths and strides are aligned to
+static u32 Dma_Service_Beat(u32 bits)
+{
+    if((bits & 7U) == 0) return 8;
+    if((bits & 3U) == 0) return 4;
+    if((bits & 1U) == 0) return 2;
+    return 1;
+}
+
+// Rectangles of a 2D request, 0 for the linear ones
+static u32 Dma_Service_Rects(DmaXfer *xfer, const DmaRect **rects)
+{
+    if(xfer->type == DMA_XFER_RECT)
+    {
+        *rects = &xfer->rect;
+        return 1;
+    }
+    if(xfer->type == DMA_XFER_GATHER)
+    {
+        *rects = xfer->rects;
+        return xfer->count;
+    }
+    *rects = NULL;
+    return 0;
+}
+
+// Source cleaned to DDR, destination cleaned so no dirty line is evicted over the DMA data
+static void Dma_Service_Clean(DmaXfer *xfer)
+{
+    const DmaRect *rects;
+    u32 count = Dma_Service_Rects(xfer, &rects);
+
+    if(xfer->type == DMA_XFER_FILL) Cache_Sync_ForDevice(&xfer->pattern, sizeof(xfer->pattern));
+    if(count == 0)
+    {
+        if(xfer->type == DMA_XFER_COPY) Cache_Sync_ForDevice(xfer->src, xfer->bytes);
+        Cache_Sync_ForDevice(xfer->dst, xfer->bytes);
+        return;
+    }
+
+    // Whole spans, cleaning the bytes between the rows is harmless and one call per rectangle
+    for(u32 i = 0; i < count; i++)
+    {
+        const DmaRect *r = &rects[i];
+        Cache_Sync_ForDevice((const void *)(UINTPTR)r->src, (r->rows - 1) * r->src_stride + r->row_bytes);
+        Cache_Sync_ForDevice((const void *)(UINTPTR)r->dst, (r->rows - 1) * r->dst_stride + r->row_bytes);
+    }
+}
+
+// Drop lines the A9 speculatively pulled in during the transfer, only the written rows
+static void Dma_Service_Invalidate(DmaXfer *xfer)
+{
+    const DmaRect *rects;
+    u32 count = Dma_Service_Rects(xfer, &rects);
+
+    if(count == 0)
+    {
+        Cache_Sync_ForCpu(xfer->dst, xfer->bytes);
+        return;
+    }
+    for(u32 i = 0; i < count; i++)
+    {
+        const DmaRect *r = &rects[i];
+        u32 span = (r->rows - 1) * r->dst_stride + r->row_bytes;
+
+        // Dense rows, or a span big enough for the full clean and invalidate, which keeps the bytes in between
+        if(r->dst_stride == r->row_bytes || span >= Cache_Policy_GetThreshold())
+        {
+            Cache_Sync_ForCpu((const void *)(UINTPTR)r->dst, span);
+            continue;
+        }
+        for(u32 row = 0; row < r->rows; row++)
+        {
+            Cache_Sync_ForCpu((const void *)(UINTPTR)(r->dst + row * r->dst_stride), r->row_bytes);
+        }
+    }
+}
+
+// Point the channel command at the request's program
+static int Dma_Service_Prepare(DmaSvcChannel *chan, DmaXfer *xfer)
+{
+    DmaService *svc = chan->svc;
+    XDmaPs_ChanCtrl chan_ctrl = { 0 };
+    DmaShape shape;
+    const DmaRect *rects;
+    u32 count = Dma_Service_Rects(xfer, &rects);
+    u32 src = (xfer->type == DMA_XFER_FILL) ? (u32)(UINTPTR)&xfer->pattern : (u32)(UINTPTR)xfer->src;
+    u32 dst = (u32)(UINTPTR)xfer->dst;
+    u32 bits = ((xfer->type == DMA_XFER_FILL) ? 0 : src) | dst | xfer->bytes;
+    int status;
+    int len;
+
+    for(u32 i = 0; i < count; i++)
+    {
+        bits |= rects[i].src | rects[i].dst | rects[i].row_bytes | rects[i].src_stride | rects[i].dst_stride;
+    }
+
+    chan_ctrl.SrcBurstSize = Dma_Service_Beat(bits);
+    chan_ctrl.SrcBurstLen = 16;
+    chan_ctrl.SrcInc = (xfer->type != DMA_XFER_FILL);
+    chan_ctrl.DstBurstSize = chan_ctrl.SrcBurstSize;
+    chan_ctrl.DstBurstLen = 16;
+    chan_ctrl.DstInc = 1;
+
+    switch(xfer->type)
+    {
+        case DMA_XFER_COPY:
+        case DMA_XFER_FILL:
+            status = Dma_Shape_Linear(&shape, &chan_ctrl, xfer->bytes);
+            if(status == XST_SUCCESS) status = Dma_Prog_Prepare(svc->dma, chan->channel, &shape, &chan_ctrl, src, dst, &chan->cmd);
+            break;
+
+        case DMA_XFER_RECT:
+            status = Dma_Shape_2D(&shape, &chan_ctrl, xfer->rect.row_bytes, xfer->rect.rows, xfer->rect.src_stride, xfer->rect.dst_stride);
+            if(status == XST_SUCCESS) status = Dma_Prog_Prepare(svc->dma, chan->channel, &shape, &chan_ctrl, xfer->rect.src, xfer->rect.dst, &chan->cmd);
+            break;
+
+        default:
+            // A gather changes with every call, it is built in place rather than cached
+            len = Dma_Prog_BuildGather(chan->gather_prog, DMA_SVC_GATHER_LEN, &chan_ctrl, xfer->rects, xfer->count, chan->channel);
+            if(len < 0)
+            {
+                status = XST_INVALID_PARAM;
+                break;
+            }
+            Xil_DCacheFlushRange((INTPTR)chan->gather_prog, len);
+            chan->cmd.UserDmaProg = chan->gather_prog;
+            chan->cmd.UserDmaProgLength = len;
+            chan->cmd.GeneratedDmaProg = NULL;
+            chan->cmd.GeneratedDmaProgLength = 0;
+            status = XST_SUCCESS;
+            break;
+    }
+
+    // Cache maintenance is ours, keep XDmaPs_Start from repeating it
+    chan->cmd.ChanCtrl = chan_ctrl;
+    chan->cmd.ChanCtrl.SrcInc = 0;
+    chan->cmd.ChanCtrl.DstInc = 0;
+    return status;
+}
+
+// Start the request at the head of the queue, called with the channel locked or from its handlers
+static void Dma_Service_Next(DmaSvcChannel *chan)
+{
+    DmaService *svc = chan->svc;
+
+    while(chan->queue_head != chan->queue_tail && !XDmaPs_IsActive(&svc->dma->dma_instance, chan->channel))
+    {
+        DmaXfer *xfer = chan->queue[chan->queue_head % DMA_SVC_QUEUE_DEPTH];
+        int status;
+
+        status = Dma_Service_Prepare(chan, xfer);
+        if(status == XST_SUCCESS)
+        {
+            Dma_Service_Clean(xfer);
+            status = Dma_Channel_WaitStopped(svc->dma, chan->channel);
+        }
+        if(status == XST_SUCCESS) status = XDmaPs_Start(&svc->dma->dma_instance, chan->channel, &chan->cmd, TRUE);
+        if(status == XST_SUCCESS) return;
+
+        // Could not start, fail it and try the next one
+        chan->queue_head++;
+        chan->queued_bytes -= xfer->bytes;
+        svc->stats.errors++;
+        xfer->status = XST_FAILURE;
+        if(xfer->callback != NULL) xfer->callback(xfer, xfer->callback_ref);
+    }
+}
+
+static void Dma_Service_Complete(DmaSvcChannel *chan, int status)
+{
+    DmaService *svc = chan->svc;
+    DmaXfer *xfer;
+    XTime now;
+
+    if(chan->queue_head == chan->queue_tail) return;
+
+    xfer = chan->queue[chan->queue_head % DMA_SVC_QUEUE_DEPTH];
+    chan->queue_head++;
+    chan->queued_bytes -= xfer->bytes;
+
+    Dma_Service_Invalidate(xfer);
+
+    XTime_GetTime(&now);
+    svc->stats.busy_ticks += now - xfer->t_submit;
+    if(status != XST_SUCCESS) svc->stats.errors++;
+
+    xfer->status = status;
+    if(xfer->callback != NULL) xfer->callback(xfer, xfer->callback_ref);
+}
+
+static void Dma_Service_DoneHandler(unsigned int channel, XDmaPs_Cmd *cmd, void *callback_ref)
+{
+    DmaSvcChannel *chan = (DmaSvcChannel *)callback_ref;
+    (void)channel;
+    (void)cmd;
+
+    Dma_Service_Complete(chan, XST_SUCCESS);
+    Dma_Service_Next(chan);
+}
+
+static void Dma_Service_FaultHandler(unsigned channel, XDmaPs_Cmd *cmd, void *callback_ref)
+{
+    DmaSvcChannel *chan = (DmaSvcChannel *)callback_ref;
+    (void)channel;
+    (void)cmd;
+
+    Dma_Service_Complete(chan, XST_FAILURE);
+    Dma_Service_Next(chan);
+}
+
+int Dma_Service_Init(DmaService *svc, DmaCtrl *dma, u32 channel_mask)
+{
+    channel_mask &= (1U << DMA_NUM_CHANNELS) - 1U;
+    if(channel_mask == 0) return XST_INVALID_PARAM;
+
+    svc->dma = dma;
+    svc->channel_mask = channel_mask;
+    svc->stats.copies = 0;
+    svc->stats.fills = 0;
+    svc->stats.rects = 0;
+    svc->stats.bytes = 0;
+    svc->stats.cpu_requests = 0;
+    svc->stats.errors = 0;
+    svc->stats.queue_full = 0;
+    svc->stats.busy_ticks = 0;
+
+    for(unsigned i = 0; i < DMA_NUM_CHANNELS; i++)
+    {
+        DmaSvcChannel *chan = &svc->chans[i];
+        chan->svc = svc;
+        chan->channel = i;
+        chan->queue_head = 0;
+        chan->queue_tail = 0;
+        chan->queued_bytes = 0;
+        if(!(channel_mask & (1U << i))) continue;
+
+        XDmaPs_SetDoneHandler(&dma->dma_instance, i, Dma_Service_DoneHandler, chan);
+        Dma_SetFaultCallback(dma, i, Dma_Service_FaultHandler, chan);
+    }
+
+    xil_printf("[INFO] DMA service on channel mask 0x%02X\n", channel_mask);
+    return XST_SUCCESS;
+}
+
+// Least loaded channel with room in its queue, NULL when all are full
+static DmaSvcChannel* Dma_Service_Pick(DmaService *svc)
+{
+    DmaSvcChannel *best = NULL;
+
+    for(unsigned i = 0; i < DMA_NUM_CHANNELS; i++)
+    {
+        DmaSvcChannel *chan = &svc->chans[i];
+        if(!(svc->channel_mask & (1U << i))) continue;
+        if(chan->queue_tail - chan->queue_head >= DMA_SVC_QUEUE_DEPTH) continue;
+        if(best == NULL || chan->queued_bytes < best->queued_bytes) best = chan;
+    }
+    return best;
+}
+
+static int Dma_Service_Submit(DmaService *svc, DmaXfer *xfer)
+{
+    DmaSvcChannel *chan;
+
+    // Small requests finish before a program could even be started
+    if(xfer->bytes < DMA_SVC_CPU_BYTES)
+    {
+        const DmaRect *rects;
+        u32 count = Dma_Service_Rects(xfer, &rects);
+
+        if(xfer->type == DMA_XFER_FILL) memset(xfer->dst, (u8)xfer->pattern, xfer->bytes);
+        else if(xfer->type == DMA_XFER_COPY) memcpy(xfer->dst, xfer->src, xfer->bytes);
+        for(u32 i = 0; i < count; i++)
+        {
+            for(u32 row = 0; row < rects[i].rows; row++)
+            {
+                memcpy((u8 *)(UINTPTR)(rects[i].dst + row * rects[i].dst_stride),
+                       (const u8 *)(UINTPTR)(rects[i].src + row * rects[i].src_stride), rects[i].row_bytes);
+            }
+        }
+        svc->stats.cpu_requests++;
+        xfer->status = XST_SUCCESS;
+        if(xfer->callback != NULL) xfer->callback(xfer, xfer->callback_ref);
+        return XST_SUCCESS;
+    }
+
+    chan = Dma_Service_Pick(svc);
+    if(chan == NULL)
+    {
+        svc->stats.queue_full++;
+        return XST_DEVICE_BUSY;
+    }
+
+    // The done and the fault handler both move the queue head
+    Dma_Channel_Lock(svc->dma, chan->channel);
+
+    xfer->channel = (u8)chan->channel;
+    xfer->status = XST_DEVICE_BUSY;
+    XTime_GetTime(&xfer->t_submit);
+    chan->queue[chan->queue_tail % DMA_SVC_QUEUE_DEPTH] = xfer;
+    chan->queue_tail++;
+    chan->queued_bytes += xfer->bytes;
+    if(xfer->type == DMA_XFER_FILL) svc->stats.fills++;
+    else if(xfer->type == DMA_XFER_COPY) svc->stats.copies++;
+    else svc->stats.rects++;
+    svc->stats.bytes += xfer->bytes;
+    Dma_Service_Next(chan);
+
+    Dma_Channel_Unlock(svc->dma, chan->channel);
+
+    return XST_SUCCESS;
+}
+
+int Dma_Copy_Async(DmaService *svc, DmaXfer *xfer, void *dst, const void *src, u32 bytes, DmaXferCallback callback, void *callback_ref)
+{
+    if(dst == NULL || src == NULL || bytes == 0) return XST_INVALID_PARAM;
+
+    xfer->type = DMA_XFER_COPY;
+    xfer->dst = (u8 *)dst;
+    xfer->src = (const u8 *)src;
+    xfer->bytes = bytes;
+    xfer->callback = callback;
+    xfer->callback_ref = callback_ref;
+
+    return Dma_Service_Submit(svc, xfer);
+}
+
+int Dma_Fill_Async(DmaService *svc, DmaXfer *xfer, void *dst, u8 value, u32 bytes, DmaXferCallback callback, void *callback_ref)
+{
+    if(dst == NULL || bytes == 0) return XST_INVALID_PARAM;
+
+    xfer->type = DMA_XFER_FILL;
+    xfer->pattern = 0x0101010101010101ULL * value;
+    xfer->dst = (u8 *)dst;
+    xfer->src = NULL;
+    xfer->bytes = bytes;
+    xfer->callback = callback;
+    xfer->callback_ref = callback_ref;
+
+    return Dma_Service_Submit(svc, xfer);
+}
+
+int Dma_Copy2D_Async(DmaService *svc, DmaXfer *xfer, void *dst, u32 dst_stride, const void *src, u32 src_stride,
+                     u32 row_bytes, u32 rows, DmaXferCallback callback, void *callback_ref)
+{
+    if(dst == NULL || src == NULL || row_bytes == 0 || rows == 0) return XST_INVALID_PARAM;
+    if(src_stride < row_bytes || dst_stride < row_bytes) return XST_INVALID_PARAM;
+
+    xfer->type = DMA_XFER_RECT;
+    xfer->rect.src = (u32)(UINTPTR)src;
+    xfer->rect.dst = (u32)(UINTPTR)dst;
+    xfer->rect.row_bytes = row_bytes;
+    xfer->rect.rows = rows;
+    xfer->rect.src_stride = src_stride;
+    xfer->rect.dst_stride = dst_stride;
+    xfer->dst = (u8 *)dst;
+    xfer->src = (const u8 *)src;
+    xfer->bytes = row_bytes * rows;
+    xfer->callback = callback;
+    xfer->callback_ref = callback_ref;
+
+    return Dma_Service_Submit(svc, xfer);
+}
+
+int Dma_Gather_Async(DmaService *svc, DmaXfer *xfer, const DmaRect *rects, u32 count, DmaXferCallback callback, void *callback_ref)
+{
+    if(rects == NULL || count == 0 || count > DMA_SVC_MAX_RECTS) return XST_INVALID_PARAM;
+
+    xfer->type = DMA_XFER_GATHER;
+    xfer->rects = rects;
+    xfer->count = count;
+    xfer->dst = (u8 *)(UINTPTR)rects[0].dst;
+    xfer->src = (const u8 *)(UINTPTR)rects[0].src;
+    xfer->bytes = 0;
+    for(u32 i = 0; i < count; i++)
+    {
+        if(rects[i].row_bytes == 0 || rects[i].rows == 0) return XST_INVALID_PARAM;
+        if(rects[i].src_stride < rects[i].row_bytes || rects[i].dst_stride < rects[i].row_bytes) return XST_INVALID_PARAM;
+        xfer->bytes += rects[i].row_bytes * rects[i].rows;
+    }
+    xfer->callback = callback;
+    xfer->callback_ref = callback_ref;
+
+    return Dma_Service_Submit(svc, xfer);
+}
+
+int Dma_Xfer_Poll(DmaXfer *xfer)
+{
+    return xfer->status;
+}
+
+int Dma_Xfer_Wait(DmaXfer *xfer)
+{
+    while(xfer->status == XST_DEVICE_BUSY);
+    return xfer->status;
+}
+
+int Dma_Service_Idle(DmaService *svc)
+{
+    for(unsigned i = 0; i < DMA_NUM_CHANNELS; i++)
+    {
+        if(svc->chans[i].queue_head != svc->chans[i].queue_tail) return FALSE;
+    }
+    return TRUE;
+}
+
+int Dma_Service_SelfTest(DmaService *svc, u8 *a, u8 *b, u32 bytes)
+{
+    // Whole buffer, a misaligned odd piece and one small enough for the CPU path
+    const u32 offsets[3] = { 0, 3, 64 };
+    const u32 lengths[3] = { bytes, bytes / 2 + 5, DMA_SVC_CPU_BYTES / 2 };
+    DmaXfer fill[3], copy[3];
+    int status = XST_SUCCESS;
+
+    for(int i = 0; i < 3 && status == XST_SUCCESS; i++)
+    {
+        if(offsets[i] + lengths[i] > bytes) continue;
+        // Both fills in flight at once, they land on different channels
+        status = Dma_Fill_Async(svc, &copy[i], b + offsets[i], 0x00, lengths[i], NULL, NULL);
+        if(status == XST_SUCCESS) status = Dma_Fill_Async(svc, &fill[i], a + offsets[i], (u8)(0x5A + i), lengths[i], NULL, NULL);
+        if(status == XST_SUCCESS) status = Dma_Xfer_Wait(&fill[i]);
+        if(status == XST_SUCCESS) status = Dma_Xfer_Wait(&copy[i]);
+        if(status == XST_SUCCESS) status = Dma_Copy_Async(svc, &copy[i], b + offsets[i], a + offsets[i], lengths[i], NULL, NULL);
+        if(status == XST_SUCCESS) status = Dma_Xfer_Wait(&copy[i]);
+
+        for(u32 j = 0; j < lengths[i] && status == XST_SUCCESS; j++)
+        {
+            if(b[offsets[i] + j] != (u8)(0x5A + i))
+            {
+                xil_printf("[ERROR] DMA self test %d: byte %u is 0x%02X\n", i, j, b[offsets[i] + j]);
+                status = XST_FAILURE;
+            }
+        }
+    }
+
+    // 2D crop of a 1280 byte stride frame into a dense buffer, then two rows gathered behind it
+    if(status == XST_SUCCESS && bytes >= 64 * 1280)
+    {
+        DmaXfer rect;
+        DmaRect parts[2] = {
+            { (u32)(UINTPTR)(a + 5 * 1280 + 40), (u32)(UINTPTR)(b + 64 * 128), 128, 2, 1280, 128 },
+            { (u32)(UINTPTR)(a + 60 * 1280),     (u32)(UINTPTR)(b + 66 * 128), 256, 1, 1280, 256 },
+        };
+
+        for(u32 i = 0; i < 64 * 1280; i++) a[i] = (u8)(i * 7 + (i >> 8));
+        status = Dma_Copy2D_Async(svc, &rect, b, 128, a + 8 * 1280 + 64, 1280, 128, 64, NULL, NULL);
+        if(status == XST_SUCCESS) status = Dma_Gather_Async(svc, &copy[0], parts, 2, NULL, NULL);
+        if(status == XST_SUCCESS) status = Dma_Xfer_Wait(&rect);
+        if(status == XST_SUCCESS) status = Dma_Xfer_Wait(&copy[0]);
+
+        for(u32 row = 0; row < 64 && status == XST_SUCCESS; row++)
+        {
+            if(memcmp(b + row * 128, a + (8 + row) * 1280 + 64, 128) != 0) status = XST_FAILURE;
+        }
+        if(status == XST_SUCCESS && (memcmp(b + 64 * 128, a + 5 * 1280 + 40, 128) != 0 ||
+                                     memcmp(b + 65 * 128, a + 6 * 1280 + 40, 128) != 0 ||
+                                     memcmp(b + 66 * 128, a + 60 * 1280, 256) != 0))
+        {
+            status = XST_FAILURE;
+        }
+        if(status != XST_SUCCESS) xil_printf("[ERROR] DMA self test: rectangle copy mismatch\n");
+    }
+
+    if(status == XST_SUCCESS) xil_printf("[INFO] DMA service self test passed\n");
+    else xil_printf("[ERROR] DMA service self test failed with status: %d\n", status);
+    return status;
+}
+
+void Dma_Service_GetStats(DmaService *svc, DmaSvcStats *stats)
+{
+    stats->copies = svc->stats.copies;
+    stats->fills = svc->stats.fills;
+    stats->rects = svc->stats.rects;
+    stats->bytes = svc->stats.bytes;
+    stats->cpu_requests = svc->stats.cpu_requests;
+    stats->errors = svc->stats.errors;
+    stats->queue_full = svc->stats.queue_full;
+    stats->busy_ticks = svc->stats.busy_ticks;
+}
+
+void Dma_Service_Print_Stats(DmaService *svc)
+{
+    DmaSvcStats stats;
+    u32 requests;
+
+    Dma_Service_GetStats(svc, &stats);
+    requests = stats.copies + stats.fills + stats.rects;
+    xil_printf("[INFO] DMA service: %u copies, %u fills, %u rects, %u KB, %u on CPU, %u errors, %u queue full\n",
+               stats.copies, stats.fills, stats.rects, stats.bytes >> 10, stats.cpu_requests, stats.errors, stats.queue_full);
+    if(requests != 0)
+    {
+        xil_printf("[INFO] DMA service: %u us average submit -> done\n", (u32)((stats.busy_ticks / requests) / (COUNTS_PER_SECOND / 1000000)));
+    }
+    Dma_ProgCache_Print_Stats(svc->dma);
+    Dma_Fault_Print_Stats(svc->dma);
+}
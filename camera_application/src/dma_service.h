@@ -0,0 +1,108 @@
+#ifndef __DMA_SERVICE_H__
+#define __DMA_SERVICE_H__
+
+#include "dma_helper.h"
+#include "xiltimer.h"
+
+/*
+    Asynchronous memory copy and fill on the PS DMA. Requests are queued per channel and spread
+    over the channels given to the service, the caller keeps the DmaXfer and polls or waits on it
+    like an IicTxn. Cache maintenance of the ranges is done here, so buffers stay cacheable.
+*/
+
+#define DMA_SVC_QUEUE_DEPTH 16U    // Outstanding requests per channel
+#define DMA_SVC_CPU_BYTES   256U   // Smaller requests are done on the CPU, the DMA setup costs more
+#define DMA_SVC_MAX_RECTS   16U    // Rectangles per gather
+#define DMA_SVC_GATHER_LEN  1024U  // Bytes of a channel's gather program
+
+typedef enum {
+    DMA_XFER_COPY,
+    DMA_XFER_FILL,
+    DMA_XFER_RECT,      // One 2D rectangle, rect
+    DMA_XFER_GATHER,    // rects[count] in one chained program
+} DmaXferType;
+
+typedef struct DmaXfer DmaXfer;
+typedef struct DmaService DmaService;
+
+// Completion callback, runs in interrupt context so keep it short
+typedef void (*DmaXferCallback)(DmaXfer *xfer, void *callback_ref);
+
+// A queued request, owned by the caller until its status leaves XST_DEVICE_BUSY
+struct DmaXfer {
+    u64 pattern;                  // Fill source, the value byte repeated, read by the DMA
+    DmaXferType type;
+    u8 *dst;
+    const u8 *src;
+    u32 bytes;                    // Payload, summed over the rectangles
+    DmaRect rect;                 // DMA_XFER_RECT
+    const DmaRect *rects;         // DMA_XFER_GATHER, caller memory until done
+    u32 count;
+    DmaXferCallback callback;     // Optional, NULL to only poll
+    void *callback_ref;
+    volatile int status;          // XST_DEVICE_BUSY until the request is done
+    u8 channel;                   // Channel it was queued on
+    XTime t_submit;
+} __attribute__((aligned(8)));
+
+typedef struct {
+    DmaService *svc;
+    unsigned channel;
+    DmaXfer *queue[DMA_SVC_QUEUE_DEPTH];
+    volatile u32 queue_head;      // Request on the channel or next to start ( interrupt side )
+    volatile u32 queue_tail;      // Next free slot ( submit side )
+    volatile u32 queued_bytes;    // Load estimate for picking a channel
+    XDmaPs_Cmd cmd;
+    u8 gather_prog[DMA_SVC_GATHER_LEN] __attribute__((aligned(32)));
+} DmaSvcChannel;
+
+typedef struct {
+    u32 copies;
+    u32 fills;
+    u32 rects;                    // Rectangle copies and gathers
+    u32 bytes;
+    u32 cpu_requests;             // Below DMA_SVC_CPU_BYTES, done in the submit call
+    u32 errors;
+    u32 queue_full;
+    u64 busy_ticks;               // Sum of submit -> completion time of DMA requests
+} DmaSvcStats;
+
+struct DmaService {
+    DmaCtrl *dma;
+    u32 channel_mask;             // Channels owned by the service
+    DmaSvcChannel chans[DMA_NUM_CHANNELS];
+    volatile DmaSvcStats stats;
+};
+
+// Take over the channels in channel_mask, bit n for channel n
+int Dma_Service_Init(DmaService *svc, DmaCtrl *dma, u32 channel_mask);
+
+// Non-blocking, return XST_DEVICE_BUSY when every queue is full. Ranges must not be touched by the CPU until done,
+// for rectangles that is everything from the first to the last row.
+int Dma_Copy_Async(DmaService *svc, DmaXfer *xfer, void *dst, const void *src, u32 bytes, DmaXferCallback callback, void *callback_ref);
+int Dma_Fill_Async(DmaService *svc, DmaXfer *xfer, void *dst, u8 value, u32 bytes, DmaXferCallback callback, void *callback_ref);
+
+// rows x row_bytes rectangle, strides are row start to row start. For ROI crops and repacking padded lines.
+int Dma_Copy2D_Async(DmaService *svc, DmaXfer *xfer, void *dst, u32 dst_stride, const void *src, u32 src_stride,
+                     u32 row_bytes, u32 rows, DmaXferCallback callback, void *callback_ref);
+
+// Several rectangles in one program and one completion, e.g. tiles packed into a transmit buffer
+int Dma_Gather_Async(DmaService *svc, DmaXfer *xfer, const DmaRect *rects, u32 count, DmaXferCallback callback, void *callback_ref);
+
+// Status of a request, XST_DEVICE_BUSY while pending
+int Dma_Xfer_Poll(DmaXfer *xfer);
+
+// Block until a request completes and return its status
+int Dma_Xfer_Wait(DmaXfer *xfer);
+
+// TRUE once every queued request has completed
+int Dma_Service_Idle(DmaService *svc);
+
+// Fill a, copy it to b and crop / gather rectangles out of it, checked on the CPU. Exercises odd lengths,
+// the CPU path and several channels.
+int Dma_Service_SelfTest(DmaService *svc, u8 *a, u8 *b, u32 bytes);
+
+void Dma_Service_GetStats(DmaService *svc, DmaSvcStats *stats);
+void Dma_Service_Print_Stats(DmaService *svc);
+
+#endif
@@ -0,0 +1,162 @@
+#include "frame_pool.h"
+
+// Region left for pools, bump allocated at init
+static u8 *frame_mem_next;
+static u8 *frame_mem_end;
+
+#define FREE_INDEX(head) ((head) & 0xFFFFU)
+#define FREE_TAG(head)   ((head) >> 16)
+#define FREE_HEAD(index, tag) (((u32)(tag) << 16) | (u32)(index))
+
+int Frame_Mem_Init(void *base, u32 size)
+{
+    UINTPTR start = ((UINTPTR)base + FRAME_ALIGN - 1U) & ~(UINTPTR)(FRAME_ALIGN - 1U);
+    UINTPTR end = (UINTPTR)base + size;
+
+    if(base == NULL || start >= end)
+    {
+        xil_printf("[ERROR] Invalid frame memory region, size: %u\n", size);
+        return XST_INVALID_PARAM;
+    }
+
+    frame_mem_next = (u8 *)start;
+    frame_mem_end = (u8 *)end;
+
+    xil_printf("[INFO] Frame memory: %u KB at 0x%08X\n", (u32)((end - start) >> 10), (u32)start);
+    return XST_SUCCESS;
+}
+
+u32 Frame_Mem_Available(void)
+{
+    return (u32)(frame_mem_end - frame_mem_next);
+}
+
+void* Frame_Mem_Alloc(u32 size, u32 align)
+{
+    UINTPTR start;
+
+    if(frame_mem_next == NULL || align == 0 || (align & (align - 1U)) != 0) return NULL;
+
+    start = ((UINTPTR)frame_mem_next + align - 1U) & ~(UINTPTR)(align - 1U);
+    if(start >= (UINTPTR)frame_mem_end || size > (UINTPTR)frame_mem_end - start)
+    {
+        xil_printf("[ERROR] Frame memory exhausted, need %u bytes aligned to 0x%X\n", size, align);
+        return NULL;
+    }
+
+    // The alignment gap is lost, this is for a few init time blocks only
+    frame_mem_next = (u8 *)(start + size);
+    return (void *)start;
+}
+
+u32 Frame_BlockSize(u32 width, u32 height, u32 bytes_per_pixel)
+{
+    return FRAME_ALIGN_UP(width * height * bytes_per_pixel);
+}
+
+int FramePool_Create(FramePool *pool, const char *name, u32 block_size, u32 block_count)
+{
+    u32 total;
+
+    if(block_size == 0 || block_count == 0 || block_count > FRAME_POOL_MAX_BLOCKS) return XST_INVALID_PARAM;
+
+    block_size = FRAME_ALIGN_UP(block_size);
+    total = block_size * block_count;
+    if(frame_mem_next == NULL || total > Frame_Mem_Available())
+    {
+        xil_printf("[ERROR] Frame memory exhausted creating pool %s, need %u bytes\n", name, total);
+        return XST_FAILURE;
+    }
+
+    pool->name = name;
+    pool->block_size = block_size;
+    pool->block_count = block_count;
+
+    for(u32 i = 0; i < block_count; i++)
+    {
+        FrameBuf *buf = &pool->bufs[i];
+        buf->data = frame_mem_next + i * block_size;
+        buf->pool = pool;
+        buf->refs = 0;
+        buf->index = (u16)i;
+        pool->next_free[i] = (i + 1 < block_count) ? (u16)(i + 1) : FRAME_POOL_EMPTY;
+    }
+    pool->free_head = FREE_HEAD(0, 0);
+    frame_mem_next += total;
+
+    pool->stats.allocs = 0;
+    pool->stats.releases = 0;
+    pool->stats.failures = 0;
+    pool->stats.in_use = 0;
+    pool->stats.high_water = 0;
+
+    xil_printf("[INFO] Frame pool %s: %u x %u bytes\n", name, block_count, block_size);
+    return XST_SUCCESS;
+}
+
+FrameBuf* FramePool_Alloc(FramePool *pool)
+{
+    u32 head = __atomic_load_n(&pool->free_head, __ATOMIC_ACQUIRE);
+    u32 next, in_use, high;
+
+    // Pop the free list, the tag changes on every pop so a recycled index cannot fool the CAS
+    do {
+        if(FREE_INDEX(head) == FRAME_POOL_EMPTY)
+        {
+            __atomic_fetch_add(&pool->stats.failures, 1, __ATOMIC_RELAXED);
+            return NULL;
+        }
+        next = FREE_HEAD(pool->next_free[FREE_INDEX(head)], FREE_TAG(head) + 1);
+    } while(!__atomic_compare_exchange_n(&pool->free_head, &head, next, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    FrameBuf *buf = &pool->bufs[FREE_INDEX(head)];
+    buf->refs = 1;
+
+    __atomic_fetch_add(&pool->stats.allocs, 1, __ATOMIC_RELAXED);
+    in_use = __atomic_add_fetch(&pool->stats.in_use, 1, __ATOMIC_RELAXED);
+    high = __atomic_load_n(&pool->stats.high_water, __ATOMIC_RELAXED);
+    while(in_use > high && !__atomic_compare_exchange_n(&pool->stats.high_water, &high, in_use, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    return buf;
+}
+
+void FrameBuf_Retain(FrameBuf *buf)
+{
+    __atomic_fetch_add(&buf->refs, 1, __ATOMIC_RELAXED);
+}
+
+void FrameBuf_Release(FrameBuf *buf)
+{
+    FramePool *pool = buf->pool;
+    u32 head, next;
+
+    // Release ordering so every write to the frame happens before another owner can get it
+    if(__atomic_sub_fetch(&buf->refs, 1, __ATOMIC_ACQ_REL) != 0) return;
+
+    head = __atomic_load_n(&pool->free_head, __ATOMIC_RELAXED);
+    do {
+        pool->next_free[buf->index] = (u16)FREE_INDEX(head);
+        next = FREE_HEAD(buf->index, FREE_TAG(head) + 1);
+    } while(!__atomic_compare_exchange_n(&pool->free_head, &head, next, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    __atomic_fetch_add(&pool->stats.releases, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&pool->stats.in_use, 1, __ATOMIC_RELAXED);
+}
+
+void FramePool_GetStats(FramePool *pool, FramePoolStats *stats)
+{
+    stats->allocs = pool->stats.allocs;
+    stats->releases = pool->stats.releases;
+    stats->failures = pool->stats.failures;
+    stats->in_use = pool->stats.in_use;
+    stats->high_water = pool->stats.high_water;
+}
+
+void FramePool_Print_Stats(FramePool *pool)
+{
+    FramePoolStats st;
+
+    FramePool_GetStats(pool, &st);
+    xil_printf("[INFO] Frame pool %s: %u / %u in use, high water %u, allocs %u, releases %u, failures %u\n",
+               pool->name, st.in_use, pool->block_count, st.high_water, st.allocs, st.releases, st.failures);
+}
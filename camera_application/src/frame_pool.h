@@ -0,0 +1,82 @@
+#ifndef __FRAME_POOL_H__
+#define __FRAME_POOL_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "xiltimer.h"
+
+/*
+    Fixed block frame buffers carved out of the .frame_mem DDR region ( lscript.ld ).
+    Pools are sized once at init, alloc / release are O(1) and lock free so capture
+    interrupts and either core can use them, and nothing ever fragments.
+*/
+
+#define FRAME_ALIGN           32U  // Cortex-A9 L1 / L2 cache line
+#define FRAME_POOL_MAX_BLOCKS 32U  // Per pool
+#define FRAME_POOL_EMPTY      0xFFFFU
+
+#define FRAME_ALIGN_UP(x) (((x) + FRAME_ALIGN - 1U) & ~(FRAME_ALIGN - 1U))
+
+typedef struct FramePool FramePool;
+
+// One frame sized block, handed out with refs = 1
+typedef struct {
+    u8 *data;             // FRAME_ALIGN aligned, pool->block_size bytes
+    FramePool *pool;
+    volatile u32 refs;    // Block goes back to the pool when this drops to 0
+    u16 index;            // Slot in the pool
+
+    // Filled by the producer, carried along with the pixels
+    u16 width;
+    u16 height;
+    u16 stride;           // Bytes per line
+    u8  format;           // OV7670_Format of the pixels
+    u32 sequence;
+    XTime timestamp;
+} FrameBuf;
+
+typedef struct {
+    u32 allocs;
+    u32 releases;
+    u32 failures;         // Alloc found the pool empty
+    u32 in_use;
+    u32 high_water;       // Most blocks ever in use at once
+} FramePoolStats;
+
+struct FramePool {
+    const char *name;
+    u32 block_size;       // Rounded up to FRAME_ALIGN
+    u32 block_count;
+    FrameBuf bufs[FRAME_POOL_MAX_BLOCKS];
+    u16 next_free[FRAME_POOL_MAX_BLOCKS];
+    volatile u32 free_head;   // Free list head index in [15:0], ABA tag in [31:16]
+    volatile FramePoolStats stats;
+};
+
+// Hand the frame memory region to the allocator, main.c passes the linker symbols
+int Frame_Mem_Init(void *base, u32 size);
+
+// Bytes of the region not yet given to a pool
+u32 Frame_Mem_Available(void);
+
+// Raw block from the region, align a power of 2 ( 1 MB for regions whose MMU attributes change ), init time only
+void* Frame_Mem_Alloc(u32 size, u32 align);
+
+// Bytes of one block for a frame geometry, cache line rounded
+u32 Frame_BlockSize(u32 width, u32 height, u32 bytes_per_pixel);
+
+// Carve block_count blocks of block_size bytes out of the region, init time only
+int FramePool_Create(FramePool *pool, const char *name, u32 block_size, u32 block_count);
+
+// Take a free block, NULL when the pool is exhausted
+FrameBuf* FramePool_Alloc(FramePool *pool);
+
+// Reference counting, the last release returns the block
+void FrameBuf_Retain(FrameBuf *buf);
+void FrameBuf_Release(FrameBuf *buf);
+
+void FramePool_GetStats(FramePool *pool, FramePoolStats *stats);
+void FramePool_Print_Stats(FramePool *pool);
+
+#endif
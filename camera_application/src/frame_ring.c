@@ -0,0 +1,100 @@
+#include "frame_ring.h"
+
+void FrameRing_Init(FrameRing *ring)
+{
+    for(u32 i = 0; i < FRAME_RING_SLOTS; i++) ring->slots[i] = NULL;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->published = 0;
+    ring->dropped = 0;
+    ring->consumed = 0;
+    ring->skipped = 0;
+}
+
+int FrameRing_Publish(FrameRing *ring, FrameBuf *buf)
+{
+    u32 head = ring->head;
+    u32 tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+    // Capture never waits: the oldest unread frame goes back to the pool, unless the consumer takes
+    // it first, either way there is a free slot afterwards
+    if(head - tail >= FRAME_RING_SLOTS)
+    {
+        FrameBuf *oldest = ring->slots[tail & FRAME_RING_MASK];
+
+        if(__atomic_compare_exchange_n(&ring->tail, &tail, tail + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            ring->dropped++;
+            FrameBuf_Release(oldest);
+        }
+    }
+
+    ring->slots[head & FRAME_RING_MASK] = buf;
+    ring->published++;
+
+    // Slot and frame contents visible before the new head
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return XST_SUCCESS;
+}
+
+FrameBuf* FrameRing_Consume(FrameRing *ring)
+{
+    u32 tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    FrameBuf *buf;
+
+    // The slot is ours only if the producer did not reclaim it in the meantime
+    do
+    {
+        if(tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) return NULL;
+        buf = ring->slots[tail & FRAME_RING_MASK];
+    } while(!__atomic_compare_exchange_n(&ring->tail, &tail, tail + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    ring->consumed++;
+    return buf;
+}
+
+FrameBuf* FrameRing_ConsumeLatest(FrameRing *ring)
+{
+    FrameBuf *taken[FRAME_RING_SLOTS];
+    u32 tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    u32 head, count;
+
+    // Every slot up to the head is read before the tail moves, the producer may reuse them after
+    do
+    {
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if(tail == head) return NULL;
+        count = head - tail;
+        for(u32 i = 0; i < count; i++) taken[i] = ring->slots[(tail + i) & FRAME_RING_MASK];
+    } while(!__atomic_compare_exchange_n(&ring->tail, &tail, head, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    for(u32 i = 0; i + 1 < count; i++)
+    {
+        FrameBuf_Release(taken[i]);
+        ring->skipped++;
+    }
+    ring->consumed++;
+    return taken[count - 1];
+}
+
+u32 FrameRing_Count(FrameRing *ring)
+{
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+}
+
+void FrameRing_GetStats(FrameRing *ring, FrameRingStats *stats)
+{
+    stats->published = ring->published;
+    stats->dropped = ring->dropped;
+    stats->consumed = ring->consumed;
+    stats->skipped = ring->skipped;
+}
+
+void FrameRing_Print_Stats(FrameRing *ring)
+{
+    FrameRingStats st;
+
+    FrameRing_GetStats(ring, &st);
+    xil_printf("[INFO] Frame ring: published %u, dropped %u, consumed %u, skipped %u, waiting %u\n",
+               st.published, st.dropped, st.consumed, st.skipped, FrameRing_Count(ring));
+}
@@ -0,0 +1,56 @@
+#ifndef __FRAME_RING_H__
+#define __FRAME_RING_H__
+
+#include "frame_pool.h"
+
+/*
+    Single producer / single consumer ring of frames, capture-done interrupt in, processing loop out.
+    Neither side masks interrupts or waits on the other: a full ring hands its oldest unread frame
+    back to the pool to make room for the new one, a slow consumer can skip to the newest one. The
+    ring stays shallower than the pool so capture always has blocks left to fill. Producer and
+    consumer may run on different cores, the acquire / release accesses below are what orders the
+    slot writes ( dmb ish on the A9 ). Both sides move the tail, by compare and swap.
+*/
+
+#define FRAME_RING_SLOTS 4U // Power of 2, fewer than the pool's blocks
+#define FRAME_RING_MASK  (FRAME_RING_SLOTS - 1U)
+
+typedef struct {
+    u32 published;      // Frames put in the ring
+    u32 dropped;        // Oldest unread frames released by the producer because the ring was full
+    u32 consumed;       // Frames handed to the consumer
+    u32 skipped;        // Frames released by FrameRing_ConsumeLatest in favour of a newer one
+} FrameRingStats;
+
+typedef struct {
+    FrameBuf *slots[FRAME_RING_SLOTS];
+
+    // Producer side, own cache line so the two cores do not bounce it
+    volatile u32 head __attribute__((aligned(FRAME_ALIGN)));
+    u32 published;
+    u32 dropped;
+
+    // Consumer side
+    volatile u32 tail __attribute__((aligned(FRAME_ALIGN)));
+    u32 consumed;
+    u32 skipped;
+} FrameRing;
+
+void FrameRing_Init(FrameRing *ring);
+
+// Producer, takes over the caller's reference. Never fails, a full ring loses its oldest frame.
+int FrameRing_Publish(FrameRing *ring, FrameBuf *buf);
+
+// Consumer, oldest frame first, NULL when empty. The caller releases the frame when done.
+FrameBuf* FrameRing_Consume(FrameRing *ring);
+
+// Consumer, newest frame only, older ones are released. For live view.
+FrameBuf* FrameRing_ConsumeLatest(FrameRing *ring);
+
+// Frames waiting, a snapshot from either side
+u32 FrameRing_Count(FrameRing *ring);
+
+void FrameRing_GetStats(FrameRing *ring, FrameRingStats *stats);
+void FrameRing_Print_Stats(FrameRing *ring);
+
+#endif
@@ -2,38 +2,202 @@
 #include <xiic.h>
 #include <xiic_l.h>
 #include <xil_exception.h>
+#include <xiltimer.h>
 #include <xil_printf.h>
 #include <xscugic.h>
 #include <xstatus.h>
+#include <string.h>
 
 #define UNUSED(x) (void)(x)
 
+// Progress of the active transaction
+#define TXN_PHASE_TX 0 // Write phase on the bus
+#define TXN_PHASE_RX 1 // Read phase on the bus
+
+static void Iic_Txn_Start(IicCtrl *inst);
+
+// Fold the 8 bit XIic driver counters into ours before they wrap, IIC interrupt must be masked
+static void Iic_Stats_MergeDriver(IicCtrl *inst)
+{
+    XIicStats drv;
+
+    XIic_GetStats(&inst->iic_instance, &drv);
+    XIic_ClearStats(&inst->iic_instance);
+
+    inst->stats.drv_interrupts      += drv.IicInterrupts;
+    inst->stats.drv_send_interrupts += drv.SendInterrupts;
+    inst->stats.drv_recv_interrupts += drv.RecvInterrupts;
+    inst->stats.drv_repeated_starts += drv.RepeatedStarts;
+    inst->stats.drv_bus_busy        += drv.BusBusy;
+    inst->stats.drv_tx_errors       += drv.TxErrors;
+    inst->stats.drv_arb_lost        += drv.ArbitrationLost;
+}
+
+// Global timer ticks to ns. COUNTS_PER_SECOND is an unparenthesised expression in the BSP.
+static u32 Iic_Ticks_To_Ns(u64 ticks)
+{
+    return (u32)(ticks * 1000000000ULL / (COUNTS_PER_SECOND));
+}
+
+// Account one finished transaction
+static void Iic_Stats_Record(IicCtrl *inst, XTime t_submit, XTime t_start, int tx_bytes, int rx_bytes, int status)
+{
+    IicStats *st = &inst->stats;
+    XTime t_end;
+    u32 total, bucket = 0;
+
+    XTime_GetTime(&t_end);
+    total = (u32)(t_end - t_submit);
+
+    st->transactions++;
+    if(status != XST_SUCCESS) st->errors++;
+    else
+    {
+        st->tx_bytes += tx_bytes;
+        st->rx_bytes += rx_bytes;
+    }
+
+    st->queue_ticks += t_start - t_submit;
+    st->bus_ticks += t_end - t_start;
+    if(total > st->max_ticks) st->max_ticks = total;
+
+    if(total != 0) bucket = 31 - __builtin_clz(total);
+    if(bucket >= IIC_LATENCY_BUCKETS) bucket = IIC_LATENCY_BUCKETS - 1;
+    st->latency_hist[bucket]++;
+
+    Iic_Stats_MergeDriver(inst);
+}
+
+// Start the next queued transaction, devices take turns so none can starve the others.
+// IIC interrupt must be masked.
+static void Iic_Queue_Next(IicCtrl *inst)
+{
+    IicDevice *dev = NULL;
+
+    if(inst->active != NULL || inst->pending == 0) return;
+
+    for(int i = 0; i < inst->num_devices; i++)
+    {
+        int idx = (inst->next_device + i) % inst->num_devices;
+        if(inst->devices[idx]->queue_head != inst->devices[idx]->queue_tail)
+        {
+            dev = inst->devices[idx];
+            inst->next_device = (idx + 1) % inst->num_devices;
+            break;
+        }
+    }
+    if(dev == NULL) return;
+
+    IicTxn *txn = dev->queue[dev->queue_head % IIC_QUEUE_DEPTH];
+    dev->queue_head++;
+    inst->pending--;
+    inst->active = txn;
+
+    // Only a field in the driver instance, cheap enough to load on every transaction
+    XIic_SetAddress(&inst->iic_instance, XII_ADDR_TO_SEND_TYPE, dev->addr);
+
+    txn->phase = (txn->type == IIC_TXN_READ) ? TXN_PHASE_RX : TXN_PHASE_TX;
+    txn->wait_bus = FALSE;
+    XTime_GetTime(&txn->t_start);
+
+    // Controller stays enabled while there is traffic
+    if(inst->iic_instance.IsStarted != XIL_COMPONENT_IS_STARTED)
+    {
+        XIic_Start(&inst->iic_instance);
+    }
+
+    Iic_Txn_Start(inst);
+}
+
+static void Iic_Txn_Complete(IicCtrl *inst, int status)
+{
+    IicTxn *txn = inst->active;
+    inst->active = NULL;
+
+    Iic_Stats_Record(inst, txn->t_submit, txn->t_start, txn->tx_count, txn->rx_count, status);
+
+    txn->status = status;
+    if(txn->callback != NULL) txn->callback(txn, txn->callback_ref);
+
+    Iic_Queue_Next(inst);
+}
+
+// Put the current phase of the active transaction on the bus
+static void Iic_Txn_Start(IicCtrl *inst)
+{
+    IicTxn *txn = inst->active;
+    int status;
+
+    if(txn->phase == TXN_PHASE_RX)
+    {
+        status = XIic_MasterRecv(&inst->iic_instance, txn->rx_buf, txn->rx_count);
+    }
+    else
+    {
+        status = XIic_MasterSend(&inst->iic_instance, txn->tx_buf, txn->tx_count);
+    }
+
+    // The driver raises a bus-not-busy event once it can go, StatHandler restarts us then
+    if(status == XST_IIC_BUS_BUSY)
+    {
+        txn->wait_bus = TRUE;
+        inst->stats.bus_busy_waits++;
+        return;
+    }
+
+    if(status != XST_SUCCESS) Iic_Txn_Complete(inst, status);
+}
+
 // Define the interrupt handlers
 static void SendHandler( void *callback_ref, int byte_count)
 {
-    UNUSED(byte_count);
-
     IicCtrl *inst = (IicCtrl *)callback_ref;
-    inst->iic_transmit_complete = 0; // Update the transmit flag
+    IicTxn *txn = inst->active;
+
+    if(txn == NULL || txn->phase != TXN_PHASE_TX || byte_count != 0) return;
+
+    // Register address is out, turn the bus around for the data
+    if(txn->type == IIC_TXN_WRITE_READ)
+    {
+        txn->phase = TXN_PHASE_RX;
+        Iic_Txn_Start(inst);
+        return;
+    }
+
+    Iic_Txn_Complete(inst, XST_SUCCESS);
 }
 
 static void RecvHandler( void *callback_ref, int byte_count)
 {
-    UNUSED(byte_count);
-
     IicCtrl *inst = (IicCtrl *)callback_ref;
-    inst->iic_recieve_complete = 0; // Update the recv flag
+    IicTxn *txn = inst->active;
+
+    if(txn == NULL || txn->phase != TXN_PHASE_RX || byte_count != 0) return;
+
+    Iic_Txn_Complete(inst, XST_SUCCESS);
 }
 
 static void StatHandler( void *callback_ref, int event)
 {
     IicCtrl *inst = (IicCtrl *)callback_ref;
-    inst->iic_recieve_complete = 0;
-    inst->iic_transmit_complete = 0;
-    xil_printf("[DEBUG] IIC Event/Error: %d\n", event);    
+    IicTxn *txn = inst->active;
+
+    if(txn == NULL) return;
+
+    if(event & XII_SLAVE_NO_ACK_EVENT) inst->stats.nacks++;
+    if(event & XII_ARB_LOST_EVENT) inst->stats.arb_lost++;
+
+    // Counted above, nothing is printed from interrupt context
+    if(event & (XII_SLAVE_NO_ACK_EVENT | XII_ARB_LOST_EVENT)) Iic_Txn_Complete(inst, XST_FAILURE);
+    else if((event & XII_BUS_NOT_BUSY_EVENT) && txn->wait_bus)
+    {
+        txn->wait_bus = FALSE;
+        inst->stats.retries++;
+        Iic_Txn_Start(inst);
+    }
 }
 
-int Iic_Helper_Init(IicCtrl *instance_ptr, UINTPTR iic_base_addr, XScuGic *intc_ptr, int interrupt_id, u8 iic_device_addr)
+int Iic_Helper_Init(IicCtrl *instance_ptr, UINTPTR iic_base_addr, XScuGic *intc_ptr, int interrupt_id)
 {
     int status;
 
@@ -44,8 +208,14 @@ int Iic_Helper_Init(IicCtrl *instance_ptr, UINTPTR iic_base_addr, XScuGic *intc_
     instance_ptr->intc_ptr = intc_ptr;
     instance_ptr->interrupt_id = interrupt_id;
 
-    // Save the IIC device address if needed
-    instance_ptr->iic_device_addr = iic_device_addr;
+    instance_ptr->iic_base_addr = iic_base_addr;
+
+    // No devices yet, nothing queued
+    instance_ptr->num_devices = 0;
+    instance_ptr->next_device = 0;
+    instance_ptr->pending = 0;
+    instance_ptr->active = NULL;
+    memset(&instance_ptr->stats, 0, sizeof(instance_ptr->stats));
 
     // Configure and initialize the XIic instance
     iic_cfg_ptr = XIic_LookupConfig(iic_base_addr);
@@ -92,106 +262,408 @@ int Iic_Helper_Init(IicCtrl *instance_ptr, UINTPTR iic_base_addr, XScuGic *intc_
     XIic_SetRecvHandler(&instance_ptr->iic_instance, instance_ptr, (XIic_Handler)RecvHandler);
     XIic_SetStatusHandler(&instance_ptr->iic_instance, instance_ptr, (XIic_Handler)StatHandler);
 
-    // Set the IIC Address for the device
-    status = XIic_SetAddress(&instance_ptr->iic_instance, XII_ADDR_TO_SEND_TYPE, instance_ptr->iic_device_addr);
-    if(status != XST_SUCCESS)
-    {
-        xil_printf("[ERROR] Failed to set IIC Device address to: %d, status: %d\n", instance_ptr->iic_device_addr, status);
-        return XST_FAILURE;
-    }
+    // Deliver bus-not-busy and arbitration-lost events, the queue restarts deferred transactions on them
+    XIic_MultiMasterInclude();
 
     xil_printf("[INFO] Successfully initialised IIC Helper & Interrupt system!\n");
     
     return XST_SUCCESS;
 }
 
-// IIC Write Function
-int Iic_Write(IicCtrl *instance_ptr, u8 *data, int byte_count)
+int Iic_Device_Init(IicDevice *dev, IicCtrl *instance_ptr, u8 iic_device_addr)
+{
+    int status = XST_SUCCESS;
+
+    if(iic_device_addr > 0x7F)
+    {
+        xil_printf("[ERROR] Invalid 7 bit IIC device address: 0x%02X\n", iic_device_addr);
+        return XST_INVALID_PARAM;
+    }
+
+    dev->bus = instance_ptr;
+    dev->addr = iic_device_addr;
+    dev->queue_head = 0;
+    dev->queue_tail = 0;
+
+    XScuGic_Disable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+
+    if(instance_ptr->num_devices >= IIC_MAX_DEVICES)
+    {
+        xil_printf("[ERROR] No free IIC device slot for address: 0x%02X\n", iic_device_addr);
+        status = XST_FAILURE;
+    }
+    else
+    {
+        instance_ptr->devices[instance_ptr->num_devices++] = dev;
+    }
+
+    XScuGic_Enable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+
+    return status;
+}
+
+// Add a prepared transaction to the device queue, kick the bus if it is idle
+static int Iic_Queue_Submit(IicDevice *dev, IicTxn *txn)
+{
+    IicCtrl *instance_ptr = dev->bus;
+    int status = XST_SUCCESS;
+
+    XScuGic_Disable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+
+    if(dev->queue_tail - dev->queue_head >= IIC_QUEUE_DEPTH)
+    {
+        status = XST_DEVICE_BUSY;
+        instance_ptr->stats.queue_full++;
+    }
+    else
+    {
+        txn->dev = dev;
+        txn->status = XST_DEVICE_BUSY;
+        XTime_GetTime(&txn->t_submit);
+        dev->queue[dev->queue_tail % IIC_QUEUE_DEPTH] = txn;
+        dev->queue_tail++;
+        instance_ptr->pending++;
+        Iic_Queue_Next(instance_ptr);
+    }
+
+    XScuGic_Enable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+
+    return status;
+}
+
+int Iic_Queue_Write(IicDevice *dev, IicTxn *txn, const u8 *data, int byte_count, IicTxnCallback callback, void *callback_ref)
+{
+    if(byte_count <= 0 || byte_count > IIC_TXN_MAX_TX) return XST_INVALID_PARAM;
+
+    txn->type = IIC_TXN_WRITE;
+    for(int i = 0; i < byte_count; i++) txn->tx_buf[i] = data[i];
+    txn->tx_count = byte_count;
+    txn->rx_buf = NULL;
+    txn->rx_count = 0;
+    txn->callback = callback;
+    txn->callback_ref = callback_ref;
+
+    return Iic_Queue_Submit(dev, txn);
+}
+
+int Iic_Queue_Read(IicDevice *dev, IicTxn *txn, u8 *buf, int byte_count, IicTxnCallback callback, void *callback_ref)
+{
+    if(byte_count <= 0) return XST_INVALID_PARAM;
+
+    txn->type = IIC_TXN_READ;
+    txn->tx_count = 0;
+    txn->rx_buf = buf;
+    txn->rx_count = byte_count;
+    txn->callback = callback;
+    txn->callback_ref = callback_ref;
+
+    return Iic_Queue_Submit(dev, txn);
+}
+
+int Iic_Queue_WriteRead(IicDevice *dev, IicTxn *txn, u8 reg_addr, u8 *buf, int byte_count, IicTxnCallback callback, void *callback_ref)
+{
+    if(byte_count <= 0) return XST_INVALID_PARAM;
+
+    txn->type = IIC_TXN_WRITE_READ;
+    txn->tx_buf[0] = reg_addr;
+    txn->tx_count = 1;
+    txn->rx_buf = buf;
+    txn->rx_count = byte_count;
+    txn->callback = callback;
+    txn->callback_ref = callback_ref;
+
+    return Iic_Queue_Submit(dev, txn);
+}
+
+void Iic_Queue_Poll(IicCtrl *instance_ptr)
+{
+    XScuGic_Disable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+
+    // Backstop for a missed bus-not-busy event
+    IicTxn *txn = instance_ptr->active;
+    if(txn != NULL && txn->wait_bus && (XIic_IsIicBusy(&instance_ptr->iic_instance) == FALSE))
+    {
+        txn->wait_bus = FALSE;
+        instance_ptr->stats.retries++;
+        Iic_Txn_Start(instance_ptr);
+    }
+    Iic_Queue_Next(instance_ptr);
+
+    XScuGic_Enable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+}
+
+u32 Iic_Queue_Room(IicDevice *dev)
+{
+    // The interrupt side only ever frees slots
+    return IIC_QUEUE_DEPTH - (dev->queue_tail - dev->queue_head);
+}
+
+int Iic_Queue_Idle(IicCtrl *instance_ptr)
+{
+    return (instance_ptr->active == NULL) && (instance_ptr->pending == 0);
+}
+
+int Iic_Txn_Poll(IicTxn *txn)
+{
+    return txn->status;
+}
+
+int Iic_Txn_Wait(IicCtrl *instance_ptr, IicTxn *txn)
+{
+    while(txn->status == XST_DEVICE_BUSY)
+    {
+        Iic_Queue_Poll(instance_ptr);
+    }
+    return txn->status;
+}
+
+int Iic_Recover(IicCtrl *instance_ptr)
 {
     int status;
 
-    // Reset the stats and the transmit flag
-    instance_ptr->iic_transmit_complete = 1;
+    XScuGic_Disable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+
+    if(instance_ptr->active != NULL)
+    {
+        IicTxn *txn = instance_ptr->active;
+        instance_ptr->active = NULL;
+        Iic_Stats_Record(instance_ptr, txn->t_submit, txn->t_start, txn->tx_count, txn->rx_count, XST_FAILURE);
+        txn->status = XST_FAILURE;
+        if(txn->callback != NULL) txn->callback(txn, txn->callback_ref);
+    }
+
+    // Clear the controller state, the next transaction starts it again with its own slave address
+    XIic_Reset(&instance_ptr->iic_instance);
+    status = XIic_Stop(&instance_ptr->iic_instance);
+
+    Iic_Queue_Next(instance_ptr);
+
+    XScuGic_Enable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
 
-    // Start the IIC instance
-    status = XIic_Start(&instance_ptr->iic_instance);
+    return status;
+}
+
+// IIC Write Function
+int Iic_Write(IicDevice *dev, u8 *data, int byte_count)
+{
+    IicTxn txn;
+
+    int status;
+
+    // Blocking callers wait for a free queue slot
+    while((status = Iic_Queue_Write(dev, &txn, data, byte_count, NULL, NULL)) == XST_DEVICE_BUSY)
+    {
+        Iic_Queue_Poll(dev->bus);
+    }
     if(status != XST_SUCCESS)
     {
-        xil_printf("[ERROR] Failed to start IIC instance, Iic_WriteData, status: %d\n", status);
+        xil_printf("[ERROR] Failed to queue IIC write, Iic_Write, status: %d\n", status);
         return status;
     }
 
-    // IIC Address already setup at initialisation
+    return Iic_Txn_Wait(dev->bus, &txn);
+}
 
-    // Write the # of bytes to the IIC Device
-    status = XIic_MasterSend(&instance_ptr->iic_instance, data, byte_count);
+// IIC Read Function
+int Iic_Read(IicDevice *dev, u8 reg_addr, u8 *buf, int byte_count)
+{
+    IicTxn txn;
+
+    int status;
+
+    // Register address write and data read run back to back as one queued transaction
+    while((status = Iic_Queue_WriteRead(dev, &txn, reg_addr, buf, byte_count, NULL, NULL)) == XST_DEVICE_BUSY)
+    {
+        Iic_Queue_Poll(dev->bus);
+    }
     if(status != XST_SUCCESS)
     {
-        xil_printf("[ERROR] Failed to start IIC tx, XIic_MasterSend, status: %d\n", status);
+        xil_printf("[ERROR] Failed to queue IIC read, Iic_Read, status: %d\n", status);
         return status;
     }
 
-    // Wait for the transmit to complete
-    while( instance_ptr->iic_transmit_complete || (XIic_IsIicBusy(&instance_ptr->iic_instance) == TRUE) );
+    return Iic_Txn_Wait(dev->bus, &txn);
+}
 
-    // Stop the IIC Device
-    status = XIic_Stop(&instance_ptr->iic_instance);
+// Take the controller away from the interrupt driven driver for polled dynamic transfers
+static int Iic_Dyn_Begin(IicCtrl *instance_ptr)
+{
+    // Queued traffic finishes first, then the IIC interrupt stays masked for the session
+    while(1)
+    {
+        XScuGic_Disable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+        if(Iic_Queue_Idle(instance_ptr)) break;
+        XScuGic_Enable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+        Iic_Queue_Poll(instance_ptr);
+    }
+
+    XIic_IntrGlobalDisable(instance_ptr->iic_base_addr);
+
+    int status = XIic_DynInit(instance_ptr->iic_base_addr);
     if(status != XST_SUCCESS)
     {
-        xil_printf("[ERROR] Failed to stop the IIC instance, at XIic_Stop, status: %d\n", status);
-        return status;
+        xil_printf("[ERROR] Failed to init dynamic IIC logic, XIic_DynInit, status: %d\n", status);
+
+        // Controller stays started for the queue, its interrupts have to come back with it
+        XIic_IntrGlobalEnable(instance_ptr->iic_base_addr);
+        XScuGic_Enable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
     }
+    return status;
+}
 
-    return XST_SUCCESS;
+// Hand the controller back, the next queued transaction restarts it with XIic_Start
+static void Iic_Dyn_End(IicCtrl *instance_ptr)
+{
+    XIic_Stop(&instance_ptr->iic_instance);
+    XScuGic_Enable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+}
 
+// Address write, repeated start, data read, stop
+static int Iic_Dyn_ReadReg(IicDevice *dev, u8 reg_addr, u8 *buf, int byte_count)
+{
+    IicCtrl *instance_ptr = dev->bus;
+    UINTPTR base = instance_ptr->iic_base_addr;
+    u8 reg = reg_addr;
+    int status = XST_SUCCESS;
+    XTime t_start;
+
+    XTime_GetTime(&t_start);
+
+    if(XIic_DynSend(base, dev->addr, &reg, 1, XIIC_REPEATED_START) != 1) status = XST_FAILURE;
+    else if(XIic_DynRecv(base, dev->addr, buf, (u8)byte_count) != (unsigned)byte_count) status = XST_FAILURE;
+
+    // Polled, so no queueing time
+    Iic_Stats_Record(instance_ptr, t_start, t_start, 1, byte_count, status);
+    return status;
 }
 
-// IIC Read Function
-int Iic_Read(IicCtrl *instance_ptr, u8 reg_addr, u8 *buf, int byte_count)
+int Iic_Read_Combined(IicDevice *dev, u8 reg_addr, u8 *buf, int byte_count)
 {
     int status;
 
-    // Reset the stats and recieve flag
-    instance_ptr->iic_recieve_complete = 1;
+    if(byte_count <= 0 || byte_count > 255) return XST_INVALID_PARAM;
 
-    // Write the Register Address
-    u8 reg = reg_addr;
-    status = Iic_Write(instance_ptr, &reg, 1);
+    status = Iic_Dyn_Begin(dev->bus);
+    if(status != XST_SUCCESS) return status;
+
+    status = Iic_Dyn_ReadReg(dev, reg_addr, buf, byte_count);
     if(status != XST_SUCCESS)
     {
-        xil_printf("[ERROR] Failed to write the address, Iic_ReadData, status: %d\n", status);
-        return status;
+        xil_printf("[ERROR] Combined read failed for Reg: 0x%02X\n", reg_addr);
     }
 
-    // Start the IIC instance
-    status = XIic_Start(&instance_ptr->iic_instance);
-    if(status != XST_SUCCESS)
+    Iic_Dyn_End(dev->bus);
+    return status;
+}
+
+int Iic_Read_Combined_Multi(IicDevice *dev, const u8 *regs, u8 *buf, int count)
+{
+    int status;
+
+    // One dynamic session for the whole list
+    status = Iic_Dyn_Begin(dev->bus);
+    if(status != XST_SUCCESS) return status;
+
+    for(int i = 0; i < count; i++)
     {
-        xil_printf("[ERROR] Failed to start IIC instance, Iic_ReadData, status: %d\n", status);
-        return status;
+        status = Iic_Dyn_ReadReg(dev, regs[i], &buf[i], 1);
+        if(status != XST_SUCCESS)
+        {
+            xil_printf("[ERROR] Combined read failed for Reg: 0x%02X\n", regs[i]);
+            break;
+        }
     }
 
-    // Start Recieving
-    status = XIic_MasterRecv(&instance_ptr->iic_instance, buf, byte_count);
-    if(status != XST_SUCCESS)
+    Iic_Dyn_End(dev->bus);
+    return status;
+}
+
+void Iic_Read_Benchmark(IicDevice *dev, u8 reg_addr, int iterations)
+{
+    XTime t_start, t_end;
+    u64 split_ticks, combined_ticks, multi_ticks;
+    u8 value;
+    u8 regs[8];
+    u8 values[8];
+    int errors = 0;
+
+    if(iterations <= 0) return;
+
+    // Separate address write and data read, each with its own STOP
+    XTime_GetTime(&t_start);
+    for(int i = 0; i < iterations; i++)
     {
-        xil_printf("[ERROR] Failed to start IIC Rx, XIic_MasterRecv, status: %d\n", status);
-        return status;
+        if(Iic_Read(dev, reg_addr, &value, 1) != XST_SUCCESS) errors++;
     }
+    XTime_GetTime(&t_end);
+    split_ticks = t_end - t_start;
 
-    // Wait for the interrupt to come in.
-    while( instance_ptr->iic_recieve_complete || (XIic_IsIicBusy(&instance_ptr->iic_instance) == TRUE));
+    // Repeated start, one transaction per read
+    XTime_GetTime(&t_start);
+    for(int i = 0; i < iterations; i++)
+    {
+        if(Iic_Read_Combined(dev, reg_addr, &value, 1) != XST_SUCCESS) errors++;
+    }
+    XTime_GetTime(&t_end);
+    combined_ticks = t_end - t_start;
 
-    // Stop the IIC Device
-    status = XIic_Stop(&instance_ptr->iic_instance);
-    if(status != XST_SUCCESS)
+    // Repeated start, eight reads per dynamic session
+    for(int i = 0; i < 8; i++) regs[i] = reg_addr;
+    XTime_GetTime(&t_start);
+    for(int i = 0; i < iterations; i += 8)
     {
-        xil_printf("[ERROR] Failed to stop the IIC instance, at XIic_Stop, status: %d\n", status);
-        return status;
+        if(Iic_Read_Combined_Multi(dev, regs, values, 8) != XST_SUCCESS) errors++;
     }
+    XTime_GetTime(&t_end);
+    multi_ticks = t_end - t_start;
+
+    int multi_reads = ((iterations + 7) / 8) * 8;
+    xil_printf("[INFO] IIC read benchmark, device 0x%02X, Reg 0x%02X, %d reads, %d errors\n", dev->addr, reg_addr, iterations, errors);
+    xil_printf("[INFO]   Iic_Read                : %u ns/read\n", Iic_Ticks_To_Ns(split_ticks / iterations));
+    xil_printf("[INFO]   Iic_Read_Combined       : %u ns/read\n", Iic_Ticks_To_Ns(combined_ticks / iterations));
+    xil_printf("[INFO]   Iic_Read_Combined_Multi : %u ns/read\n", Iic_Ticks_To_Ns(multi_ticks / multi_reads));
+}
 
-    return XST_SUCCESS;
+void Iic_Stats_Snapshot(IicCtrl *instance_ptr, IicStats *stats)
+{
+    XScuGic_Disable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+    Iic_Stats_MergeDriver(instance_ptr);
+    *stats = instance_ptr->stats;
+    XScuGic_Enable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+}
 
+void Iic_Stats_Reset(IicCtrl *instance_ptr)
+{
+    XScuGic_Disable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+    XIic_ClearStats(&instance_ptr->iic_instance);
+    memset(&instance_ptr->stats, 0, sizeof(instance_ptr->stats));
+    XScuGic_Enable(instance_ptr->intc_ptr, instance_ptr->interrupt_id);
+}
+
+void Iic_Stats_Print(IicCtrl *instance_ptr)
+{
+    IicStats st;
+    u32 done;
+
+    Iic_Stats_Snapshot(instance_ptr, &st);
+    done = st.transactions ? st.transactions : 1;
+
+    xil_printf("[INFO] IIC stats, controller 0x%08X, %d devices\n", instance_ptr->iic_base_addr, instance_ptr->num_devices);
+    xil_printf("[INFO]   Transactions: %u, errors: %u, tx bytes: %u, rx bytes: %u\n", st.transactions, st.errors, st.tx_bytes, st.rx_bytes);
+    xil_printf("[INFO]   NACKs: %u, arbitration lost: %u, bus busy waits: %u, retries: %u, queue full: %u\n",
+               st.nacks, st.arb_lost, st.bus_busy_waits, st.retries, st.queue_full);
+    xil_printf("[INFO]   Avg queue wait: %u ns, avg bus time: %u ns, max: %u ns\n",
+               Iic_Ticks_To_Ns(st.queue_ticks / done),
+               Iic_Ticks_To_Ns(st.bus_ticks / done),
+               Iic_Ticks_To_Ns(st.max_ticks));
+    xil_printf("[INFO]   Driver: interrupts %u, tx intr %u, rx intr %u, repeated starts %u, bus busy %u, tx errors %u\n",
+               st.drv_interrupts, st.drv_send_interrupts, st.drv_recv_interrupts, st.drv_repeated_starts, st.drv_bus_busy, st.drv_tx_errors);
+
+    for(int i = 0; i < IIC_LATENCY_BUCKETS; i++)
+    {
+        if(st.latency_hist[i] == 0) continue;
+        xil_printf("[INFO]   Latency >= %u ns: %u\n", Iic_Ticks_To_Ns((u64)1 << i), st.latency_hist[i]);
+    }
 }
 
 u32 Iic_Read_Internal_Reg(IicCtrl *instance_ptr, u8 reg_offset)
@@ -6,30 +6,155 @@
 #include "xstatus.h"
 #include "xil_printf.h"
 #include <xil_types.h>
+#include "xiltimer.h"
 
-// Structure to hold all IIC Peripheral related information
+#define IIC_QUEUE_DEPTH 16  // Outstanding transactions per device
+#define IIC_MAX_DEVICES 8   // Device handles sharing one controller
+#define IIC_TXN_MAX_TX  8   // Bytes copied into a transaction for its write phase
+
+#define IIC_LATENCY_BUCKETS 24 // log2 histogram buckets of global timer ticks
+
+// Kinds of queued transactions
+typedef enum {
+    IIC_TXN_WRITE,      // Send tx_buf
+    IIC_TXN_READ,       // Receive rx_count bytes
+    IIC_TXN_WRITE_READ, // Send tx_buf ( register address ), then receive rx_count bytes
+} IicTxnType;
+
+typedef struct IicTxn IicTxn;
+typedef struct IicCtrl IicCtrl;
+typedef struct IicDevice IicDevice;
+
+// Completion callback, runs in interrupt context so keep it short
+typedef void (*IicTxnCallback)(IicTxn *txn, void *callback_ref);
+
+// A queued IIC transaction, owned by the caller until its status leaves XST_DEVICE_BUSY
+struct IicTxn {
+    IicTxnType type;
+    IicDevice *dev;               // Target, its slave address is loaded when the transaction starts
+    u8  tx_buf[IIC_TXN_MAX_TX];   // Copy of the bytes to write
+    int tx_count;
+    u8 *rx_buf;                   // Caller buffer for the read phase
+    int rx_count;
+    IicTxnCallback callback;      // Optional, NULL to only poll
+    void *callback_ref;
+    volatile int status;          // XST_DEVICE_BUSY until the transaction is done
+    volatile u8 phase;            // Engine state, internal to iic_helper.c
+    volatile u8 wait_bus;         // Engine state, start deferred until the bus is free
+    XTime t_submit;               // Global timer when queued
+    XTime t_start;                // Global timer when first put on the bus
+};
+
+// Bus counters and latency histogram, read with Iic_Stats_Snapshot
 typedef struct {
+    u32 transactions;        // Completed transactions, including the polled dynamic reads
+    u32 errors;              // Completed with a failure status
+    u32 tx_bytes;            // Payload bytes written
+    u32 rx_bytes;            // Payload bytes read
+    u32 nacks;               // Slave did not acknowledge
+    u32 arb_lost;            // Arbitration lost to another master
+    u32 bus_busy_waits;      // Starts deferred because the bus was busy
+    u32 retries;             // Deferred starts that were restarted
+    u32 queue_full;          // Submissions rejected because the queue was full
+    u64 queue_ticks;         // Sum of submit -> bus start time, software path and queueing
+    u64 bus_ticks;           // Sum of bus start -> completion time
+    u32 max_ticks;           // Worst submit -> completion time
+    u32 latency_hist[IIC_LATENCY_BUCKETS]; // Bucket n: submit -> completion in [2^n, 2^(n+1)) ticks
+
+    // XIic driver counters ( xiic_stats.c ) folded in, the driver only keeps 8 bits of each
+    u32 drv_interrupts;
+    u32 drv_send_interrupts;
+    u32 drv_recv_interrupts;
+    u32 drv_repeated_starts;
+    u32 drv_bus_busy;
+    u32 drv_tx_errors;
+    u32 drv_arb_lost;
+} IicStats;
+
+// One slave on the bus, with its own transaction queue
+struct IicDevice {
+    IicCtrl *bus;                        // Controller this device hangs off
+    u8 addr;                             // 7 bit slave address
+
+    // Filled by the Iic_Queue_* calls, drained round robin with the other devices by the interrupt handlers
+    IicTxn *queue[IIC_QUEUE_DEPTH];
+    volatile u32 queue_head;             // Next transaction to start ( interrupt side )
+    volatile u32 queue_tail;             // Next free slot ( submit side )
+};
+
+// Structure to hold all IIC Peripheral related information, one per AXI IIC controller
+struct IicCtrl {
 
     XIic iic_instance;                   // Actual IIC Driver Instance
     XScuGic *intc_ptr;                   // Pointer to the system interrupt controller
     UINTPTR iic_base_addr;               // Base Address to initialise the IIC instance
     int interrupt_id;                    // 61U for our case
-    volatile u8 iic_transmit_complete;  // Transmit complete flag for IIC ( updated by interrupt )
-    volatile u8 iic_recieve_complete;   // Recieve complete flag for IIC ( updated by interrupt )
-    u8 iic_device_addr;
-} IicCtrl;
 
-// Initialise the IIC Helper driver
-int Iic_Helper_Init(IicCtrl *instance_ptr, UINTPTR iic_base_addr, XScuGic *intc_ptr, int interrupt_id, u8 iic_device_addr);
+    IicDevice *devices[IIC_MAX_DEVICES]; // Registered with Iic_Device_Init
+    int num_devices;
+    int next_device;                     // Round robin position for the next transaction
+    volatile u32 pending;                // Queued transactions over all devices, excluding the active one
+    IicTxn * volatile active;            // Transaction currently on the bus
+
+    IicStats stats;                      // Updated from the interrupt handlers
+};
+
+// Initialise the IIC Helper driver, devices are added afterwards with Iic_Device_Init
+int Iic_Helper_Init(IicCtrl *instance_ptr, UINTPTR iic_base_addr, XScuGic *intc_ptr, int interrupt_id);
+
+// Attach a slave to the controller, no bus traffic, the address is switched per transaction
+int Iic_Device_Init(IicDevice *dev, IicCtrl *instance_ptr, u8 iic_device_addr);
+
+// Non-blocking transactions, return XST_DEVICE_BUSY when the device queue is full
+int Iic_Queue_Write(IicDevice *dev, IicTxn *txn, const u8 *data, int byte_count, IicTxnCallback callback, void *callback_ref);
+int Iic_Queue_Read(IicDevice *dev, IicTxn *txn, u8 *buf, int byte_count, IicTxnCallback callback, void *callback_ref);
+int Iic_Queue_WriteRead(IicDevice *dev, IicTxn *txn, u8 reg_addr, u8 *buf, int byte_count, IicTxnCallback callback, void *callback_ref);
+
+// Free slots in a device's queue, a run of that many Iic_Queue_* calls from task context cannot find it full
+u32 Iic_Queue_Room(IicDevice *dev);
+
+// Restart a transaction that found the bus busy, call from the main loop
+void Iic_Queue_Poll(IicCtrl *instance_ptr);
+
+// TRUE once every queued transaction has completed
+int Iic_Queue_Idle(IicCtrl *instance_ptr);
+
+// Status of a queued transaction, XST_DEVICE_BUSY while pending
+int Iic_Txn_Poll(IicTxn *txn);
+
+// Block until a queued transaction completes and return its status
+int Iic_Txn_Wait(IicCtrl *instance_ptr, IicTxn *txn);
+
+// Reset the controller after an error, the active transaction is failed
+int Iic_Recover(IicCtrl *instance_ptr);
 
 // IIC Write Function
-int Iic_Write(IicCtrl *instance_ptr, u8 *data, int byte_count);
+int Iic_Write(IicDevice *dev, u8 *data, int byte_count);
+
+// IIC Read function, specify the device, register address and the number of bytes
+int Iic_Read(IicDevice *dev, u8 reg_addr, u8 *buf, int byte_count);
+
+// Register read with the address and data phases joined by a repeated start, polled through the
+// controller's dynamic logic. byte_count > 1 relies on the target auto-incrementing the address.
+int Iic_Read_Combined(IicDevice *dev, u8 reg_addr, u8 *buf, int byte_count);
+
+// Read a list of registers, one combined transaction each, regs[i] lands in buf[i]
+int Iic_Read_Combined_Multi(IicDevice *dev, const u8 *regs, u8 *buf, int count);
+
+// Compare the per-read latency of Iic_Read and Iic_Read_Combined with the global timer
+void Iic_Read_Benchmark(IicDevice *dev, u8 reg_addr, int iterations);
+
+// Copy the bus counters, driver statistics are merged in first
+void Iic_Stats_Snapshot(IicCtrl *instance_ptr, IicStats *stats);
+
+// Zero the bus counters and the driver statistics
+void Iic_Stats_Reset(IicCtrl *instance_ptr);
 
-// IIC Read function, specify the device addr, register address and the number of bytes
-int Iic_Read(IicCtrl *instance_ptr, u8 reg_addr, u8 *buf, int byte_count);
+// Print a snapshot of the bus counters and the latency histogram
+void Iic_Stats_Print(IicCtrl *instance_ptr);
 
 // Read an IIC IP Register over the AXI4-Lite interface
 u32 Iic_Read_Internal_Reg(IicCtrl *instance_ptr, u8 reg_offset);
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,301 @@
+#include "image_stats.h"
+#include <string.h>
+
+#ifdef PIX_NEON
+#include <arm_neon.h>
+#endif
+
+#define IMAGE_STATS_NEON_CHUNK 2048U    // Pixels per 16 bit lane flush: 256 vectors * 255 < 65536
+#define IMAGE_STATS_PREFETCH   128U    // Bytes ahead of the line loads
+
+static const ImageStatsConfig image_stats_default = {
+    .tiles_x = 4,
+    .tiles_y = 4,
+    .line_step = 2,
+    .sat_level = 250,
+    .black_level = 8,
+};
+
+// --------------------------------------- Line kernels -----------------------------------------------
+
+static inline void Image_Stats_Histogram(ImageStatsTile *tile, const u8 *rgb, const u8 *luma, u32 pixels)
+{
+    for(u32 i = 0; i < pixels; i++)
+    {
+        tile->hist[IMAGE_STATS_R][rgb[3 * i] >> IMAGE_STATS_BIN_SHIFT]++;
+        tile->hist[IMAGE_STATS_G][rgb[3 * i + 1] >> IMAGE_STATS_BIN_SHIFT]++;
+        tile->hist[IMAGE_STATS_B][rgb[3 * i + 2] >> IMAGE_STATS_BIN_SHIFT]++;
+        tile->hist[IMAGE_STATS_Y][luma[i] >> IMAGE_STATS_BIN_SHIFT]++;
+    }
+}
+
+void Image_Stats_Accumulate_C(ImageStatsTile *tile, const u8 *rgb, const u8 *luma, u32 pixels, u8 sat_level, u8 black_level)
+{
+    Image_Stats_Histogram(tile, rgb, luma, pixels);
+    for(u32 i = 0; i < pixels; i++)
+    {
+        const u8 *p = rgb + 3 * i;
+
+        tile->sum[IMAGE_STATS_R] += p[0];
+        tile->sum[IMAGE_STATS_G] += p[1];
+        tile->sum[IMAGE_STATS_B] += p[2];
+        tile->sum[IMAGE_STATS_Y] += luma[i];
+        if(p[0] >= sat_level || p[1] >= sat_level || p[2] >= sat_level) tile->saturated++;
+        if(luma[i] <= black_level) tile->black++;
+    }
+    tile->pixels += pixels;
+}
+
+void Image_Stats_Bayer_Quads_C(u8 *rgb, const u8 *even, const u8 *odd, u32 pixels)
+{
+    for(u32 i = 0; i + 1 < pixels; i += 2, rgb += 3)
+    {
+        rgb[0] = odd[i + 1];
+        rgb[1] = (u8)((even[i + 1] + odd[i] + 1U) >> 1);
+        rgb[2] = even[i];
+    }
+}
+
+#ifdef PIX_NEON
+static inline u32 Image_Stats_Neon_Total(uint16x8_t v)
+{
+    u16 lanes[8];
+    u32 total = 0;
+
+    vst1q_u16(lanes, v);
+    for(u32 i = 0; i < 8; i++) total += lanes[i];
+    return total;
+}
+#endif
+
+void Image_Stats_Accumulate(ImageStatsTile *tile, const u8 *rgb, const u8 *luma, u32 pixels, u8 sat_level, u8 black_level)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    uint8x8_t sat = vdup_n_u8(sat_level), black = vdup_n_u8(black_level);
+
+    Image_Stats_Histogram(tile, rgb, luma, pixels & ~7U);
+    while(i + 8 <= pixels)
+    {
+        u32 end = i + IMAGE_STATS_NEON_CHUNK < pixels ? i + IMAGE_STATS_NEON_CHUNK : pixels;
+        uint16x8_t sr = vdupq_n_u16(0), sg = sr, sb = sr, sy = sr, ns = sr, nb = sr;
+
+        for(; i + 8 <= end; i += 8)
+        {
+            __builtin_prefetch(rgb + 3 * i + IMAGE_STATS_PREFETCH);
+            uint8x8x3_t p = vld3_u8(rgb + 3 * i);
+            uint8x8_t y = vld1_u8(luma + i);
+            uint8x8_t top = vmax_u8(vmax_u8(p.val[0], p.val[1]), p.val[2]);
+
+            sr = vaddw_u8(sr, p.val[0]);
+            sg = vaddw_u8(sg, p.val[1]);
+            sb = vaddw_u8(sb, p.val[2]);
+            sy = vaddw_u8(sy, y);
+            // Compare masks are 0xFF, their top bit counts one
+            ns = vaddw_u8(ns, vshr_n_u8(vcge_u8(top, sat), 7));
+            nb = vaddw_u8(nb, vshr_n_u8(vcle_u8(y, black), 7));
+        }
+        tile->sum[IMAGE_STATS_R] += Image_Stats_Neon_Total(sr);
+        tile->sum[IMAGE_STATS_G] += Image_Stats_Neon_Total(sg);
+        tile->sum[IMAGE_STATS_B] += Image_Stats_Neon_Total(sb);
+        tile->sum[IMAGE_STATS_Y] += Image_Stats_Neon_Total(sy);
+        tile->saturated += Image_Stats_Neon_Total(ns);
+        tile->black += Image_Stats_Neon_Total(nb);
+    }
+    tile->pixels += i;
+#endif
+    Image_Stats_Accumulate_C(tile, rgb + 3 * i, luma + i, pixels - i, sat_level, black_level);
+}
+
+void Image_Stats_Bayer_Quads(u8 *rgb, const u8 *even, const u8 *odd, u32 pixels)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 16 <= pixels; i += 16)
+    {
+        __builtin_prefetch(even + i + IMAGE_STATS_PREFETCH);
+        __builtin_prefetch(odd + i + IMAGE_STATS_PREFETCH);
+        uint8x8x2_t bg = vld2_u8(even + i), gr = vld2_u8(odd + i);
+        uint8x8x3_t out = { { gr.val[1], vrhadd_u8(bg.val[1], gr.val[0]), bg.val[0] } };
+
+        vst3_u8(rgb + 3 * (i / 2), out);
+    }
+#endif
+    Image_Stats_Bayer_Quads_C(rgb + 3 * (i / 2), even + i, odd + i, pixels - i);
+}
+
+// --------------------------------------- Frames -----------------------------------------------------
+
+int Image_Stats_Init(ImageStats *st, const ImageStatsConfig *cfg)
+{
+    if(st == NULL) return XST_INVALID_PARAM;
+    if(cfg == NULL) cfg = &image_stats_default;
+    if(cfg->tiles_x == 0 || cfg->tiles_x > IMAGE_STATS_MAX_TILES_X || cfg->tiles_y == 0 || cfg->tiles_y > IMAGE_STATS_MAX_TILES_Y ||
+       cfg->line_step == 0)
+    {
+        xil_printf("[ERROR] Image stats: %u x %u tiles, line step %u not supported\n", cfg->tiles_x, cfg->tiles_y, cfg->line_step);
+        return XST_INVALID_PARAM;
+    }
+
+    memset(st, 0, sizeof(*st));
+    st->cfg = *cfg;
+    return XST_SUCCESS;
+}
+
+// RGB888 and luma of sample line y, pointing into the image where no unpack is needed
+static void Image_Stats_Unpack(ImageStats *st, const PixImage *img, u32 y, const u8 **rgb, const u8 **luma)
+{
+    const u8 *line = img->planes[0] + (img->format == PIX_FMT_BAYER_BGGR ? 2U * y : y) * img->strides[0];
+    u32 w = img->width;
+
+    *rgb = st->rgb;
+    *luma = st->luma;
+    switch(img->format)
+    {
+        case PIX_FMT_RGB565:
+            Pix_Rgb565ToRgb888_Line(st->rgb, (const u16 *)line, w);
+            break;
+        case PIX_FMT_RGB555:
+            Pix_Rgb555ToRgb565_Line(st->line16, (const u16 *)line, w);
+            Pix_Rgb565ToRgb888_Line(st->rgb, st->line16, w);
+            break;
+        case PIX_FMT_YUYV:
+            Pix_YuyvToRgb888_Line(st->rgb, line, w);
+            Pix_YuyvToGray_Line(st->luma, line, w);
+            return;
+        case PIX_FMT_RGB888:
+            *rgb = line;
+            break;
+        case PIX_FMT_GRAY8:
+            for(u32 x = 0; x < w; x++) memset(st->rgb + 3 * x, line[x], 3);
+            *luma = line;
+            return;
+        case PIX_FMT_BAYER_BGGR:
+            Image_Stats_Bayer_Quads(st->rgb, line, line + img->strides[0], w);
+            w /= 2U;
+            break;
+        default:
+            return;
+    }
+    Pix_Rgb888ToGray_Line(st->luma, *rgb, w);
+}
+
+static void Image_Stats_Add(ImageStatsTile *total, const ImageStatsTile *tile)
+{
+    for(u32 ch = 0; ch < IMAGE_STATS_CHANNELS; ch++)
+    {
+        for(u32 bin = 0; bin < IMAGE_STATS_BINS; bin++) total->hist[ch][bin] += tile->hist[ch][bin];
+        total->sum[ch] += tile->sum[ch];
+    }
+    total->pixels += tile->pixels;
+    total->saturated += tile->saturated;
+    total->black += tile->black;
+}
+
+int Image_Stats_Frame(ImageStats *st, const PixImage *img)
+{
+    const ImageStatsConfig *cfg;
+    u16 x_edge[IMAGE_STATS_MAX_TILES_X + 1];
+    u32 w, h, tiles;
+    XTime t0, t1;
+
+    if(st == NULL || img == NULL) return XST_INVALID_PARAM;
+    cfg = &st->cfg;
+    if(img->format == PIX_FMT_I420 || img->format >= PIX_FMT_COUNT)
+    {
+        st->errors++;
+        return XST_NO_FEATURE;
+    }
+
+    w = img->width;
+    h = img->height;
+    if(img->format == PIX_FMT_BAYER_BGGR)
+    {
+        if(((w | h) & 1U) != 0)
+        {
+            st->errors++;
+            return XST_INVALID_PARAM;
+        }
+        w /= 2U;
+        h /= 2U;
+    }
+    if(w < cfg->tiles_x || h < cfg->tiles_y || img->width > IMAGE_STATS_MAX_WIDTH)
+    {
+        st->errors++;
+        return XST_INVALID_PARAM;
+    }
+
+    XTime_GetTime(&t0);
+    tiles = (u32)cfg->tiles_x * cfg->tiles_y;
+    memset(st->tiles, 0, tiles * sizeof(st->tiles[0]));
+    memset(&st->total, 0, sizeof(st->total));
+    st->width = (u16)w;
+    st->height = (u16)h;
+    for(u32 tx = 0; tx <= cfg->tiles_x; tx++) x_edge[tx] = (u16)(tx * w / cfg->tiles_x);
+
+    for(u32 y = 0; y < h; y += cfg->line_step)
+    {
+        ImageStatsTile *row = st->tiles + (y * cfg->tiles_y / h) * cfg->tiles_x;
+        const u8 *rgb, *luma;
+
+        Image_Stats_Unpack(st, img, y, &rgb, &luma);
+        for(u32 tx = 0; tx < cfg->tiles_x; tx++)
+        {
+            u32 x0 = x_edge[tx];
+
+            Image_Stats_Accumulate(row + tx, rgb + 3 * x0, luma + x0, x_edge[tx + 1] - x0, cfg->sat_level, cfg->black_level);
+        }
+    }
+    for(u32 t = 0; t < tiles; t++) Image_Stats_Add(&st->total, &st->tiles[t]);
+
+    XTime_GetTime(&t1);
+    st->frames++;
+    st->busy_ticks += t1 - t0;
+    return XST_SUCCESS;
+}
+
+const ImageStatsTile* Image_Stats_Tile(const ImageStats *st, u32 tx, u32 ty)
+{
+    if(tx >= st->cfg.tiles_x || ty >= st->cfg.tiles_y) return NULL;
+    return &st->tiles[ty * st->cfg.tiles_x + tx];
+}
+
+u32 Image_Stats_Mean(const ImageStatsTile *tile, ImageStatsChannel ch)
+{
+    if(tile->pixels == 0) return 0;
+    return (tile->sum[ch] + tile->pixels / 2U) / tile->pixels;
+}
+
+u32 Image_Stats_Percentile(const ImageStatsTile *tile, ImageStatsChannel ch, u32 percent)
+{
+    u64 target = (u64)tile->pixels * (percent > 100U ? 100U : percent);
+    u64 seen = 0;
+
+    if(tile->pixels == 0) return 0;
+    for(u32 bin = 0; bin < IMAGE_STATS_BINS; bin++)
+    {
+        seen += (u64)tile->hist[ch][bin] * 100U;
+        if(seen >= target) return ((bin + 1U) << IMAGE_STATS_BIN_SHIFT) - 1U;
+    }
+    return 255U;
+}
+
+void Image_Stats_Print(const ImageStats *st)
+{
+    const ImageStatsTile *total = &st->total;
+
+    xil_printf("[INFO] Image stats: %u frames, %u refused, %u us per frame, %u x %u samples in %u x %u tiles\n",
+               st->frames, st->errors, st->frames != 0 ? (u32)(st->busy_ticks / st->frames / (COUNTS_PER_SECOND / 1000000)) : 0U,
+               st->width, st->height, st->cfg.tiles_x, st->cfg.tiles_y);
+    xil_printf("[INFO]   mean R %u G %u B %u Y %u, saturated %u, black %u of %u\n",
+               Image_Stats_Mean(total, IMAGE_STATS_R), Image_Stats_Mean(total, IMAGE_STATS_G), Image_Stats_Mean(total, IMAGE_STATS_B),
+               Image_Stats_Mean(total, IMAGE_STATS_Y), total->saturated, total->black, total->pixels);
+    for(u32 ty = 0; ty < st->cfg.tiles_y; ty++)
+    {
+        xil_printf("[INFO]   Y");
+        for(u32 tx = 0; tx < st->cfg.tiles_x; tx++) xil_printf(" %3u", Image_Stats_Mean(Image_Stats_Tile(st, tx, ty), IMAGE_STATS_Y));
+        xil_printf("\n");
+    }
+}
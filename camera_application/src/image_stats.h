@@ -0,0 +1,94 @@
+#ifndef __IMAGE_STATS_H__
+#define __IMAGE_STATS_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "xiltimer.h"
+#include "pixel_convert.h"
+
+/*
+    Frame statistics for exposure, white balance and scene change, gathered in a single pass so
+    the frame crosses the DDR bus once. Each sampled line is unpacked to RGB888 and luma in line
+    buffers ( L1 resident, the pixel_convert kernels ), then every tile of a configurable grid
+    accumulates from its span of the line:
+
+    - R, G, B and luma histograms, IMAGE_STATS_BINS bins each
+    - channel sums, for means
+    - saturated pixels ( any colour channel at or above sat_level ) and black pixels ( luma at or
+      below black_level )
+
+    Sums and counts are NEON, the histograms scalar. line_step N samples every Nth line.
+    Raw Bayer frames are measured per 2x2 quad ( R, mean of the greens, B ), so the sample grid is
+    half size and line_step counts quad rows.
+*/
+
+#define IMAGE_STATS_MAX_TILES_X 8U
+#define IMAGE_STATS_MAX_TILES_Y 8U
+#define IMAGE_STATS_BINS        32U
+#define IMAGE_STATS_BIN_SHIFT   3U      // 8 bit level to bin
+#define IMAGE_STATS_MAX_WIDTH   640U    // Widest line, VGA
+
+typedef enum {
+    IMAGE_STATS_R,
+    IMAGE_STATS_G,
+    IMAGE_STATS_B,
+    IMAGE_STATS_Y,
+    IMAGE_STATS_CHANNELS,
+} ImageStatsChannel;
+
+typedef struct {
+    u32 hist[IMAGE_STATS_CHANNELS][IMAGE_STATS_BINS];
+    u32 sum[IMAGE_STATS_CHANNELS];
+    u32 pixels;          // Samples taken
+    u32 saturated;       // Any colour channel >= sat_level
+    u32 black;           // Luma <= black_level
+} ImageStatsTile;
+
+typedef struct {
+    u8 tiles_x;          // 1 .. IMAGE_STATS_MAX_TILES_X
+    u8 tiles_y;          // 1 .. IMAGE_STATS_MAX_TILES_Y
+    u8 line_step;        // Sample every Nth line, >= 1
+    u8 sat_level;
+    u8 black_level;
+} ImageStatsConfig;
+
+typedef struct {
+    ImageStatsConfig cfg;
+    ImageStatsTile tiles[IMAGE_STATS_MAX_TILES_X * IMAGE_STATS_MAX_TILES_Y];   // Row major, tiles_x per row
+    ImageStatsTile total;                // Whole frame, sum of the tiles
+    u16 width;                           // Sample grid of the last frame
+    u16 height;
+    u32 frames;
+    u32 errors;                          // Frames refused
+    u64 busy_ticks;                      // Global timer ticks spent measuring
+    u8  rgb[IMAGE_STATS_MAX_WIDTH * 3];  // Current line unpacked
+    u8  luma[IMAGE_STATS_MAX_WIDTH];
+    u16 line16[IMAGE_STATS_MAX_WIDTH];   // RGB555 widened to RGB565 first
+} ImageStats;
+
+// NULL cfg: 4 x 4 tiles, every 2nd line, saturated at 250, black at 8
+int Image_Stats_Init(ImageStats *st, const ImageStatsConfig *cfg);
+
+// Measure one frame, any PixFormat but I420. The previous frame's numbers are replaced.
+int Image_Stats_Frame(ImageStats *st, const PixImage *img);
+
+const ImageStatsTile* Image_Stats_Tile(const ImageStats *st, u32 tx, u32 ty);
+
+// Rounded mean level of a channel, 0 without samples
+u32 Image_Stats_Mean(const ImageStatsTile *tile, ImageStatsChannel ch);
+
+// Level below which percent of the samples fall, from the histogram ( bin resolution )
+u32 Image_Stats_Percentile(const ImageStatsTile *tile, ImageStatsChannel ch, u32 percent);
+
+// Accumulate pixels of an RGB888 line and its luma into a tile
+void Image_Stats_Accumulate(ImageStatsTile *tile, const u8 *rgb, const u8 *luma, u32 pixels, u8 sat_level, u8 black_level);
+void Image_Stats_Accumulate_C(ImageStatsTile *tile, const u8 *rgb, const u8 *luma, u32 pixels, u8 sat_level, u8 black_level);
+
+// RGB888 of each BGGR quad of a raw line pair ( B G over G R ), pixels is the raw width
+void Image_Stats_Bayer_Quads(u8 *rgb, const u8 *even, const u8 *odd, u32 pixels);
+void Image_Stats_Bayer_Quads_C(u8 *rgb, const u8 *even, const u8 *odd, u32 pixels);
+
+void Image_Stats_Print(const ImageStats *st);
+
+#endif
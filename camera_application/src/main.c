@@ -3,7 +3,6 @@
 #include <xiic_l.h>
 #include <xil_exception.h>
 #include <xstatus.h>
-#include <stdlib.h>
 
 #include "platform.h"
 #include "xil_printf.h"
@@ -11,22 +10,66 @@
 #include "xgpio.h"
 #include "xscugic.h"
 #include "ov7670.h"
+#include "ov7670_profiles.h"
 #include "iic_helper.h"
+#include "frame_pool.h"
+#include "frame_ring.h"
+#include "dma_helper.h"
+#include "capture.h"
+#include "dma_service.h"
+#include "cache_policy.h"
+#include "mem_bench.h"
+#include "resize.h"
+#include "demosaic.h"
+#include "image_stats.h"
+#include "auto_exposure.h"
+#include "auto_white_balance.h"
+#include "color_pipeline.h"
+#include "motion_detect.h"
 
 #define LED_CONTROL_BA          XPAR_LED_CONTROL_BASEADDR           // Base Address for the AXI GPIO that controls the LEDs
 #define CAMERA_CONTROL_BA       XPAR_CAMERA_CONTROL_BASEADDR        // Base Address for the AXI GPIO that controls reset and power down for OV7670 
 #define IIC_CAMERA_BA           XPAR_CAMERA_IIC_BASEADDR            // Base Address for the AXI IIC Controller used to configure the OV7670 
 #define XSCUGIC_BA              XPAR_XSCUGIC_0_BASEADDR             // Base Address for the ARM General Interrupt Controller Device
+#define DMA_BA                  XPAR_XDMAPS_0_BASEADDR              // Base Address for the PS DMA controller ( PL330 )
 #define IIC_INTERRUPT_ID        61U                                 // Interrupt ID that used by the IIC controller
-#define BUFFER_SIZE             32                                  // Buffer size for IIC communications
+#define FRAME_POOL_BLOCKS       8                                   // VGA RGB565 frames in flight: capture 2, ring FRAME_RING_SLOTS, processing 2
+#define CAPTURE_DMA_PERIPH      0U                                  // PL330 peripheral request wired to the pixel FIFO
+#define CAPTURE_DMA_CH_A        0U                                  // DMA channels used by the capture ping-pong
+#define CAPTURE_DMA_CH_B        1U
+#define DMA_SERVICE_CHANNELS    0xFCU                               // Channels 2..7 for memory copies and fills
+#define PREVIEW_WIDTH           160U                                // QQVGA preview derived from every consumed frame
+#define PREVIEW_HEIGHT          120U
+#define CAPTURE_FORMAT          OV7670_FMT_RGB565                   // OV7670_FMT_BAYER_RAW captures raw BGGR, demosaiced here
+// CAPTURE_FIFO_BA, the AXI read port of the PL pixel FIFO, enables capture once the IP is in the platform
+
+#if FRAME_POOL_BLOCKS < FRAME_RING_SLOTS + 4
+#error "The frame ring must leave capture and processing blocks in the pool"
+#endif
 
 static XGpio led_gpio, camera_gpio;     // XGpio Structures
 static XScuGic intr_ctl;                // Interrupt Controller Struct
 static XScuGic_Config* intr_cfg;        // Configuration for the Interrupt controller struct
 static OV7670 camera;
+static FramePool frame_pool;            // Full size frames, see lscript.ld .frame_mem
+static FrameRing frame_ring;            // Captured frames waiting for the processing loop
+static DmaCtrl dma_ctrl;                // PS DMA, shared by capture and memory copies
+static DmaService dma_service;          // Async copies and fills on the channels capture does not use
+static Resize preview_resize;           // Line buffers for the preview scaler
+static PixImage preview;                // Latest frame at PREVIEW_WIDTH x PREVIEW_HEIGHT, RGB565
+static Demosaic demosaic;               // Raw Bayer frames to RGB565 before anything else sees them
+static ImageStats frame_stats;          // Tile statistics of every consumed frame, as captured
+static AutoExposure auto_exposure;      // Exposure / gain loop on frame_stats, replaces the sensor's AEC / AGC
+static AutoWhiteBalance auto_wb;        // Red / blue gains from frame_stats, replaces the sensor's AWB
+static ColorPipeline color_pipeline;    // Colour matrix and gamma, only raw captures need them
+static MotionDetect motion;             // Static frames stop after the statistics
+#ifdef CAPTURE_FIFO_BA
+static Capture capture;
+#endif
 
-u8 *iic_read_buf;
-u8 *iic_write_buf;
+// Frame memory region from the linker script
+extern u8 __frame_mem_free[];
+extern u8 __frame_mem_end[];
 
 void blink_leds();  // basic function to test GPIO functionality
 
@@ -46,13 +89,39 @@ int main()
     // Set the Data Directions
     XGpio_SetDataDirection(&led_gpio, 1, 0x00000000); // All outputs
     
-    // ------------------------------- Now Initialise the IIC Driver -----------------------------------------
-    
-    // Also, allocate space for the buffers
-    iic_read_buf = (u8*) malloc(BUFFER_SIZE);
-    iic_write_buf = (u8*) malloc(BUFFER_SIZE);
+    // ------------------------------- Frame Buffers in DDR --------------------------------------------------
+    status = Frame_Mem_Init(__frame_mem_free, (u32)(__frame_mem_end - __frame_mem_free));
+    if(status != XST_SUCCESS) return XST_FAILURE;
+    Cache_Policy_Init();
+
+    // Sized for the largest profile in use, VGA RGB565
+    OV7670_FrameInfo frame_info = OV7670_Profile_FrameInfo(OV7670_RES_VGA, OV7670_FMT_RGB565);
+    status = FramePool_Create(&frame_pool, "vga", Frame_BlockSize(frame_info.width, frame_info.height, frame_info.bytes_per_pixel), FRAME_POOL_BLOCKS);
+    if(status != XST_SUCCESS) return XST_FAILURE;
+
+    // Preview buffer, a 4x box reduction of VGA
+    Resize_Init(&preview_resize);
+    Demosaic_Init(&demosaic, DEMOSAIC_EDGE_AWARE);
+    Color_Pipeline_Init(&color_pipeline);
+    Motion_Detect_Init(&motion, NULL);
+    if(CAPTURE_FORMAT == OV7670_FMT_BAYER_RAW)
+    {
+        // Raw Bayer skips the sensor's own matrix and gamma, put a basic pair back
+        u8 gamma[256];
+        s16 matrix[COLOR_PIPELINE_CHANNELS][COLOR_PIPELINE_CHANNELS];
+
+        Color_Pipeline_Gamma_Lut(gamma, COLOR_PIPELINE_GAMMA_SRGB);
+        Color_Pipeline_Saturation_Matrix(matrix, COLOR_PIPELINE_ONE * 5 / 4);
+        Color_Pipeline_Set_Matrix(&color_pipeline, matrix);
+        Color_Pipeline_Set_Lut(&color_pipeline, gamma, gamma, gamma);
+    }
+    status = Pix_Image_Init(&preview, Frame_Mem_Alloc(Pix_Image_Size(PIX_FMT_RGB565, PREVIEW_WIDTH, PREVIEW_HEIGHT), FRAME_ALIGN),
+                            PREVIEW_WIDTH, PREVIEW_HEIGHT, PIX_FMT_RGB565);
+    if(status != XST_SUCCESS) return XST_FAILURE;
 
-    xil_printf("[DEBUG] Initialied IIC controller, buffers of size: %d bytes\n", BUFFER_SIZE);
+    // Default 4 x 4 tiles on every 2nd line
+    status = Image_Stats_Init(&frame_stats, NULL);
+    if(status != XST_SUCCESS) return XST_FAILURE;
 
     // ------------------------------ Now Setup the Interrupt System ------------------------------------------
 
@@ -64,22 +133,29 @@ int main()
 
     // -------------------------------- Setup the IIC Helper ---------------------------------------------
     IicCtrl iic_ctrl;
+    IicDevice ov7670_iic;
     u8 ov7670_iic_address = 0x21;
-    status = Iic_Helper_Init(&iic_ctrl, IIC_CAMERA_BA, &intr_ctl, IIC_INTERRUPT_ID, ov7670_iic_address);
+    status = Iic_Helper_Init(&iic_ctrl, IIC_CAMERA_BA, &intr_ctl, IIC_INTERRUPT_ID);
+    if( status != XST_SUCCESS ) return XST_FAILURE;
+
+    // Other slaves on this bus get their own IicDevice the same way
+    status = Iic_Device_Init(&ov7670_iic, &iic_ctrl, ov7670_iic_address);
     if( status != XST_SUCCESS ) return XST_FAILURE;
 
     // -------------------------------- Setup the OV7670 Driver -------------------------------------------
-    status = OV7670_Init(&camera, &iic_ctrl, &camera_gpio);
+    status = OV7670_Init(&camera, &ov7670_iic, &camera_gpio);
     if( status != XST_SUCCESS ) return XST_FAILURE; 
     xil_printf("[DEBUG] OV7670 Camera IIC Control System Ready!\n");
 
-    // Perform a software reset
-    status = OV7670_Reset(&camera);
-
     // -------------------------------- IIC Test for OV7670 Driver -----------------------------------------
     status = OV7670_Reg_ReadWrite_Test(&camera);
     if(status != XST_SUCCESS) return XST_FAILURE;
 
+#ifdef IIC_READ_BENCHMARK
+    // Compare the split and repeated-start register read paths ( -DIIC_READ_BENCHMARK )
+    Iic_Read_Benchmark(&ov7670_iic, REG_PID, 256);
+#endif
+
     // basic setup for camera
     status = OV7670_Basic_Setup(&camera);
     if(status != XST_SUCCESS)
@@ -88,6 +164,74 @@ int main()
         return XST_FAILURE;
     }
 
+    OV7670_Print_Startup_Report(&camera);
+
+    // Full VGA profile, later resolution/format switches only write the delta
+    OV7670_Profiles_Init();
+    status = OV7670_SetProfile(&camera, OV7670_RES_VGA, CAPTURE_FORMAT);
+    if(status != XST_SUCCESS)
+    {
+        xil_printf("[DEBUG] Failed to apply OV7670 profile with status: %d\n", status);
+        return XST_FAILURE;
+    }
+
+    // Exposure, gain and white balance from the frame statistics from here on
+    status = Auto_Exposure_Init(&auto_exposure, &camera, NULL);
+    if(status != XST_SUCCESS) return XST_FAILURE;
+    status = Auto_White_Balance_Init(&auto_wb, &camera, NULL);
+    if(status != XST_SUCCESS) return XST_FAILURE;
+
+    // -------------------------------- Setup the PS DMA ------------------------------------------------
+    // After the camera bring-up, so the self test and cache calibration do not delay camera ready
+    status = Dma_Helper_Init(&dma_ctrl, DMA_BA, &intr_ctl);
+    if( status != XST_SUCCESS ) return XST_FAILURE;
+    FrameRing_Init(&frame_ring);
+
+    status = Dma_Service_Init(&dma_service, &dma_ctrl, DMA_SERVICE_CHANNELS);
+    if( status != XST_SUCCESS ) return XST_FAILURE;
+
+    // Two pool frames as scratch, they go back before capture needs them
+    FrameBuf *dma_test_a = FramePool_Alloc(&frame_pool);
+    FrameBuf *dma_test_b = FramePool_Alloc(&frame_pool);
+    if(dma_test_a == NULL || dma_test_b == NULL) return XST_FAILURE;
+
+    // Frame sized syncs decide between the line walk and a full clean on this board's numbers
+    Cache_Policy_Calibrate(dma_test_a->data, frame_pool.block_size);
+    status = Dma_Service_SelfTest(&dma_service, dma_test_a->data, dma_test_b->data, frame_pool.block_size);
+    FrameBuf_Release(dma_test_a);
+    FrameBuf_Release(dma_test_b);
+    if( status != XST_SUCCESS ) return XST_FAILURE;
+    Dma_Service_Print_Stats(&dma_service);
+
+#ifdef CACHE_POLICY_BENCHMARK
+    // Range, full and attribute based maintenance side by side ( -DCACHE_POLICY_BENCHMARK ), takes 1 MB for good
+    Cache_Policy_Benchmark(Frame_Mem_Alloc(CACHE_SECTION, CACHE_SECTION), CACHE_SECTION);
+#endif
+
+#ifdef MEM_BENCHMARK
+    // Xil_MemCpy / Xil_MemSet against newlib, cached and non-cacheable ( -DMEM_BENCHMARK ), takes 9 MB for good
+    Mem_Benchmark(Frame_Mem_Alloc(MEM_BENCH_REGION_BYTES, CACHE_SECTION));
+#endif
+
+#ifdef CAPTURE_FIFO_BA
+    // -------------------------------- Frame Capture into DDR ---------------------------------------------
+    OV7670_FrameInfo capture_info = OV7670_Profile_FrameInfo(OV7670_RES_VGA, CAPTURE_FORMAT);
+    CaptureConfig capture_cfg = {
+        .fifo_addr = CAPTURE_FIFO_BA,
+        .periph = CAPTURE_DMA_PERIPH,
+        .width = capture_info.width,
+        .height = capture_info.height,
+        .bytes_per_pixel = capture_info.bytes_per_pixel,
+        .format = CAPTURE_FORMAT,
+        .dst_stride = 0,
+        .channels = { CAPTURE_DMA_CH_A, CAPTURE_DMA_CH_B },
+    };
+    status = Capture_Init(&capture, &dma_ctrl, &frame_pool, &frame_ring, &capture_cfg);
+    if(status != XST_SUCCESS) return XST_FAILURE;
+    status = Capture_Start(&capture);
+    if(status != XST_SUCCESS) return XST_FAILURE;
+#endif
+
     // Now we need some time to catch the data ( check if it is coming as well )
     blink_leds();
 
@@ -102,6 +246,53 @@ void blink_leds()
     while(1)
     {
         xil_printf("[DEBUG] Blink LED: %d\n", count++);
+
+        // Statistics and the preview are derived so far, hand the newest back so capture keeps getting buffers
+        FrameBuf *frame = FrameRing_ConsumeLatest(&frame_ring);
+        if(frame != NULL)
+        {
+            PixImage full;
+            int status;
+
+            xil_printf("[DEBUG] Frame %u at %u x %u\n", frame->sequence, frame->width, frame->height);
+            status = Pix_Image_FromFrame(&full, frame);
+            if(status == XST_SUCCESS && Image_Stats_Frame(&frame_stats, &full) == XST_SUCCESS)
+            {
+                Auto_Exposure_Update(&auto_exposure, &frame_stats);
+                Auto_White_Balance_Update(&auto_wb, &frame_stats);
+            }
+            // Nothing moved: the statistics keep the loops going, the rest of the chain is skipped
+            if(status == XST_SUCCESS && Motion_Detect_Frame(&motion, &full) == XST_SUCCESS && !motion.motion)
+                status = XST_NO_DATA;
+            if(status == XST_SUCCESS && full.format == PIX_FMT_BAYER_BGGR)
+            {
+                // Raw capture, demosaic into a spare pool block ( sized for VGA RGB565 ) and work on that
+                FrameBuf *rgb = FramePool_Alloc(&frame_pool);
+                PixImage raw = full;
+
+                status = rgb != NULL ? Pix_Image_Init(&full, rgb->data, raw.width, raw.height, PIX_FMT_RGB565) : XST_FAILURE;
+                if(status == XST_SUCCESS) status = Demosaic_Frame(&demosaic, &raw, &full);
+                FrameBuf_Release(frame);
+                frame = rgb;
+            }
+            // Digital white balance gain, only while a sensor gain is at its limit
+            if(status == XST_SUCCESS) Auto_White_Balance_Apply(&auto_wb, &full);
+            if(status == XST_SUCCESS) Color_Pipeline_Frame(&color_pipeline, &full);
+            if(status == XST_SUCCESS && full.format == preview.format)
+                Resize_Image(&preview_resize, &full, NULL, &preview);
+            if(frame != NULL) FrameBuf_Release(frame);
+        }
+#ifdef CAPTURE_FIFO_BA
+        Capture_Print_Stats(&capture);
+        Dma_Fault_Print_Stats(&dma_ctrl);
+        Resize_Print_Stats(&preview_resize);
+        if(CAPTURE_FORMAT == OV7670_FMT_BAYER_RAW) Demosaic_Print_Stats(&demosaic);
+        Image_Stats_Print(&frame_stats);
+        Auto_Exposure_Print_Stats(&auto_exposure);
+        Auto_White_Balance_Print_Stats(&auto_wb);
+        Color_Pipeline_Print_Stats(&color_pipeline);
+        Motion_Detect_Print_Stats(&motion);
+#endif
         XGpio_DiscreteWrite(&led_gpio, 1, count);
         usleep(1000000);
     }
@@ -0,0 +1,24 @@
+#ifndef __MEM_BENCH_H__
+#define __MEM_BENCH_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "xiltimer.h"
+#include "cache_policy.h"
+
+/*
+    Throughput of the BSP Xil_MemCpy / Xil_MemSet ( NEON above XIL_MEM_NEON_MIN bytes ) against
+    newlib memcpy / memset, from 32 B to MEM_BENCH_MAX_BYTES, with the scratch region write-back
+    cached and then non-cacheable.
+*/
+
+#define MEM_BENCH_MIN_BYTES    32U
+#define MEM_BENCH_MAX_BYTES    (4U * 1024U * 1024U)
+#define MEM_BENCH_PASS_BYTES   (1024U * 1024U)      // Small sizes repeat until a pass moves this much
+#define MEM_BENCH_REGION_BYTES (2U * MEM_BENCH_MAX_BYTES + CACHE_SECTION) // Source, destination and a section of slack
+
+// region: MEM_BENCH_REGION_BYTES of scratch, 1 MB section aligned, left write-back afterwards
+int Mem_Benchmark(void *region);
+
+#endif
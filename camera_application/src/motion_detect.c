@@ -0,0 +1,276 @@
+#include "motion_detect.h"
+#include <string.h>
+
+#ifdef PIX_NEON
+#include <arm_neon.h>
+#endif
+
+#define MOTION_DETECT_SAMPLES_PER_BLOCK (MOTION_DETECT_BLOCK * MOTION_DETECT_BLOCK)
+
+static const MotionDetectConfig motion_detect_default = {
+    .on_level = 12,
+    .off_level = 6,
+    .adapt_shift = 1,
+    .hold_frames = 4,
+    .min_blocks = 2,
+};
+
+// --------------------------------------- Scalar references ------------------------------------------
+
+void Motion_Detect_Sample_Line_C(u8 *dst, const u8 *gray, u32 samples)
+{
+    // Pairwise rounded halving, the same as two levels of VRHADD
+    for(u32 i = 0; i < samples; i++, gray += MOTION_DETECT_STEP)
+    {
+        u32 a = (gray[0] + gray[1] + 1U) >> 1, b = (gray[2] + gray[3] + 1U) >> 1;
+
+        dst[i] = (u8)((a + b + 1U) >> 1);
+    }
+}
+
+void Motion_Detect_Sad_Line_C(u16 *sad, u8 *ref, const u8 *cur, u32 samples, u32 adapt_shift)
+{
+    s32 round = adapt_shift != 0 ? 1 << (adapt_shift - 1U) : 0;
+
+    for(u32 i = 0; i < samples; i++)
+    {
+        s32 diff = (s32)cur[i] - (s32)ref[i];
+
+        sad[i / MOTION_DETECT_BLOCK] += (u16)(diff < 0 ? -diff : diff);
+        ref[i] = (u8)(ref[i] + ((diff + round) >> adapt_shift));
+    }
+}
+
+// --------------------------------------- NEON kernels -----------------------------------------------
+
+void Motion_Detect_Sample_Line(u8 *dst, const u8 *gray, u32 samples)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 8 <= samples; i += 8)
+    {
+        uint8x8x4_t p = vld4_u8(gray + MOTION_DETECT_STEP * i);
+
+        vst1_u8(dst + i, vrhadd_u8(vrhadd_u8(p.val[0], p.val[1]), vrhadd_u8(p.val[2], p.val[3])));
+    }
+#endif
+    Motion_Detect_Sample_Line_C(dst + i, gray + MOTION_DETECT_STEP * i, samples - i);
+}
+
+void Motion_Detect_Sad_Line(u16 *sad, u8 *ref, const u8 *cur, u32 samples, u32 adapt_shift)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    int16x8_t shift = vdupq_n_s16((s16)-(s32)adapt_shift);
+
+    for(; i + 16 <= samples; i += 16)
+    {
+        uint8x16_t c = vld1q_u8(cur + i), r = vld1q_u8(ref + i);
+        int16x8_t lo = vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(c), vget_low_u8(r)));
+        int16x8_t hi = vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(c), vget_high_u8(r)));
+
+        // Neighbouring differences add up into one block each
+        vst1q_u16(sad + i / MOTION_DETECT_BLOCK, vpadalq_u8(vld1q_u16(sad + i / MOTION_DETECT_BLOCK), vabdq_u8(c, r)));
+
+        // Rounding shift right of the signed difference, then back onto the reference
+        lo = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(r))), vrshlq_s16(lo, shift));
+        hi = vaddq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(r))), vrshlq_s16(hi, shift));
+        vst1q_u8(ref + i, vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi)));
+    }
+#endif
+    Motion_Detect_Sad_Line_C(sad + i / MOTION_DETECT_BLOCK, ref + i, cur + i, samples - i, adapt_shift);
+}
+
+// --------------------------------------- Frames -----------------------------------------------------
+
+int Motion_Detect_Init(MotionDetect *md, const MotionDetectConfig *cfg)
+{
+    if(md == NULL) return XST_INVALID_PARAM;
+    if(cfg == NULL) cfg = &motion_detect_default;
+    if(cfg->off_level > cfg->on_level || cfg->on_level == 0 || cfg->adapt_shift > 7U || cfg->min_blocks == 0)
+    {
+        xil_printf("[ERROR] Motion detect: config refused\n");
+        return XST_INVALID_PARAM;
+    }
+
+    memset(md, 0, sizeof(*md));
+    md->cfg = *cfg;
+    return XST_SUCCESS;
+}
+
+// Luma of source line y, the line itself when the format is luma already
+static const u8* Motion_Detect_Gray(MotionDetect *md, const PixImage *img, u32 y)
+{
+    const u8 *line = img->planes[0] + y * img->strides[0];
+    u32 w = img->width;
+
+    switch(img->format)
+    {
+        case PIX_FMT_RGB565:      Pix_Rgb565ToGray_Line(md->gray, (const u16 *)line, w); break;
+        case PIX_FMT_RGB555:      Pix_Rgb555ToGray_Line(md->gray, (const u16 *)line, w); break;
+        case PIX_FMT_RGB888:      Pix_Rgb888ToGray_Line(md->gray, line, w); break;
+        case PIX_FMT_YUYV:        Pix_YuyvToGray_Line(md->gray, line, w); break;
+        case PIX_FMT_BAYER_BGGR:  Pix_BayerToGray_Line2(md->gray, md->gray, line, line + img->strides[0], w); break;
+        default:                  return line;  // Gray, the Y plane of I420
+    }
+    return md->gray;
+}
+
+static void Motion_Detect_Box_Add(MotionDetect *md, const MotionDetectBox *box)
+{
+    u32 i = md->box_count < MOTION_DETECT_MAX_BOXES ? md->box_count++ : MOTION_DETECT_MAX_BOXES;
+
+    // Insertion by size, the smallest drops off the end once the list is full
+    if(i == MOTION_DETECT_MAX_BOXES)
+    {
+        if(box->blocks <= md->boxes[i - 1U].blocks) return;
+        i--;
+    }
+    for(; i > 0 && md->boxes[i - 1U].blocks < box->blocks; i--) md->boxes[i] = md->boxes[i - 1U];
+    md->boxes[i] = *box;
+}
+
+// Groups of 8-connected blocks, one flood fill each over a copy of the bitmap
+static void Motion_Detect_Boxes(MotionDetect *md)
+{
+    u8 (*todo)[MOTION_DETECT_BLOCKS_X / 8] = md->todo;
+    u32 bw = md->blocks_x, bh = md->blocks_y;
+
+    md->box_count = 0;
+    if(md->active == 0) return;
+    memcpy(md->todo, md->bitmap, sizeof(md->todo));
+
+    for(u32 by = 0; by < bh; by++)
+    {
+        for(u32 bx = 0; bx < bw; bx++)
+        {
+            u32 x0 = bx, x1 = bx, y0 = by, y1 = by, count = 0, top = 0;
+            MotionDetectBox box;
+
+            if((todo[by][bx >> 3] & (1U << (bx & 7U))) == 0) continue;
+            todo[by][bx >> 3] &= (u8)~(1U << (bx & 7U));
+            md->stack[top++] = (u16)(by * MOTION_DETECT_BLOCKS_X + bx);
+
+            while(top != 0)
+            {
+                u32 cx = md->stack[--top] % MOTION_DETECT_BLOCKS_X, cy = md->stack[top] / MOTION_DETECT_BLOCKS_X;
+
+                count++;
+                if(cx < x0) x0 = cx;
+                if(cx > x1) x1 = cx;
+                if(cy < y0) y0 = cy;
+                if(cy > y1) y1 = cy;
+                for(u32 ny = cy != 0 ? cy - 1U : 0; ny <= cy + 1U && ny < bh; ny++)
+                {
+                    for(u32 nx = cx != 0 ? cx - 1U : 0; nx <= cx + 1U && nx < bw; nx++)
+                    {
+                        if((todo[ny][nx >> 3] & (1U << (nx & 7U))) == 0) continue;
+                        todo[ny][nx >> 3] &= (u8)~(1U << (nx & 7U));
+                        md->stack[top++] = (u16)(ny * MOTION_DETECT_BLOCKS_X + nx);
+                    }
+                }
+            }
+
+            box.x = (u16)(x0 * MOTION_DETECT_BLOCK * MOTION_DETECT_STEP);
+            box.y = (u16)(y0 * MOTION_DETECT_BLOCK * MOTION_DETECT_STEP);
+            box.width = (u16)((x1 - x0 + 1U) * MOTION_DETECT_BLOCK * MOTION_DETECT_STEP);
+            box.height = (u16)((y1 - y0 + 1U) * MOTION_DETECT_BLOCK * MOTION_DETECT_STEP);
+            box.blocks = (u16)count;
+            Motion_Detect_Box_Add(md, &box);
+        }
+    }
+}
+
+int Motion_Detect_Frame(MotionDetect *md, const PixImage *img)
+{
+    const MotionDetectConfig *cfg;
+    u32 bw, bh, samples, on, off, seed;
+    XTime t0, t1;
+
+    if(md == NULL || img == NULL) return XST_INVALID_PARAM;
+    cfg = &md->cfg;
+    if(img->format >= PIX_FMT_COUNT)
+    {
+        md->stats.errors++;
+        return XST_NO_FEATURE;
+    }
+
+    bw = img->width / (MOTION_DETECT_STEP * MOTION_DETECT_BLOCK);
+    bh = img->height / (MOTION_DETECT_STEP * MOTION_DETECT_BLOCK);
+    if(bw == 0 || bh == 0 || img->width > MOTION_DETECT_MAX_WIDTH || img->height > MOTION_DETECT_MAX_HEIGHT)
+    {
+        md->stats.errors++;
+        return XST_INVALID_PARAM;
+    }
+
+    XTime_GetTime(&t0);
+
+    // A new size starts over from this frame
+    seed = !md->seeded || bw != md->blocks_x || bh != md->blocks_y;
+    md->blocks_x = (u16)bw;
+    md->blocks_y = (u16)bh;
+    samples = bw * MOTION_DETECT_BLOCK;
+    on = (u32)cfg->on_level * MOTION_DETECT_SAMPLES_PER_BLOCK;
+    off = (u32)cfg->off_level * MOTION_DETECT_SAMPLES_PER_BLOCK;
+    if(seed) memset(md->bitmap, 0, sizeof(md->bitmap));
+
+    md->active = 0;
+    for(u32 by = 0; by < bh; by++)
+    {
+        u8 *bits = md->bitmap[by];
+
+        memset(md->sad, 0, bw * sizeof(md->sad[0]));
+        for(u32 row = 0; row < MOTION_DETECT_BLOCK; row++)
+        {
+            u32 sy = by * MOTION_DETECT_BLOCK + row;
+
+            // Bayer lines are read in B G / G R pairs, the top one has to be even
+            Motion_Detect_Sample_Line(md->samples, Motion_Detect_Gray(md, img, sy * MOTION_DETECT_STEP), samples);
+            if(seed) memcpy(md->ref[sy], md->samples, samples);
+            else Motion_Detect_Sad_Line(md->sad, md->ref[sy], md->samples, samples, cfg->adapt_shift);
+        }
+        if(seed) continue;
+
+        // Hysteresis per block
+        for(u32 bx = 0; bx < bw; bx++)
+        {
+            u8 mask = (u8)(1U << (bx & 7U));
+
+            if(md->sad[bx] >= on) bits[bx >> 3] |= mask;
+            else if(md->sad[bx] < off) bits[bx >> 3] &= (u8)~mask;
+            if(bits[bx >> 3] & mask) md->active++;
+        }
+    }
+
+    Motion_Detect_Boxes(md);
+    if(seed || md->active >= cfg->min_blocks) md->hold = (u8)(cfg->hold_frames + 1U);
+    md->motion = md->hold != 0;
+    if(md->hold != 0) md->hold--;
+    md->seeded = TRUE;
+
+    XTime_GetTime(&t1);
+    md->stats.frames++;
+    if(md->motion) md->stats.motion_frames++;
+    md->stats.busy_ticks += t1 - t0;
+    return XST_SUCCESS;
+}
+
+u32 Motion_Detect_Block(const MotionDetect *md, u32 bx, u32 by)
+{
+    if(bx >= md->blocks_x || by >= md->blocks_y) return FALSE;
+    return (md->bitmap[by][bx >> 3] >> (bx & 7U)) & 1U;
+}
+
+void Motion_Detect_Print_Stats(const MotionDetect *md)
+{
+    xil_printf("[INFO] Motion detect: %u frames, %u with motion, %u refused, %u us per frame, %u x %u blocks\n",
+               md->stats.frames, md->stats.motion_frames, md->stats.errors,
+               md->stats.frames != 0 ? (u32)(md->stats.busy_ticks / md->stats.frames / (COUNTS_PER_SECOND / 1000000)) : 0U,
+               md->blocks_x, md->blocks_y);
+    xil_printf("[INFO]   %u blocks on, %u boxes", md->active, md->box_count);
+    for(u32 i = 0; i < md->box_count; i++)
+        xil_printf(" ( %u, %u ) %u x %u", md->boxes[i].x, md->boxes[i].y, md->boxes[i].width, md->boxes[i].height);
+    xil_printf("\n");
+}
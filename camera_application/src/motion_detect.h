@@ -0,0 +1,103 @@
+#ifndef __MOTION_DETECT_H__
+#define __MOTION_DETECT_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "xiltimer.h"
+#include "pixel_convert.h"
+
+/*
+    Frame differencing against a low resolution luma reference, to tell static scenes from moving
+    ones before a frame is worth any more work. Every 4th line is converted to luma and reduced to
+    one sample per 4 pixels ( their mean ), so a VGA frame is a 160 x 120 sample map, read once.
+    Blocks of 2 x 2 samples ( 8 x 8 pixels, 80 x 60 of them at VGA ) then:
+
+    - accumulate their sum of absolute differences against the reference, NEON VABD / VPADAL,
+    - switch on above on_level and off below off_level ( mean difference per sample ), in between
+      they keep their state,
+    - move the reference towards the new samples by 1 / 2^adapt_shift, so lighting drift and
+      objects that stop moving fade into the background.
+
+    A frame has motion while at least min_blocks blocks are on, and for hold_frames after, so the
+    tail of a movement is not cut off. Connected blocks ( 8 neighbours ) give the bounding boxes,
+    the largest MOTION_DETECT_MAX_BOXES are kept. The first frame seeds the reference and counts
+    as motion.
+*/
+
+#define MOTION_DETECT_STEP      4U      // Pixels per sample, both ways
+#define MOTION_DETECT_BLOCK     2U      // Samples per block, both ways
+#define MOTION_DETECT_MAX_WIDTH 640U    // Widest frame, VGA
+#define MOTION_DETECT_MAX_HEIGHT 480U
+#define MOTION_DETECT_MAP_W     (MOTION_DETECT_MAX_WIDTH / MOTION_DETECT_STEP)
+#define MOTION_DETECT_MAP_H     (MOTION_DETECT_MAX_HEIGHT / MOTION_DETECT_STEP)
+#define MOTION_DETECT_BLOCKS_X  (MOTION_DETECT_MAP_W / MOTION_DETECT_BLOCK)
+#define MOTION_DETECT_BLOCKS_Y  (MOTION_DETECT_MAP_H / MOTION_DETECT_BLOCK)
+#define MOTION_DETECT_MAX_BOXES 8U
+
+typedef struct {
+    u8  on_level;        // Mean |difference| per sample that turns a block on
+    u8  off_level;       // ... and the one it has to drop below to turn off, <= on_level
+    u8  adapt_shift;     // Reference follows the scene by 1 / 2^adapt_shift per frame, 0 .. 7
+    u8  hold_frames;     // Frames still reported as motion after the last moving one
+    u16 min_blocks;      // Blocks on for a frame to have motion, >= 1
+} MotionDetectConfig;
+
+// Pixel rectangle around a group of touching blocks
+typedef struct {
+    u16 x;
+    u16 y;
+    u16 width;
+    u16 height;
+    u16 blocks;          // Blocks on inside
+} MotionDetectBox;
+
+typedef struct {
+    u32 frames;
+    u32 motion_frames;   // Frames reported as motion
+    u32 errors;          // Frames refused
+    u64 busy_ticks;      // Global timer ticks spent detecting
+} MotionDetectStats;
+
+typedef struct {
+    MotionDetectConfig cfg;
+    u16 blocks_x;                        // Grid of the last frame
+    u16 blocks_y;
+    u8  seeded;                          // Reference holds a frame of this size
+    u8  motion;                          // Result for the last frame
+    u8  hold;                            // Frames of hold_frames left
+    u16 active;                          // Blocks on in the last frame
+    u32 box_count;
+    MotionDetectBox boxes[MOTION_DETECT_MAX_BOXES];              // Largest first
+    u8  bitmap[MOTION_DETECT_BLOCKS_Y][MOTION_DETECT_BLOCKS_X / 8];  // 1 bit per block, LSB first
+    u8  ref[MOTION_DETECT_MAP_H][MOTION_DETECT_MAP_W];
+    u8  gray[MOTION_DETECT_MAX_WIDTH];   // Current line as luma
+    u8  samples[MOTION_DETECT_MAP_W];    // ... and reduced
+    u16 sad[MOTION_DETECT_BLOCKS_X];     // Block row being accumulated
+    u8  todo[MOTION_DETECT_BLOCKS_Y][MOTION_DETECT_BLOCKS_X / 8];    // Box search, blocks not reached yet
+    u16 stack[MOTION_DETECT_BLOCKS_X * MOTION_DETECT_BLOCKS_Y];
+    MotionDetectStats stats;
+} MotionDetect;
+
+// NULL cfg: on at a mean difference of 12, off below 6, reference at half speed, 4 frames hold,
+// 2 blocks
+int Motion_Detect_Init(MotionDetect *md, const MotionDetectConfig *cfg);
+
+// Measure a frame ( RGB565, RGB555, RGB888, YUYV, raw Bayer, gray or the luma of I420 ) against the
+// reference, result in md->motion, md->bitmap and md->boxes
+int Motion_Detect_Frame(MotionDetect *md, const PixImage *img);
+
+// TRUE when block ( bx, by ) of the last frame is on
+u32 Motion_Detect_Block(const MotionDetect *md, u32 bx, u32 by);
+
+// Luma line to one sample per MOTION_DETECT_STEP pixels, the rounded mean of the 4
+void Motion_Detect_Sample_Line(u8 *dst, const u8 *gray, u32 samples);
+void Motion_Detect_Sample_Line_C(u8 *dst, const u8 *gray, u32 samples);
+
+// |cur - ref| summed into sad[] per pair of samples, then ref moved towards cur. samples is even.
+void Motion_Detect_Sad_Line(u16 *sad, u8 *ref, const u8 *cur, u32 samples, u32 adapt_shift);
+void Motion_Detect_Sad_Line_C(u16 *sad, u8 *ref, const u8 *cur, u32 samples, u32 adapt_shift);
+
+void Motion_Detect_Print_Stats(const MotionDetect *md);
+
+#endif
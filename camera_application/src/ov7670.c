@@ -1,65 +1,339 @@
 #include <sleep.h>
+#include <string.h>
 #include <xgpio.h>
 #include <xstatus.h>
 
 #include "iic_helper.h"
 #include "ov7670.h"
 
-int OV7670_Init(OV7670* cam, IicCtrl* iic_ctrl, XGpio* gpio)
+// Format and clock setup applied after a software reset
+static const OV7670_RegSeq ov7670_basic_setup_seq[] = {
+    { REG_COM7,  REG_COM7_RGB_MODE,                         OV7670_SEQ_MASK_ALL, 0 }, // RGB output
+    { REG_COM15, REG_COM15_FULL_RANGE | REG_COM15_RGB565,   OV7670_SEQ_MASK_ALL, 0 }, // RGB565, full output range
+    { REG_CLKRC, REG_CLKRC_CLK_DIV_2,                       OV7670_SEQ_MASK_ALL, 0 }, // 24MHz XCLK / 2 = 12MHz internal clock
+};
+
+// Shadow cache bit helpers, one bit per register
+#define SHADOW_TEST(bits, reg)  ((bits)[(reg) >> 3] & (1U << ((reg) & 7)))
+#define SHADOW_SET(bits, reg)   ((bits)[(reg) >> 3] |= (u8)(1U << ((reg) & 7)))
+#define SHADOW_CLEAR(bits, reg) ((bits)[(reg) >> 3] &= (u8)~(1U << ((reg) & 7)))
+
+// Registers the sensor changes on its own must always be read from the bus
+static int OV7670_IsVolatile(u8 reg)
+{
+    switch(reg)
+    {
+        case REG_GAIN:
+        case REG_BLUE:
+        case REG_RED:
+        case REG_VREF:
+        case REG_COM1:
+        case REG_AECHH:
+        case REG_AECH:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+// Record a value that is now known to be in the sensor
+static void OV7670_Cache_Update(OV7670 *cam, u8 reg, u8 data)
+{
+    // A software reset puts every register back to its default
+    if((reg == REG_COM7) && (data & REG_COM7_RESET))
+    {
+        OV7670_Cache_Invalidate(cam);
+        return;
+    }
+
+    cam->shadow[reg] = data;
+    SHADOW_SET(cam->shadow_valid, reg);
+    SHADOW_CLEAR(cam->shadow_dirty, reg);
+}
+
+// Current register value, from the shadow when possible
+static int OV7670_Cache_Lookup(OV7670 *cam, u8 reg, u8 *buf)
+{
+    if(SHADOW_TEST(cam->shadow_valid, reg) && !OV7670_IsVolatile(reg))
+    {
+        *buf = cam->shadow[reg];
+        return XST_SUCCESS;
+    }
+
+    int status = Iic_Read(cam->iic_dev, reg, buf, 1);
+    if(status == XST_SUCCESS) OV7670_Cache_Update(cam, reg, *buf);
+    return status;
+}
+
+// Queue a register write on the next streaming slot, the slot's previous write must retire first
+static int OV7670_StreamWrite(OV7670 *cam, u8 reg, u8 data)
+{
+    IicTxn *txn = &cam->txn_ring[cam->txn_next];
+    u8 tx_buf[] = {reg, data};
+    int status;
+
+    cam->txn_next = (cam->txn_next + 1) % OV7670_TXN_SLOTS;
+
+    status = Iic_Txn_Wait(cam->iic_dev->bus, txn);
+    txn->status = XST_SUCCESS;
+    if(status != XST_SUCCESS) return status;
+
+    while((status = Iic_Queue_Write(cam->iic_dev, txn, tx_buf, 2, NULL, NULL)) == XST_DEVICE_BUSY)
+    {
+        Iic_Queue_Poll(cam->iic_dev->bus);
+    }
+    return status;
+}
+
+// Wait for every streamed write, the first failure is returned
+static int OV7670_StreamDrain(OV7670 *cam)
+{
+    int status = XST_SUCCESS;
+
+    for(int i = 0; i < OV7670_TXN_SLOTS; i++)
+    {
+        int slot_status = Iic_Txn_Wait(cam->iic_dev->bus, &cam->txn_ring[i]);
+        cam->txn_ring[i].status = XST_SUCCESS;
+        if(status == XST_SUCCESS) status = slot_status;
+    }
+    return status;
+}
+
+// Microseconds of global timer since start
+static u32 OV7670_ElapsedUs(XTime start)
+{
+    XTime now;
+    XTime_GetTime(&now);
+    return (u32)((now - start) / (COUNTS_PER_SECOND / 1000000));
+}
+
+// Poll the product ID until the sensor answers, bounded by OV7670_SCCB_READY_TIMEOUT_US
+static int OV7670_WaitForId(OV7670 *cam, u32 *polls)
+{
+    XTime t_start;
+    u8 pid, ver;
+
+    XTime_GetTime(&t_start);
+    while(1)
+    {
+        (*polls)++;
+        // Both ID bytes, a different part could happen to answer 0x76 at PID
+        if(OV7670_ReadReg_Uncached(cam, REG_PID, &pid) == XST_SUCCESS && pid == OV7670_PID_VALUE &&
+           OV7670_ReadReg_Uncached(cam, REG_VER, &ver) == XST_SUCCESS && ver == OV7670_VER_VALUE)
+        {
+            return XST_SUCCESS;
+        }
+        if(OV7670_ElapsedUs(t_start) > OV7670_SCCB_READY_TIMEOUT_US) return XST_TIMEOUT;
+        usleep(OV7670_POLL_INTERVAL_US);
+    }
+}
+
+int OV7670_Init(OV7670* cam, IicDevice* iic_dev, XGpio* gpio)
 {
     // Store pointers to IIC Control Structure & GPIO 
-    cam->iic_ctrl = iic_ctrl;
+    cam->iic_dev = iic_dev;
     cam->gpio = gpio;
+    OV7670_Cache_Invalidate(cam);
+
+    // Streaming slots start out idle
+    memset(cam->txn_ring, 0, sizeof(cam->txn_ring));
+    cam->txn_next = 0;
+    cam->profile = OV7670_PROFILE_NONE;
 
     // Set the data direction for both channels of the GPIO 
     XGpio_SetDataDirection(cam->gpio, 1, 0x00000000); // All outputs - this controls reset and pwdn for OV7670
     XGpio_SetDataDirection(cam->gpio, 2, 0xFFFFFFFF); // All inputs - check if the External Clock is locked for XCLK 0V7670
 
+    XTime t_phase;
+    int status;
+
+    memset(&cam->boot, 0, sizeof(cam->boot));
+    XTime_GetTime(&cam->boot.t_start);
+
     // PWDN Should be pulled down to enable Power
     /**
         RESET = 1 -> Normal Mode
         PWDN  = 0 -> Normal Mode
     */
+    XTime_GetTime(&t_phase);
     XGpio_DiscreteWrite(cam->gpio, 1, 0U); // Force everything low first
-    usleep(100000); // 100ms
+    usleep(OV7670_RESET_PULSE_US);          // Minimum RESET low time, the only fixed delay left
     XGpio_DiscreteWrite(cam->gpio, 1, 2U); // Power On and Release Reset
-    usleep(100000); // Wait for Camera to boot
-    
+    cam->boot.power_us = OV7670_ElapsedUs(t_phase);
+
     // Verify written values ( not necessary )
     u32 camera_control_state = XGpio_DiscreteRead(cam->gpio, 1);
     xil_printf("[DEBUG] Current Camera State, RESET: %d, PWDN: %d\n", (camera_control_state >> 1), ( camera_control_state & 1 ));
 
-    // Set up the Camera Controls
     // We need the XCLK to be up at 24MHz before starting IIC Communications
-    // u32 clock_locked_signal = XGpio_DiscreteRead(cam->gpio, 2);
-    // int timeout = 100;
-    // while ( ( clock_locked_signal != 1 ) && ( timeout > 0 ) )
-    // {
-    //     clock_locked_signal = XGpio_DiscreteRead(cam->gpio, 2);
-    //     timeout--;
-    //     usleep(100);
-    // }
-
-    // if( timeout == 0 )
-    // {
-    //     xil_printf("[ERROR] Timed out waiting for 24MHz XCLK Signal to be locked.\n");
-    //     return XST_FAILURE;
-    // }
-    // xil_printf("[DEBUG] XCLK (24MHz) clock locked signal: %d\n", clock_locked_signal);
-    usleep(100000);
+    XTime_GetTime(&t_phase);
+    while((XGpio_DiscreteRead(cam->gpio, 2) & 1U) == 0)
+    {
+        cam->boot.clock_polls++;
+        if(OV7670_ElapsedUs(t_phase) > OV7670_XCLK_LOCK_TIMEOUT_US)
+        {
+            xil_printf("[ERROR] Timed out waiting for 24MHz XCLK Signal to be locked.\n");
+            return XST_TIMEOUT;
+        }
+        usleep(OV7670_POLL_INTERVAL_US);
+    }
+    cam->boot.clock_lock_us = OV7670_ElapsedUs(t_phase);
+
+    // The sensor is ready as soon as it answers on SCCB with the right product ID
+    XTime_GetTime(&t_phase);
+    status = OV7670_WaitForId(cam, &cam->boot.sccb_polls);
+    cam->boot.sccb_ready_us = OV7670_ElapsedUs(t_phase);
+    if(status != XST_SUCCESS)
+    {
+        xil_printf("[ERROR] Timed out waiting for OV7670 to answer on SCCB.\n");
+        return status;
+    }
 
     return XST_SUCCESS;
 }
 
 int OV7670_ReadReg(OV7670 *cam, u8 reg, u8 *buf)
 {
-    return Iic_Read(cam->iic_ctrl, reg, buf, 1); // Assuming all registers are 1 byte
+    // Staged values are what the caller expects to see once flushed
+    if(SHADOW_TEST(cam->shadow_dirty, reg))
+    {
+        *buf = cam->shadow[reg];
+        return XST_SUCCESS;
+    }
+    return OV7670_Cache_Lookup(cam, reg, buf);
+}
+
+int OV7670_ReadReg_Uncached(OV7670 *cam, u8 reg, u8 *buf)
+{
+    int status = Iic_Read(cam->iic_dev, reg, buf, 1); // Assuming all registers are 1 byte
+    if(status == XST_SUCCESS && !SHADOW_TEST(cam->shadow_dirty, reg)) OV7670_Cache_Update(cam, reg, *buf);
+    return status;
 }
 
 int OV7670_WriteReg(OV7670 *cam, u8 reg, u8 data)
 {
     u8 tx_buf[] = {reg, data};
-    return Iic_Write(cam->iic_ctrl, tx_buf, 2); // Reg Addr, Data
+    int status = Iic_Write(cam->iic_dev, tx_buf, 2); // Reg Addr, Data
+    if(status == XST_SUCCESS) OV7670_Cache_Update(cam, reg, data);
+    return status;
+}
+
+void OV7670_Cache_Invalidate(OV7670 *cam)
+{
+    memset(cam->shadow_valid, 0, sizeof(cam->shadow_valid));
+    memset(cam->shadow_dirty, 0, sizeof(cam->shadow_dirty));
+}
+
+void OV7670_StageReg(OV7670 *cam, u8 reg, u8 data)
+{
+    cam->shadow[reg] = data;
+    SHADOW_SET(cam->shadow_dirty, reg);
+}
+
+int OV7670_Flush(OV7670 *cam)
+{
+    int status = XST_SUCCESS;
+
+    for(int reg = 0; reg < OV7670_NUM_REGS && status == XST_SUCCESS; reg++)
+    {
+        if(!SHADOW_TEST(cam->shadow_dirty, reg)) continue;
+
+        status = OV7670_StreamWrite(cam, (u8)reg, cam->shadow[reg]);
+        if(status == XST_SUCCESS) OV7670_Cache_Update(cam, (u8)reg, cam->shadow[reg]);
+    }
+
+    int drain_status = OV7670_StreamDrain(cam);
+    if(status == XST_SUCCESS) status = drain_status;
+
+    if(status != XST_SUCCESS)
+    {
+        xil_printf("[ERROR] Failed to flush staged registers, status: %d\n", status);
+        OV7670_Cache_Invalidate(cam); // Unknown which writes landed
+    }
+    return status;
+}
+
+int OV7670_ApplyProfile(OV7670 *cam, const OV7670_RegSeq *seq, int count)
+{
+    int status;
+
+    for(int i = 0; i < count; i++)
+    {
+        u8 current, target;
+
+        // Entries with a settling delay or a reset must go through the sequence path
+        if(seq[i].delay_us || (seq[i].reg == REG_COM7 && (seq[i].value & seq[i].mask & REG_COM7_RESET)))
+        {
+            status = OV7670_Flush(cam);
+            if(status == XST_SUCCESS) status = OV7670_WriteSequence(cam, &seq[i], 1);
+            if(status != XST_SUCCESS) return status;
+            continue;
+        }
+
+        status = OV7670_ReadReg(cam, seq[i].reg, &current);
+        if(status != XST_SUCCESS) return status;
+
+        target = (current & ~seq[i].mask) | (seq[i].value & seq[i].mask);
+        if(target != current || OV7670_IsVolatile(seq[i].reg))
+        {
+            OV7670_StageReg(cam, seq[i].reg, target);
+        }
+    }
+
+    return OV7670_Flush(cam);
+}
+
+int OV7670_WriteSequence(OV7670 *cam, const OV7670_RegSeq *seq, int count)
+{
+    int status = XST_SUCCESS, i;
+    XTime t_start, t_end;
+
+    XTime_GetTime(&t_start);
+
+    // Writes are queued back to back, the IIC interrupt chains them on the bus. Each one is still its
+    // own START / 3 byte phase / STOP: SCCB has no documented auto increment for the OV7670 and the
+    // tables are rarely consecutive, so runs are not merged into bursts.
+    for(i = 0; i < count; i++)
+    {
+        u8 value = seq[i].value;
+
+        // Partial updates need the current register contents, the read queues behind earlier writes
+        if(seq[i].mask != OV7670_SEQ_MASK_ALL)
+        {
+            u8 current;
+            status = OV7670_Cache_Lookup(cam, seq[i].reg, &current);
+            if(status != XST_SUCCESS) break;
+
+            value = (current & ~seq[i].mask) | (value & seq[i].mask);
+        }
+
+        status = OV7670_StreamWrite(cam, seq[i].reg, value);
+        if(status != XST_SUCCESS) break;
+        OV7670_Cache_Update(cam, seq[i].reg, value);
+
+        // Settling time counts from when the write is on the sensor
+        if(seq[i].delay_us)
+        {
+            status = OV7670_StreamDrain(cam);
+            if(status != XST_SUCCESS) break;
+            usleep(seq[i].delay_us);
+        }
+    }
+
+    int drain_status = OV7670_StreamDrain(cam);
+    if(status == XST_SUCCESS) status = drain_status;
+
+    if(status != XST_SUCCESS)
+    {
+        xil_printf("[ERROR] Register sequence failed near entry %d, status: %d\n", i, status);
+        OV7670_Cache_Invalidate(cam); // Unknown which writes landed
+        return status;
+    }
+
+    XTime_GetTime(&t_end);
+    cam->seq_time = t_end - t_start;
+
+    return XST_SUCCESS;
 }
 
 int OV7670_Reg_ReadWrite_Test(OV7670 *cam)
@@ -87,7 +361,7 @@ int OV7670_Reg_ReadWrite_Test(OV7670 *cam)
     // At this point, we know that the read functionality is working
     // Simple Write Test, read the blue reg, update its value, read it again, revert back to original
     u8 new_value = 0x79, original_value;
-    OV7670_ReadReg(cam, REG_BLUE, &rx_buf);
+    OV7670_ReadReg_Uncached(cam, REG_BLUE, &rx_buf);
     xil_printf("[DEBUG] Write Self Test, Reg 0x%02X: 0x%02X\n", REG_BLUE, rx_buf);
     original_value = rx_buf;
 
@@ -99,8 +373,8 @@ int OV7670_Reg_ReadWrite_Test(OV7670 *cam)
         return status;
     }
 
-    // Verify that update is successfull
-    OV7670_ReadReg(cam, REG_BLUE, &rx_buf);
+    // Verify that update is successfull, straight from the sensor
+    OV7670_ReadReg_Uncached(cam, REG_BLUE, &rx_buf);
     xil_printf("[DEBUG] Write Self Test, Reg 0x%02X: 0x%02X, Expected: 0x%02X\n", REG_BLUE, rx_buf, new_value);
     if( rx_buf != new_value )
     {
@@ -131,36 +405,49 @@ int OV7670_Reset(OV7670 *cam)
 
     if (status != XST_SUCCESS) {
         // If it NACKs here, we must clear the IIC controller state
-        XIic_Reset(&cam->iic_ctrl->iic_instance);
-        XIic_SetAddress(&cam->iic_ctrl->iic_instance, XII_ADDR_TO_SEND_TYPE, cam->iic_ctrl->iic_device_addr);
+        Iic_Recover(cam->iic_dev->bus);
     }
 
-    // CRITICAL: The camera needs time to clear internal registers
-    // 50ms is a safe "boot" time for this sensor
-    usleep(50000);
+    // The reset may have landed even without an ACK, drop everything cached
+    OV7670_Cache_Invalidate(cam);
+    cam->profile = OV7670_PROFILE_NONE;
+
+    // The camera needs time to clear internal registers, it NACKs until it is back
+    XTime t_phase;
+    XTime_GetTime(&t_phase);
+    status = OV7670_WaitForId(cam, &cam->boot.reset_polls);
+    cam->boot.reset_us = OV7670_ElapsedUs(t_phase);
+    cam->boot.total_us = OV7670_ElapsedUs(cam->boot.t_start);
+    if(status != XST_SUCCESS)
+    {
+        xil_printf("[ERROR] OV7670 did not come back after software reset.\n");
+        return status;
+    }
 
     return XST_SUCCESS;
 }
 
+void OV7670_Print_Startup_Report(OV7670 *cam)
+{
+    xil_printf("[INFO] OV7670 startup report\n");
+    xil_printf("[INFO]   Power / reset pulse : %u us\n", cam->boot.power_us);
+    xil_printf("[INFO]   XCLK lock           : %u us ( %u polls )\n", cam->boot.clock_lock_us, cam->boot.clock_polls);
+    xil_printf("[INFO]   SCCB ready          : %u us ( %u polls )\n", cam->boot.sccb_ready_us, cam->boot.sccb_polls);
+    xil_printf("[INFO]   Software reset      : %u us ( %u polls )\n", cam->boot.reset_us, cam->boot.reset_polls);
+    xil_printf("[INFO]   Camera ready        : %u us, budget %u us\n", cam->boot.total_us, OV7670_BOOT_BUDGET_US);
+
+    if(cam->boot.total_us > OV7670_BOOT_BUDGET_US)
+    {
+        xil_printf("[WARNING] OV7670 startup exceeded its boot-time budget!\n");
+    }
+}
+
 int OV7670_Basic_Setup(OV7670 *cam)
 {
     // Reset first
     int status = OV7670_Reset(cam);
-
-    // Set the color format to RGB - using the COM7 Register
-    status = OV7670_WriteReg(cam, REG_COM7, REG_COM7_RGB_MODE);
     if(status != XST_SUCCESS) return status;
 
-    // Set the output format to RGB565 and color range to full
-    status = OV7670_WriteReg(cam, REG_COM15, REG_COM15_RGB555_FULL_RANGE);
-    if(status != XST_SUCCESS) return status;
-
-    // We are providing 24MHz as XCLK
-    // Need a stable internal clock, so using 12MHz
-    status = OV7670_WriteReg(cam, REG_CLKRC, REG_CLKRC_CLK_DIV_2);
-    if(status != XST_SUCCESS) return status;
-
-    return XST_SUCCESS;
+    // RGB output format and internal clock, see ov7670_basic_setup_seq
+    return OV7670_WriteSequence(cam, ov7670_basic_setup_seq, OV7670_SEQ_LEN(ov7670_basic_setup_seq));
 }
-
-
@@ -4,6 +4,7 @@
 #include "iic_helper.h"
 #include "xil_printf.h"
 #include "xgpio.h"
+#include "xiltimer.h"
 
 // Register Addresses
 #define REG_PID     0x0A // Product ID - High ( expected 0x76 ) - R
@@ -15,32 +16,152 @@
 #define REG_COM7    0x12 // Common Control 7             - R/W
 #define REG_COM15   0x40 // Common Control 15 - Output Format - R/W
 
+// Windowing, scaling and output format registers used by the profiles
+#define REG_COM3          0x0C // Common Control 3 - Scale / DCW Enable  - R/W
+#define REG_COM9          0x14 // Common Control 9 - AGC Ceiling         - R/W
+#define REG_HSTART        0x17 // Horizontal Frame Start [10:3]          - R/W
+#define REG_HSTOP         0x18 // Horizontal Frame Stop [10:3]           - R/W
+#define REG_VSTART        0x19 // Vertical Frame Start [9:2]             - R/W
+#define REG_VSTOP         0x1A // Vertical Frame Stop [9:2]              - R/W
+#define REG_HREF          0x32 // HREF Control, HSTART/HSTOP [2:0]        - R/W
+#define REG_TSLB          0x3A // Line Buffer Test Option                - R/W
+#define REG_COM13         0x3D // Common Control 13 - Gamma / UV Saturation - R/W
+#define REG_COM14         0x3E // Common Control 14 - PCLK Divider / Manual Scaling - R/W
+#define REG_COM16         0x41 // Common Control 16 - Edge / Denoise Auto Adjust - R/W
+#define REG_MTX1          0x4F // Color Matrix Coefficient 1, MTX2..MTX6 follow - R/W
+#define REG_MTX2          0x50
+#define REG_MTX3          0x51
+#define REG_MTX4          0x52
+#define REG_MTX5          0x53
+#define REG_MTX6          0x54
+#define REG_SCALING_XSC   0x70 // Horizontal Scale Factor                - R/W
+#define REG_SCALING_YSC   0x71 // Vertical Scale Factor                  - R/W
+#define REG_SCALING_DCW   0x72 // DCW Down Sample Control                - R/W
+#define REG_SCALING_PCLK  0x73 // DSP Scale Clock Divider                - R/W
+#define REG_RGB444        0x8C // RGB444 Output Control                  - R/W
+#define REG_PCLK_DELAY    0xA2 // Scaling Pixel Clock Delay              - R/W
+
+// Registers updated by the sensor's own AEC/AGC/AWB loops, never served from the shadow cache
+#define REG_GAIN    0x00 // AGC Gain Control [7:0]        - R/W
+#define REG_RED     0x02 // Red Channel Gain Setting      - R/W
+#define REG_VREF    0x03 // Vertical Frame Control, AGC[9:8] - R/W
+#define REG_COM1    0x04 // Common Control 1, AEC[1:0]    - R/W
+#define REG_AECHH   0x07 // Exposure Value - AEC[15:10]   - R/W
+#define REG_AECH    0x10 // Exposure Value - AEC[9:2]     - R/W
+
+// Enables of those loops, cleared when software takes over exposure / gain / white balance
+#define REG_COM8    0x13 // Common Control 8 - AEC / AGC / AWB Enable - R/W
+
 // Register Controls
 #define REG_COM7_RESET              (u8)0x80
 #define REG_COM7_RGB_MODE           (u8)0x04
-#define REG_COM15_RGB555_FULL_RANGE (u8)0xD0
 #define REG_CLKRC_CLK_DIV_2         (u8)0x01
+#define REG_COM7_BAYER_RAW          (u8)0x01
+#define REG_COM7_QCIF               (u8)0x08
+#define REG_COM7_QVGA               (u8)0x10
+#define REG_COM7_CIF                (u8)0x20
+#define REG_COM15_FULL_RANGE        (u8)0xC0
+#define REG_COM15_RGB565            (u8)0x10
+#define REG_COM15_RGB555            (u8)0x30
+#define REG_COM8_AEC_EN             (u8)0x01
+#define REG_COM8_AWB_EN             (u8)0x02
+#define REG_COM8_AGC_EN             (u8)0x04
+
+// No profile applied since the last reset, see ov7670_profiles.h
+#define OV7670_PROFILE_NONE (-1)
+
+// Expected product ID, both bytes polled to detect that the sensor is up
+#define OV7670_PID_VALUE (u8)0x76
+#define OV7670_VER_VALUE (u8)0x73
+
+// Bring-up timing, all bounds in microseconds
+#define OV7670_RESET_PULSE_US        1000    // RESET / PWDN held low at power on
+#define OV7670_POLL_INTERVAL_US      200     // Gap between readiness polls
+#define OV7670_XCLK_LOCK_TIMEOUT_US  100000  // Clock wizard lock on GPIO channel 2
+#define OV7670_SCCB_READY_TIMEOUT_US 300000  // Sensor answering SCCB after power on or reset
+#define OV7670_BOOT_BUDGET_US        50000   // Target camera-ready time, reported against
+
+// Per-phase timings of the last bring-up, filled by OV7670_Init and OV7670_Reset
+typedef struct {
+    XTime t_start;      // Global timer at the start of OV7670_Init
+    u32 power_us;       // Power / reset pulse
+    u32 clock_lock_us;  // Waiting for XCLK lock
+    u32 clock_polls;
+    u32 sccb_ready_us;  // Waiting for the first good PID read
+    u32 sccb_polls;
+    u32 reset_us;       // Software reset until the sensor answers again
+    u32 reset_polls;
+    u32 total_us;       // OV7670_Init start to the end of the last reset
+} OV7670_StartupReport;
 
 // IIC Address for the OV7670 - 7 bit
 #define OV7670_IIC_ADDR (u8)0x21 
 
+// Register sequence entry, setup and mode switches are described as arrays of these
+typedef struct {
+    u8  reg;      // Register address
+    u8  value;    // Value to write, only the bits set in mask are used
+    u8  mask;     // Bits to update, OV7670_SEQ_MASK_ALL skips the read-modify-write
+    u16 delay_us; // Settling time after the write, 0 for none
+} OV7670_RegSeq;
+
+#define OV7670_SEQ_MASK_ALL (u8)0xFF
+#define OV7670_SEQ_LEN(seq) ((int)(sizeof(seq) / sizeof((seq)[0])))
+
+// Size of the sensor register address space held in the shadow cache
+#define OV7670_NUM_REGS 256
+
+// Register writes kept in flight on the IIC queue while streaming a sequence
+#define OV7670_TXN_SLOTS 8
+
 // Define the device structure
 typedef struct {
-    IicCtrl* iic_ctrl; // Pointer to IIC Helper Instance
+    IicDevice* iic_dev; // Camera's handle on the shared IIC controller
     XGpio*   gpio;     // Pointer to Dual Channel GPIO - RESET, PWDN, XCLK Locked Signals
+    XTime    seq_time; // Global timer ticks taken by the last OV7670_WriteSequence
+
+    // Shadow copy of the sensor register file, one valid / dirty bit per register
+    u8 shadow[OV7670_NUM_REGS];
+    u8 shadow_valid[OV7670_NUM_REGS / 8]; // Shadow holds the value last read or written on the bus
+    u8 shadow_dirty[OV7670_NUM_REGS / 8]; // Shadow holds a staged value not yet written to the sensor
+
+    // Queued writes for sequences and flushes, reused round robin
+    IicTxn txn_ring[OV7670_TXN_SLOTS];
+    int    txn_next;
+
+    int profile; // Active resolution/format profile, OV7670_PROFILE_NONE when unknown
+
+    OV7670_StartupReport boot;
 } OV7670;
 
 // API Prototypes
-int OV7670_Init(OV7670* cam, IicCtrl* iic_ctrl, XGpio* gpio);
+int OV7670_Init(OV7670* cam, IicDevice* iic_dev, XGpio* gpio);
 int OV7670_ReadReg(OV7670* cam, u8 reg, u8 *buf);
 int OV7670_WriteReg(OV7670* cam, u8 reg, u8 data);
 
+// Bypass the shadow cache and read the register over the bus
+int OV7670_ReadReg_Uncached(OV7670* cam, u8 reg, u8 *buf);
+
+// Stream a register sequence to the sensor in one pass
+int OV7670_WriteSequence(OV7670* cam, const OV7670_RegSeq* seq, int count);
+
+// Shadow cache control
+void OV7670_Cache_Invalidate(OV7670* cam);                // Forget all cached and staged values
+void OV7670_StageReg(OV7670* cam, u8 reg, u8 data);       // Update the shadow only, written on the next flush
+int  OV7670_Flush(OV7670* cam);                           // Write all staged registers in one batch
+
+// Write only the registers of a target profile that differ from the current sensor state
+int OV7670_ApplyProfile(OV7670* cam, const OV7670_RegSeq* seq, int count);
+
 // Self-Test 
 int OV7670_Reg_ReadWrite_Test(OV7670* cam);
 
 // Software Reset
 int OV7670_Reset(OV7670* cam);
 
+// Print the per-phase bring-up timings
+void OV7670_Print_Startup_Report(OV7670* cam);
+
 // Basic Setup
 int OV7670_Basic_Setup(OV7670* cam);
 
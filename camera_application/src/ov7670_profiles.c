@@ -0,0 +1,271 @@
+#include <xstatus.h>
+
+#include "ov7670.h"
+#include "ov7670_profiles.h"
+
+#define PROFILE_FMT_REGS 14 // Entries contributed by the format part of a profile
+#define PROFILE_RES_REGS 13 // Entries contributed by the resolution part of a profile
+
+// Format specific registers, COM7 carries only the format bits here ( resolution bits are OR'ed in )
+static const OV7670_RegSeq format_regs[OV7670_FMT_COUNT][PROFILE_FMT_REGS] = {
+    [OV7670_FMT_RGB565] = {
+        { REG_COM7,   REG_COM7_RGB_MODE,                       OV7670_SEQ_MASK_ALL, 0 },
+        { REG_RGB444, 0x00,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM1,   0x00,                                    0x40,                0 }, // CCIR656 off, AEC[1:0] untouched
+        { REG_COM15,  REG_COM15_FULL_RANGE | REG_COM15_RGB565, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM9,   0x38,                                    OV7670_SEQ_MASK_ALL, 0 }, // 16x gain ceiling
+        { REG_MTX1,   0xB3,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX2,   0xB3,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX3,   0x00,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX4,   0x3D,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX5,   0xA7,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX6,   0xE4,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM13,  0xC0,                                    OV7670_SEQ_MASK_ALL, 0 }, // Gamma, UV saturation auto adjust
+        { REG_COM16,  0x08,                                    OV7670_SEQ_MASK_ALL, 0 }, // AWB gain enable
+        { REG_TSLB,   0x04,                                    OV7670_SEQ_MASK_ALL, 0 },
+    },
+    [OV7670_FMT_RGB555] = {
+        { REG_COM7,   REG_COM7_RGB_MODE,                       OV7670_SEQ_MASK_ALL, 0 },
+        { REG_RGB444, 0x00,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM1,   0x00,                                    0x40,                0 },
+        { REG_COM15,  REG_COM15_FULL_RANGE | REG_COM15_RGB555, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM9,   0x38,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX1,   0xB3,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX2,   0xB3,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX3,   0x00,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX4,   0x3D,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX5,   0xA7,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX6,   0xE4,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM13,  0xC0,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM16,  0x08,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_TSLB,   0x04,                                    OV7670_SEQ_MASK_ALL, 0 },
+    },
+    [OV7670_FMT_YUV422] = {
+        { REG_COM7,   0x00,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_RGB444, 0x00,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM1,   0x00,                                    0x40,                0 },
+        { REG_COM15,  REG_COM15_FULL_RANGE,                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM9,   0x48,                                    OV7670_SEQ_MASK_ALL, 0 }, // 32x gain ceiling
+        { REG_MTX1,   0x80,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX2,   0x80,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX3,   0x00,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX4,   0x22,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX5,   0x5E,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX6,   0x80,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM13,  0xC0,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM16,  0x08,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_TSLB,   0x04,                                    OV7670_SEQ_MASK_ALL, 0 }, // YUYV order
+    },
+    [OV7670_FMT_BAYER_RAW] = {
+        { REG_COM7,   REG_COM7_BAYER_RAW,                      OV7670_SEQ_MASK_ALL, 0 },
+        { REG_RGB444, 0x00,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM1,   0x00,                                    0x40,                0 },
+        { REG_COM15,  REG_COM15_FULL_RANGE,                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM9,   0x48,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX1,   0x80,                                    OV7670_SEQ_MASK_ALL, 0 }, // Matrix unused on raw output
+        { REG_MTX2,   0x80,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX3,   0x00,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX4,   0x22,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX5,   0x5E,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_MTX6,   0x80,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM13,  0x08,                                    OV7670_SEQ_MASK_ALL, 0 }, // No gamma on raw data
+        { REG_COM16,  0x3D,                                    OV7670_SEQ_MASK_ALL, 0 },
+        { REG_TSLB,   0x04,                                    OV7670_SEQ_MASK_ALL, 0 },
+    },
+};
+
+// COM7 resolution bits per frame size
+static const u8 resolution_com7[OV7670_RES_COUNT] = {
+    [OV7670_RES_VGA]   = 0x00,
+    [OV7670_RES_QVGA]  = REG_COM7_QVGA,
+    [OV7670_RES_QQVGA] = 0x00,          // VGA window, DCW down samples by 4
+    [OV7670_RES_CIF]   = REG_COM7_CIF,
+};
+
+// Windowing, scaling and clock registers per frame size
+static const OV7670_RegSeq resolution_regs[OV7670_RES_COUNT][PROFILE_RES_REGS] = {
+    [OV7670_RES_VGA] = {
+        { REG_HSTART,       0x13, OV7670_SEQ_MASK_ALL, 0 }, // HSTART 158
+        { REG_HSTOP,        0x01, OV7670_SEQ_MASK_ALL, 0 }, // HSTOP 14
+        { REG_HREF,         0xB6, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_VSTART,       0x02, OV7670_SEQ_MASK_ALL, 0 }, // VSTART 10
+        { REG_VSTOP,        0x7A, OV7670_SEQ_MASK_ALL, 0 }, // VSTOP 490
+        { REG_VREF,         0x0A, 0x0F,                0 }, // AGC[9:8] untouched
+        { REG_COM3,         0x00, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM14,        0x00, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_SCALING_XSC,  0x3A, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_SCALING_YSC,  0x35, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_SCALING_DCW,  0x11, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_SCALING_PCLK, 0xF0, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_PCLK_DELAY,   0x02, OV7670_SEQ_MASK_ALL, 0 },
+    },
+    [OV7670_RES_QVGA] = {
+        { REG_HSTART,       0x15, OV7670_SEQ_MASK_ALL, 0 }, // HSTART 168
+        { REG_HSTOP,        0x03, OV7670_SEQ_MASK_ALL, 0 }, // HSTOP 24
+        { REG_HREF,         0x80, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_VSTART,       0x03, OV7670_SEQ_MASK_ALL, 0 }, // VSTART 12
+        { REG_VSTOP,        0x7B, OV7670_SEQ_MASK_ALL, 0 }, // VSTOP 492
+        { REG_VREF,         0x00, 0x0F,                0 },
+        { REG_COM3,         0x04, OV7670_SEQ_MASK_ALL, 0 }, // DCW enable
+        { REG_COM14,        0x19, OV7670_SEQ_MASK_ALL, 0 }, // Manual scaling, PCLK / 2
+        { REG_SCALING_XSC,  0x3A, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_SCALING_YSC,  0x35, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_SCALING_DCW,  0x11, OV7670_SEQ_MASK_ALL, 0 }, // Down sample by 2
+        { REG_SCALING_PCLK, 0xF1, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_PCLK_DELAY,   0x02, OV7670_SEQ_MASK_ALL, 0 },
+    },
+    [OV7670_RES_QQVGA] = {
+        { REG_HSTART,       0x15, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_HSTOP,        0x03, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_HREF,         0x80, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_VSTART,       0x03, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_VSTOP,        0x7B, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_VREF,         0x00, 0x0F,                0 },
+        { REG_COM3,         0x04, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_COM14,        0x1A, OV7670_SEQ_MASK_ALL, 0 }, // Manual scaling, PCLK / 4
+        { REG_SCALING_XSC,  0x3A, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_SCALING_YSC,  0x35, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_SCALING_DCW,  0x22, OV7670_SEQ_MASK_ALL, 0 }, // Down sample by 4
+        { REG_SCALING_PCLK, 0xF2, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_PCLK_DELAY,   0x02, OV7670_SEQ_MASK_ALL, 0 },
+    },
+    [OV7670_RES_CIF] = {
+        { REG_HSTART,       0x15, OV7670_SEQ_MASK_ALL, 0 }, // HSTART 170
+        { REG_HSTOP,        0x0B, OV7670_SEQ_MASK_ALL, 0 }, // HSTOP 90
+        { REG_HREF,         0x92, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_VSTART,       0x03, OV7670_SEQ_MASK_ALL, 0 }, // VSTART 14
+        { REG_VSTOP,        0x7B, OV7670_SEQ_MASK_ALL, 0 }, // VSTOP 494
+        { REG_VREF,         0x0A, 0x0F,                0 },
+        { REG_COM3,         0x0C, OV7670_SEQ_MASK_ALL, 0 }, // Scale and DCW enable
+        { REG_COM14,        0x11, OV7670_SEQ_MASK_ALL, 0 }, // DCW / scaling PCLK, no divide
+        { REG_SCALING_XSC,  0x3A, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_SCALING_YSC,  0x35, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_SCALING_DCW,  0x11, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_SCALING_PCLK, 0xF1, OV7670_SEQ_MASK_ALL, 0 },
+        { REG_PCLK_DELAY,   0x02, OV7670_SEQ_MASK_ALL, 0 },
+    },
+};
+
+static const u16 resolution_size[OV7670_RES_COUNT][2] = {
+    [OV7670_RES_VGA]   = { 640, 480 },
+    [OV7670_RES_QVGA]  = { 320, 240 },
+    [OV7670_RES_QQVGA] = { 160, 120 },
+    [OV7670_RES_CIF]   = { 352, 288 },
+};
+
+// Built by OV7670_Profiles_Init
+typedef struct {
+    OV7670_RegSeq regs[OV7670_PROFILE_REGS];
+    int count;
+} ProfileScript;
+
+static ProfileScript profiles[OV7670_PROFILE_COUNT];
+static ProfileScript transitions[OV7670_PROFILE_COUNT][OV7670_PROFILE_COUNT];
+static int profiles_ready = FALSE;
+
+void OV7670_Profiles_Init(void)
+{
+    // Full profiles: format registers, resolution registers, internal clock last
+    for(int res = 0; res < OV7670_RES_COUNT; res++)
+    {
+        for(int fmt = 0; fmt < OV7670_FMT_COUNT; fmt++)
+        {
+            ProfileScript *p = &profiles[OV7670_PROFILE_ID(res, fmt)];
+            int n = 0;
+
+            for(int i = 0; i < PROFILE_FMT_REGS; i++) p->regs[n++] = format_regs[fmt][i];
+            p->regs[0].value |= resolution_com7[res];
+
+            for(int i = 0; i < PROFILE_RES_REGS; i++) p->regs[n++] = resolution_regs[res][i];
+
+            p->regs[n++] = (OV7670_RegSeq){ REG_CLKRC, REG_CLKRC_CLK_DIV_2, OV7670_SEQ_MASK_ALL, 0 };
+            p->count = n;
+        }
+    }
+
+    // Transitions keep only the entries whose value or mask differ
+    for(int from = 0; from < OV7670_PROFILE_COUNT; from++)
+    {
+        for(int to = 0; to < OV7670_PROFILE_COUNT; to++)
+        {
+            ProfileScript *t = &transitions[from][to];
+            t->count = 0;
+
+            for(int i = 0; i < OV7670_PROFILE_REGS; i++)
+            {
+                const OV7670_RegSeq *a = &profiles[from].regs[i];
+                const OV7670_RegSeq *b = &profiles[to].regs[i];
+
+                if((a->value & a->mask) != (b->value & b->mask) || a->mask != b->mask)
+                {
+                    t->regs[t->count++] = *b;
+                }
+            }
+        }
+    }
+
+    profiles_ready = TRUE;
+}
+
+const OV7670_RegSeq* OV7670_Profile_Get(int profile, int *count)
+{
+    if(!profiles_ready || profile < 0 || profile >= OV7670_PROFILE_COUNT) return NULL;
+
+    *count = profiles[profile].count;
+    return profiles[profile].regs;
+}
+
+const OV7670_RegSeq* OV7670_Profile_Transition(int from, int to, int *count)
+{
+    if(!profiles_ready || from < 0 || from >= OV7670_PROFILE_COUNT || to < 0 || to >= OV7670_PROFILE_COUNT) return NULL;
+
+    *count = transitions[from][to].count;
+    return transitions[from][to].regs;
+}
+
+OV7670_FrameInfo OV7670_Profile_FrameInfo(OV7670_Resolution res, OV7670_Format fmt)
+{
+    OV7670_FrameInfo info = { 0 };
+
+    if(res >= OV7670_RES_COUNT || fmt >= OV7670_FMT_COUNT) return info;
+
+    info.width = resolution_size[res][0];
+    info.height = resolution_size[res][1];
+    info.bytes_per_pixel = (fmt == OV7670_FMT_BAYER_RAW) ? 1 : 2;
+
+    return info;
+}
+
+int OV7670_SetProfile(OV7670 *cam, OV7670_Resolution res, OV7670_Format fmt)
+{
+    const OV7670_RegSeq *seq;
+    int count = 0, status;
+    int target = OV7670_PROFILE_ID(res, fmt);
+
+    if(res >= OV7670_RES_COUNT || fmt >= OV7670_FMT_COUNT) return XST_INVALID_PARAM;
+    if(!profiles_ready) OV7670_Profiles_Init();
+
+    if(cam->profile == OV7670_PROFILE_NONE)
+    {
+        seq = OV7670_Profile_Get(target, &count);
+    }
+    else
+    {
+        seq = OV7670_Profile_Transition(cam->profile, target, &count);
+    }
+    if(seq == NULL)
+    {
+        xil_printf("[ERROR] No register profile for resolution %d, format %d\n", res, fmt);
+        return XST_FAILURE;
+    }
+
+    status = OV7670_WriteSequence(cam, seq, count);
+    if(status != XST_SUCCESS)
+    {
+        cam->profile = OV7670_PROFILE_NONE; // Partially applied, next switch writes the full profile
+        return status;
+    }
+
+    cam->profile = target;
+    return XST_SUCCESS;
+}
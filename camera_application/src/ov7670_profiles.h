@@ -0,0 +1,53 @@
+#ifndef __OV7670_PROFILES_H__
+#define __OV7670_PROFILES_H__
+
+#include "ov7670.h"
+
+// Output frame sizes
+typedef enum {
+    OV7670_RES_VGA,     // 640 x 480
+    OV7670_RES_QVGA,    // 320 x 240
+    OV7670_RES_QQVGA,   // 160 x 120
+    OV7670_RES_CIF,     // 352 x 288
+    OV7670_RES_COUNT
+} OV7670_Resolution;
+
+// Output pixel formats
+typedef enum {
+    OV7670_FMT_RGB565,
+    OV7670_FMT_RGB555,
+    OV7670_FMT_YUV422,    // YUYV byte order
+    OV7670_FMT_BAYER_RAW, // 8 bit BGGR mosaic, meaningful at VGA only, the DCW scaler mixes colour sites
+    OV7670_FMT_COUNT
+} OV7670_Format;
+
+#define OV7670_PROFILE_COUNT        (OV7670_RES_COUNT * OV7670_FMT_COUNT)
+#define OV7670_PROFILE_ID(res, fmt) ((int)(res) * OV7670_FMT_COUNT + (int)(fmt))
+
+// Every profile writes the same registers in the same order, so two profiles can be diffed entry by entry
+#define OV7670_PROFILE_REGS 28
+
+// Geometry of a profile's output frames
+typedef struct {
+    u16 width;
+    u16 height;
+    u8  bytes_per_pixel;
+} OV7670_FrameInfo;
+
+// Build the profile and transition tables, call once before OV7670_SetProfile
+void OV7670_Profiles_Init(void);
+
+// Full register sequence for a profile
+const OV7670_RegSeq* OV7670_Profile_Get(int profile, int *count);
+
+// Registers that differ between two profiles, in profile write order
+const OV7670_RegSeq* OV7670_Profile_Transition(int from, int to, int *count);
+
+// Frame geometry produced by a profile, all zero for an unknown resolution or format
+OV7670_FrameInfo OV7670_Profile_FrameInfo(OV7670_Resolution res, OV7670_Format fmt);
+
+// Switch the sensor to a profile, only the transition delta is written when the current profile is known.
+// Registers written outside the profile API since the last switch are not tracked.
+int OV7670_SetProfile(OV7670* cam, OV7670_Resolution res, OV7670_Format fmt);
+
+#endif
@@ -0,0 +1,535 @@
+#include "pixel_convert.h"
+#include "ov7670_profiles.h"
+#include <string.h>
+
+#ifdef PIX_NEON
+#include <arm_neon.h>
+#endif
+
+// Full range BT.601 YUV -> RGB in Q6, small enough for 16 bit lanes: 113 * 127 + 255 * 64 < 32768
+#define PIX_YUV_SHIFT 6
+#define PIX_YUV_RV    90   // 1.402
+#define PIX_YUV_GU    22   // 0.344
+#define PIX_YUV_GV    46   // 0.714
+#define PIX_YUV_BU    113  // 1.772
+
+// Luma weights in Q8, they sum to 256
+#define PIX_LUMA_R    77
+#define PIX_LUMA_G    150
+#define PIX_LUMA_B    29
+#define PIX_LUMA_G2   75   // Each of the two greens of a Bayer quad
+
+#define PIX_PREFETCH  128  // Bytes ahead of the source loads
+
+#define PIX_PAIR(from, to)      ((u32)(from) * PIX_FMT_COUNT + (u32)(to))
+#define PIX_LINE(img, plane, y) ((img)->planes[plane] + (u32)(y) * (img)->strides[plane])
+
+// 5 and 6 bit channels to 8 bits, the top bits are repeated so full scale maps to 255
+#define PIX_EXPAND5(x) (((x) << 3) | ((x) >> 2))
+#define PIX_EXPAND6(x) (((x) << 2) | ((x) >> 4))
+
+static inline u8 Pix_Luma(u32 r, u32 g, u32 b)
+{
+    return (u8)((PIX_LUMA_R * r + PIX_LUMA_G * g + PIX_LUMA_B * b + 128U) >> 8);
+}
+
+static inline u8 Pix_Clamp(s32 x)
+{
+    return (u8)(x < 0 ? 0 : (x > 255 ? 255 : x));
+}
+
+// One channel of a YUV -> RGB pixel, chroma term already scaled
+static inline u8 Pix_Yuv_Channel(u32 y, s32 chroma)
+{
+    return Pix_Clamp(((s32)(y << PIX_YUV_SHIFT) + chroma + (1 << (PIX_YUV_SHIFT - 1))) >> PIX_YUV_SHIFT);
+}
+
+// --------------------------------------- Scalar references ------------------------------------------
+
+void Pix_Rgb565ToRgb888_Line_C(u8 *dst, const u16 *src, u32 pixels)
+{
+    for(u32 i = 0; i < pixels; i++)
+    {
+        u32 p = src[i];
+        u32 r = (p >> 11) & 0x1FU, g = (p >> 5) & 0x3FU, b = p & 0x1FU;
+
+        dst[3 * i + 0] = (u8)PIX_EXPAND5(r);
+        dst[3 * i + 1] = (u8)PIX_EXPAND6(g);
+        dst[3 * i + 2] = (u8)PIX_EXPAND5(b);
+    }
+}
+
+void Pix_Rgb888ToRgb565_Line_C(u16 *dst, const u8 *src, u32 pixels)
+{
+    for(u32 i = 0; i < pixels; i++)
+    {
+        const u8 *p = src + 3 * i;
+        dst[i] = (u16)(((u32)(p[0] >> 3) << 11) | ((u32)(p[1] >> 2) << 5) | (u32)(p[2] >> 3));
+    }
+}
+
+void Pix_Rgb555ToRgb565_Line_C(u16 *dst, const u16 *src, u32 pixels)
+{
+    for(u32 i = 0; i < pixels; i++)
+    {
+        u32 p = src[i];
+        u32 g = (p >> 5) & 0x1FU;
+
+        dst[i] = (u16)(((p & 0x7C00U) << 1) | (((g << 1) | (g >> 4)) << 5) | (p & 0x1FU));
+    }
+}
+
+void Pix_YuyvToRgb888_Line_C(u8 *dst, const u8 *src, u32 pixels)
+{
+    for(u32 i = 0; i + 1 < pixels; i += 2, src += 4, dst += 6)
+    {
+        s32 u = (s32)src[1] - 128, v = (s32)src[3] - 128;
+        s32 rv = PIX_YUV_RV * v, guv = -PIX_YUV_GU * u - PIX_YUV_GV * v, bu = PIX_YUV_BU * u;
+
+        dst[0] = Pix_Yuv_Channel(src[0], rv);
+        dst[1] = Pix_Yuv_Channel(src[0], guv);
+        dst[2] = Pix_Yuv_Channel(src[0], bu);
+        dst[3] = Pix_Yuv_Channel(src[2], rv);
+        dst[4] = Pix_Yuv_Channel(src[2], guv);
+        dst[5] = Pix_Yuv_Channel(src[2], bu);
+    }
+}
+
+void Pix_Rgb565ToGray_Line_C(u8 *dst, const u16 *src, u32 pixels)
+{
+    for(u32 i = 0; i < pixels; i++)
+    {
+        u32 p = src[i];
+        u32 r = (p >> 11) & 0x1FU, g = (p >> 5) & 0x3FU, b = p & 0x1FU;
+
+        dst[i] = Pix_Luma(PIX_EXPAND5(r), PIX_EXPAND6(g), PIX_EXPAND5(b));
+    }
+}
+
+void Pix_Rgb555ToGray_Line_C(u8 *dst, const u16 *src, u32 pixels)
+{
+    for(u32 i = 0; i < pixels; i++)
+    {
+        u32 p = src[i];
+        u32 r = (p >> 10) & 0x1FU, g = (p >> 5) & 0x1FU, b = p & 0x1FU;
+
+        dst[i] = Pix_Luma(PIX_EXPAND5(r), PIX_EXPAND5(g), PIX_EXPAND5(b));
+    }
+}
+
+void Pix_Rgb888ToGray_Line_C(u8 *dst, const u8 *src, u32 pixels)
+{
+    for(u32 i = 0; i < pixels; i++) dst[i] = Pix_Luma(src[3 * i], src[3 * i + 1], src[3 * i + 2]);
+}
+
+void Pix_YuyvToGray_Line_C(u8 *dst, const u8 *src, u32 pixels)
+{
+    for(u32 i = 0; i < pixels; i++) dst[i] = src[2 * i];
+}
+
+void Pix_YuyvToI420_Line2_C(u8 *y0, u8 *y1, u8 *u, u8 *v, const u8 *src0, const u8 *src1, u32 pixels)
+{
+    for(u32 i = 0; i + 1 < pixels; i += 2)
+    {
+        const u8 *a = src0 + 2 * i, *b = src1 + 2 * i;
+
+        y0[i] = a[0];
+        y0[i + 1] = a[2];
+        y1[i] = b[0];
+        y1[i + 1] = b[2];
+        u[i / 2] = (u8)((a[1] + b[1] + 1U) >> 1);
+        v[i / 2] = (u8)((a[3] + b[3] + 1U) >> 1);
+    }
+}
+
+void Pix_BayerToGray_Line2_C(u8 *dst0, u8 *dst1, const u8 *src0, const u8 *src1, u32 pixels)
+{
+    for(u32 i = 0; i + 1 < pixels; i += 2)
+    {
+        // B G over G R
+        u8 y = (u8)((PIX_LUMA_B * src0[i] + PIX_LUMA_G2 * (src0[i + 1] + src1[i]) + PIX_LUMA_R * src1[i + 1] + 128U) >> 8);
+
+        dst0[i] = y;
+        dst0[i + 1] = y;
+        dst1[i] = y;
+        dst1[i + 1] = y;
+    }
+}
+
+// --------------------------------------- NEON kernels -----------------------------------------------
+
+#ifdef PIX_NEON
+// R, G, B of 8 RGB565 pixels widened to 8 bits: narrow the channel into the top of a byte, then
+// shift-insert its own top bits below it
+static inline uint8x8x3_t Pix_Neon_Unpack565(uint16x8_t p)
+{
+    uint8x8x3_t rgb;
+    uint8x8_t r = vshrn_n_u16(p, 8);
+    uint8x8_t g = vshrn_n_u16(vshlq_n_u16(p, 5), 8);
+    uint8x8_t b = vshrn_n_u16(vshlq_n_u16(p, 11), 8);
+
+    rgb.val[0] = vsri_n_u8(r, r, 5);
+    rgb.val[1] = vsri_n_u8(g, g, 6);
+    rgb.val[2] = vsri_n_u8(b, b, 5);
+    return rgb;
+}
+
+static inline uint8x8x3_t Pix_Neon_Unpack555(uint16x8_t p)
+{
+    uint8x8x3_t rgb;
+    uint8x8_t r = vshrn_n_u16(vshlq_n_u16(p, 1), 8);
+    uint8x8_t g = vshrn_n_u16(vshlq_n_u16(p, 6), 8);
+    uint8x8_t b = vshrn_n_u16(vshlq_n_u16(p, 11), 8);
+
+    rgb.val[0] = vsri_n_u8(r, r, 5);
+    rgb.val[1] = vsri_n_u8(g, g, 5);
+    rgb.val[2] = vsri_n_u8(b, b, 5);
+    return rgb;
+}
+
+static inline uint8x8_t Pix_Neon_Luma(uint8x8x3_t rgb)
+{
+    uint16x8_t acc = vmull_u8(rgb.val[0], vdup_n_u8(PIX_LUMA_R));
+
+    acc = vmlal_u8(acc, rgb.val[1], vdup_n_u8(PIX_LUMA_G));
+    acc = vmlal_u8(acc, rgb.val[2], vdup_n_u8(PIX_LUMA_B));
+    return vrshrn_n_u16(acc, 8);
+}
+#endif
+
+void Pix_Rgb565ToRgb888_Line(u8 *dst, const u16 *src, u32 pixels)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 8 <= pixels; i += 8)
+    {
+        __builtin_prefetch((const u8 *)(src + i) + PIX_PREFETCH);
+        vst3_u8(dst + 3 * i, Pix_Neon_Unpack565(vld1q_u16(src + i)));
+    }
+#endif
+    Pix_Rgb565ToRgb888_Line_C(dst + 3 * i, src + i, pixels - i);
+}
+
+void Pix_Rgb888ToRgb565_Line(u16 *dst, const u8 *src, u32 pixels)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 8 <= pixels; i += 8)
+    {
+        __builtin_prefetch(src + 3 * i + PIX_PREFETCH);
+        uint8x8x3_t rgb = vld3_u8(src + 3 * i);
+
+        // Each channel shifted to the top of a halfword, the next one inserted below the bits kept
+        uint16x8_t p = vshll_n_u8(rgb.val[0], 8);
+        p = vsriq_n_u16(p, vshll_n_u8(rgb.val[1], 8), 5);
+        p = vsriq_n_u16(p, vshll_n_u8(rgb.val[2], 8), 11);
+        vst1q_u16(dst + i, p);
+    }
+#endif
+    Pix_Rgb888ToRgb565_Line_C(dst + i, src + 3 * i, pixels - i);
+}
+
+void Pix_Rgb555ToRgb565_Line(u16 *dst, const u16 *src, u32 pixels)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 8 <= pixels; i += 8)
+    {
+        __builtin_prefetch((const u8 *)(src + i) + PIX_PREFETCH);
+        uint16x8_t p = vld1q_u16(src + i);
+
+        // R and G up one bit, the top green bit repeated into the new green LSB, B unchanged
+        uint16x8_t rg = vshlq_n_u16(vandq_u16(p, vdupq_n_u16(0x7FE0U)), 1);
+        uint16x8_t glsb = vandq_u16(vshrq_n_u16(p, 4), vdupq_n_u16(0x0020U));
+        vst1q_u16(dst + i, vorrq_u16(vorrq_u16(rg, glsb), vandq_u16(p, vdupq_n_u16(0x001FU))));
+    }
+#endif
+    Pix_Rgb555ToRgb565_Line_C(dst + i, src + i, pixels - i);
+}
+
+void Pix_YuyvToRgb888_Line(u8 *dst, const u8 *src, u32 pixels)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 16 <= pixels; i += 16)
+    {
+        __builtin_prefetch(src + 2 * i + PIX_PREFETCH);
+        uint8x8x4_t yuyv = vld4_u8(src + 2 * i); // Y even, U, Y odd, V of 8 pixel pairs
+        int16x8_t u = vreinterpretq_s16_u16(vsubl_u8(yuyv.val[1], vdup_n_u8(128)));
+        int16x8_t v = vreinterpretq_s16_u16(vsubl_u8(yuyv.val[3], vdup_n_u8(128)));
+        int16x8_t rv = vmulq_n_s16(v, PIX_YUV_RV);
+        int16x8_t guv = vmlaq_n_s16(vmulq_n_s16(u, -PIX_YUV_GU), v, -PIX_YUV_GV);
+        int16x8_t bu = vmulq_n_s16(u, PIX_YUV_BU);
+        int16x8_t y0 = vreinterpretq_s16_u16(vshll_n_u8(yuyv.val[0], PIX_YUV_SHIFT));
+        int16x8_t y1 = vreinterpretq_s16_u16(vshll_n_u8(yuyv.val[2], PIX_YUV_SHIFT));
+
+        // Rounding, saturating narrow does the clamp, then even / odd pixels are zipped back in order
+        uint8x8x2_t r = vzip_u8(vqrshrun_n_s16(vaddq_s16(y0, rv), PIX_YUV_SHIFT), vqrshrun_n_s16(vaddq_s16(y1, rv), PIX_YUV_SHIFT));
+        uint8x8x2_t g = vzip_u8(vqrshrun_n_s16(vaddq_s16(y0, guv), PIX_YUV_SHIFT), vqrshrun_n_s16(vaddq_s16(y1, guv), PIX_YUV_SHIFT));
+        uint8x8x2_t b = vzip_u8(vqrshrun_n_s16(vaddq_s16(y0, bu), PIX_YUV_SHIFT), vqrshrun_n_s16(vaddq_s16(y1, bu), PIX_YUV_SHIFT));
+        uint8x8x3_t lo = { { r.val[0], g.val[0], b.val[0] } };
+        uint8x8x3_t hi = { { r.val[1], g.val[1], b.val[1] } };
+
+        vst3_u8(dst + 3 * i, lo);
+        vst3_u8(dst + 3 * i + 24, hi);
+    }
+#endif
+    Pix_YuyvToRgb888_Line_C(dst + 3 * i, src + 2 * i, pixels - i);
+}
+
+void Pix_Rgb565ToGray_Line(u8 *dst, const u16 *src, u32 pixels)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 8 <= pixels; i += 8)
+    {
+        __builtin_prefetch((const u8 *)(src + i) + PIX_PREFETCH);
+        vst1_u8(dst + i, Pix_Neon_Luma(Pix_Neon_Unpack565(vld1q_u16(src + i))));
+    }
+#endif
+    Pix_Rgb565ToGray_Line_C(dst + i, src + i, pixels - i);
+}
+
+void Pix_Rgb555ToGray_Line(u8 *dst, const u16 *src, u32 pixels)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 8 <= pixels; i += 8)
+    {
+        __builtin_prefetch((const u8 *)(src + i) + PIX_PREFETCH);
+        vst1_u8(dst + i, Pix_Neon_Luma(Pix_Neon_Unpack555(vld1q_u16(src + i))));
+    }
+#endif
+    Pix_Rgb555ToGray_Line_C(dst + i, src + i, pixels - i);
+}
+
+void Pix_Rgb888ToGray_Line(u8 *dst, const u8 *src, u32 pixels)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 8 <= pixels; i += 8)
+    {
+        __builtin_prefetch(src + 3 * i + PIX_PREFETCH);
+        vst1_u8(dst + i, Pix_Neon_Luma(vld3_u8(src + 3 * i)));
+    }
+#endif
+    Pix_Rgb888ToGray_Line_C(dst + i, src + 3 * i, pixels - i);
+}
+
+void Pix_YuyvToGray_Line(u8 *dst, const u8 *src, u32 pixels)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 16 <= pixels; i += 16)
+    {
+        __builtin_prefetch(src + 2 * i + PIX_PREFETCH);
+        vst1q_u8(dst + i, vld2q_u8(src + 2 * i).val[0]);
+    }
+#endif
+    Pix_YuyvToGray_Line_C(dst + i, src + 2 * i, pixels - i);
+}
+
+void Pix_YuyvToI420_Line2(u8 *y0, u8 *y1, u8 *u, u8 *v, const u8 *src0, const u8 *src1, u32 pixels)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 16 <= pixels; i += 16)
+    {
+        __builtin_prefetch(src0 + 2 * i + PIX_PREFETCH);
+        __builtin_prefetch(src1 + 2 * i + PIX_PREFETCH);
+        uint8x16x2_t a = vld2q_u8(src0 + 2 * i); // Luma, U V U V ...
+        uint8x16x2_t b = vld2q_u8(src1 + 2 * i);
+        uint8x16_t uv = vrhaddq_u8(a.val[1], b.val[1]);
+        uint8x8x2_t split = vuzp_u8(vget_low_u8(uv), vget_high_u8(uv));
+
+        vst1q_u8(y0 + i, a.val[0]);
+        vst1q_u8(y1 + i, b.val[0]);
+        vst1_u8(u + i / 2, split.val[0]);
+        vst1_u8(v + i / 2, split.val[1]);
+    }
+#endif
+    Pix_YuyvToI420_Line2_C(y0 + i, y1 + i, u + i / 2, v + i / 2, src0 + 2 * i, src1 + 2 * i, pixels - i);
+}
+
+void Pix_BayerToGray_Line2(u8 *dst0, u8 *dst1, const u8 *src0, const u8 *src1, u32 pixels)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 16 <= pixels; i += 16)
+    {
+        __builtin_prefetch(src0 + i + PIX_PREFETCH);
+        __builtin_prefetch(src1 + i + PIX_PREFETCH);
+        uint8x8x2_t bg = vld2_u8(src0 + i);
+        uint8x8x2_t gr = vld2_u8(src1 + i);
+        uint16x8_t acc = vmull_u8(bg.val[0], vdup_n_u8(PIX_LUMA_B));
+
+        acc = vmlal_u8(acc, bg.val[1], vdup_n_u8(PIX_LUMA_G2));
+        acc = vmlal_u8(acc, gr.val[0], vdup_n_u8(PIX_LUMA_G2));
+        acc = vmlal_u8(acc, gr.val[1], vdup_n_u8(PIX_LUMA_R));
+
+        // One value per quad, repeated over its two columns and both lines
+        uint8x8_t y = vrshrn_n_u16(acc, 8);
+        uint8x8x2_t wide = vzip_u8(y, y);
+        uint8x16_t line = vcombine_u8(wide.val[0], wide.val[1]);
+        vst1q_u8(dst0 + i, line);
+        vst1q_u8(dst1 + i, line);
+    }
+#endif
+    Pix_BayerToGray_Line2_C(dst0 + i, dst1 + i, src0 + i, src1 + i, pixels - i);
+}
+
+// --------------------------------------- Images -----------------------------------------------------
+
+u32 Pix_Bytes_Per_Pixel(PixFormat format)
+{
+    switch(format)
+    {
+        case PIX_FMT_RGB565:
+        case PIX_FMT_RGB555:
+        case PIX_FMT_YUYV:   return 2;
+        case PIX_FMT_RGB888: return 3;
+        default:             return 1;
+    }
+}
+
+u32 Pix_Image_Size(PixFormat format, u16 width, u16 height)
+{
+    u32 size = (u32)width * height * Pix_Bytes_Per_Pixel(format);
+
+    if(format == PIX_FMT_I420) size += 2U * ((width + 1U) / 2U) * ((height + 1U) / 2U);
+    return size;
+}
+
+int Pix_Image_Init(PixImage *img, void *data, u16 width, u16 height, PixFormat format)
+{
+    if(img == NULL || data == NULL || format >= PIX_FMT_COUNT) return XST_INVALID_PARAM;
+
+    img->width = width;
+    img->height = height;
+    img->format = format;
+    img->planes[0] = (u8 *)data;
+    img->strides[0] = (u32)width * Pix_Bytes_Per_Pixel(format);
+    img->planes[1] = NULL;
+    img->planes[2] = NULL;
+    img->strides[1] = 0;
+    img->strides[2] = 0;
+
+    if(format == PIX_FMT_I420)
+    {
+        u32 chroma_w = (width + 1U) / 2U;
+
+        img->strides[1] = chroma_w;
+        img->strides[2] = chroma_w;
+        img->planes[1] = img->planes[0] + img->strides[0] * height;
+        img->planes[2] = img->planes[1] + chroma_w * ((height + 1U) / 2U);
+    }
+    return XST_SUCCESS;
+}
+
+int Pix_Image_FromFrame(PixImage *img, const FrameBuf *frame)
+{
+    static const PixFormat from_ov7670[OV7670_FMT_COUNT] = {
+        [OV7670_FMT_RGB565]    = PIX_FMT_RGB565,
+        [OV7670_FMT_RGB555]    = PIX_FMT_RGB555,
+        [OV7670_FMT_YUV422]    = PIX_FMT_YUYV,
+        [OV7670_FMT_BAYER_RAW] = PIX_FMT_BAYER_BGGR,
+    };
+    int status;
+
+    if(frame == NULL || frame->format >= OV7670_FMT_COUNT) return XST_INVALID_PARAM;
+
+    status = Pix_Image_Init(img, frame->data, frame->width, frame->height, from_ov7670[frame->format]);
+    if(status == XST_SUCCESS && frame->stride != 0) img->strides[0] = frame->stride;
+    return status;
+}
+
+// Copy every plane line by line, the strides may differ
+static void Pix_Copy(const PixImage *src, PixImage *dst)
+{
+    u32 planes = src->format == PIX_FMT_I420 ? 3U : 1U;
+
+    for(u32 plane = 0; plane < planes; plane++)
+    {
+        u32 line_bytes = plane == 0 ? (u32)src->width * Pix_Bytes_Per_Pixel(src->format) : (src->width + 1U) / 2U;
+        u32 lines = plane == 0 ? src->height : (src->height + 1U) / 2U;
+
+        for(u32 y = 0; y < lines; y++) memcpy(PIX_LINE(dst, plane, y), PIX_LINE(src, plane, y), line_bytes);
+    }
+}
+
+// One line of a single line conversion
+static int Pix_Convert_Line(PixFormat from, PixFormat to, u8 *d, const u8 *s, u32 pixels)
+{
+    switch(PIX_PAIR(from, to))
+    {
+        case PIX_PAIR(PIX_FMT_RGB565, PIX_FMT_RGB888): Pix_Rgb565ToRgb888_Line(d, (const u16 *)s, pixels); break;
+        case PIX_PAIR(PIX_FMT_RGB888, PIX_FMT_RGB565): Pix_Rgb888ToRgb565_Line((u16 *)d, s, pixels); break;
+        case PIX_PAIR(PIX_FMT_RGB555, PIX_FMT_RGB565): Pix_Rgb555ToRgb565_Line((u16 *)d, (const u16 *)s, pixels); break;
+        case PIX_PAIR(PIX_FMT_YUYV,   PIX_FMT_RGB888): Pix_YuyvToRgb888_Line(d, s, pixels); break;
+        case PIX_PAIR(PIX_FMT_RGB565, PIX_FMT_GRAY8):  Pix_Rgb565ToGray_Line(d, (const u16 *)s, pixels); break;
+        case PIX_PAIR(PIX_FMT_RGB555, PIX_FMT_GRAY8):  Pix_Rgb555ToGray_Line(d, (const u16 *)s, pixels); break;
+        case PIX_PAIR(PIX_FMT_RGB888, PIX_FMT_GRAY8):  Pix_Rgb888ToGray_Line(d, s, pixels); break;
+        case PIX_PAIR(PIX_FMT_YUYV,   PIX_FMT_GRAY8):  Pix_YuyvToGray_Line(d, s, pixels); break;
+        case PIX_PAIR(PIX_FMT_I420,   PIX_FMT_GRAY8):  memcpy(d, s, pixels); break;
+        default: return XST_NO_FEATURE;
+    }
+    return XST_SUCCESS;
+}
+
+int Pix_Convert(const PixImage *src, PixImage *dst)
+{
+    u32 w, h;
+    int status = XST_SUCCESS;
+
+    if(src == NULL || dst == NULL || src->width != dst->width || src->height != dst->height) return XST_INVALID_PARAM;
+    if(src->format >= PIX_FMT_COUNT || dst->format >= PIX_FMT_COUNT) return XST_INVALID_PARAM;
+
+    w = src->width;
+    h = src->height;
+    if((w & 1U) != 0 && (src->format == PIX_FMT_YUYV || src->format == PIX_FMT_BAYER_BGGR ||
+                          src->format == PIX_FMT_I420 || dst->format == PIX_FMT_I420)) return XST_INVALID_PARAM;
+    if((h & 1U) != 0 && (src->format == PIX_FMT_BAYER_BGGR || src->format == PIX_FMT_I420 || dst->format == PIX_FMT_I420))
+        return XST_INVALID_PARAM;
+
+    if(src->format == dst->format)
+    {
+        Pix_Copy(src, dst);
+        return XST_SUCCESS;
+    }
+
+    switch(PIX_PAIR(src->format, dst->format))
+    {
+        case PIX_PAIR(PIX_FMT_YUYV, PIX_FMT_I420):
+            for(u32 y = 0; y < h; y += 2)
+            {
+                Pix_YuyvToI420_Line2(PIX_LINE(dst, 0, y), PIX_LINE(dst, 0, y + 1), PIX_LINE(dst, 1, y / 2), PIX_LINE(dst, 2, y / 2),
+                                     PIX_LINE(src, 0, y), PIX_LINE(src, 0, y + 1), w);
+            }
+            break;
+
+        case PIX_PAIR(PIX_FMT_BAYER_BGGR, PIX_FMT_GRAY8):
+            for(u32 y = 0; y < h; y += 2)
+            {
+                Pix_BayerToGray_Line2(PIX_LINE(dst, 0, y), PIX_LINE(dst, 0, y + 1), PIX_LINE(src, 0, y), PIX_LINE(src, 0, y + 1), w);
+            }
+            break;
+
+        default:
+            for(u32 y = 0; y < h && status == XST_SUCCESS; y++)
+            {
+                status = Pix_Convert_Line(src->format, dst->format, PIX_LINE(dst, 0, y), PIX_LINE(src, 0, y), w);
+            }
+            break;
+    }
+    return status;
+}
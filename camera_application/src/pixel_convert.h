@@ -0,0 +1,84 @@
+#ifndef __PIXEL_CONVERT_H__
+#define __PIXEL_CONVERT_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "frame_pool.h"
+
+/*
+    Pixel format conversion for captured frames. Every line kernel has a portable scalar reference
+    ( *_C ) and, when the app is built with NEON ( -mfpu=neon, UserConfig.cmake ), a vector version
+    giving the same result bit for bit, 8 or 16 pixels a step with the remainder left to the reference.
+
+    RGB565 / RGB555 pixels are native u16, the capture IP packs the two sensor bytes into one halfword.
+    RGB888 is R, G, B bytes. YUV is full range BT.601 ( COM15 0xC0 ), luma is ( 77 R + 150 G + 29 B ) / 256.
+*/
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PIX_NEON 1
+#endif
+
+typedef enum {
+    PIX_FMT_RGB565,
+    PIX_FMT_RGB555,
+    PIX_FMT_YUYV,       // YUV422, Y0 U Y1 V
+    PIX_FMT_BAYER_BGGR, // 8 bit raw, B G on even lines, G R on odd lines
+    PIX_FMT_RGB888,
+    PIX_FMT_I420,       // Planar YUV420, chroma planes at half width and height
+    PIX_FMT_GRAY8,
+    PIX_FMT_COUNT
+} PixFormat;
+
+// A frame or a window into one, planes[1] / planes[2] are the U / V planes of PIX_FMT_I420
+typedef struct {
+    u8 *planes[3];
+    u32 strides[3];     // Bytes per line of each plane
+    u16 width;
+    u16 height;
+    PixFormat format;
+} PixImage;
+
+// Bytes per pixel of the first plane
+u32 Pix_Bytes_Per_Pixel(PixFormat format);
+
+// Bytes of a tightly packed image, chroma planes included
+u32 Pix_Image_Size(PixFormat format, u16 width, u16 height);
+
+// Describe a tightly packed image at data
+int Pix_Image_Init(PixImage *img, void *data, u16 width, u16 height, PixFormat format);
+
+// Describe a captured frame, its stride and OV7670 format are carried over
+int Pix_Image_FromFrame(PixImage *img, const FrameBuf *frame);
+
+// Convert a whole image, same width and height. XST_NO_FEATURE for pairs without a kernel.
+// Same format is a line by line copy. YUYV and I420 need an even width, I420 and Bayer an even height.
+int Pix_Convert(const PixImage *src, PixImage *dst);
+
+// Line kernels, pixels is the line width. YUYV and Bayer lines take an even count.
+void Pix_Rgb565ToRgb888_Line(u8 *dst, const u16 *src, u32 pixels);
+void Pix_Rgb888ToRgb565_Line(u16 *dst, const u8 *src, u32 pixels);
+void Pix_Rgb555ToRgb565_Line(u16 *dst, const u16 *src, u32 pixels);
+void Pix_YuyvToRgb888_Line(u8 *dst, const u8 *src, u32 pixels);
+void Pix_Rgb565ToGray_Line(u8 *dst, const u16 *src, u32 pixels);
+void Pix_Rgb555ToGray_Line(u8 *dst, const u16 *src, u32 pixels);
+void Pix_Rgb888ToGray_Line(u8 *dst, const u8 *src, u32 pixels);
+void Pix_YuyvToGray_Line(u8 *dst, const u8 *src, u32 pixels);
+
+// Line pair kernels: one chroma line from two YUYV lines, one luma value per BGGR quad
+void Pix_YuyvToI420_Line2(u8 *y0, u8 *y1, u8 *u, u8 *v, const u8 *src0, const u8 *src1, u32 pixels);
+void Pix_BayerToGray_Line2(u8 *dst0, u8 *dst1, const u8 *src0, const u8 *src1, u32 pixels);
+
+// Scalar references, also used for the remainder of each NEON kernel
+void Pix_Rgb565ToRgb888_Line_C(u8 *dst, const u16 *src, u32 pixels);
+void Pix_Rgb888ToRgb565_Line_C(u16 *dst, const u8 *src, u32 pixels);
+void Pix_Rgb555ToRgb565_Line_C(u16 *dst, const u16 *src, u32 pixels);
+void Pix_YuyvToRgb888_Line_C(u8 *dst, const u8 *src, u32 pixels);
+void Pix_Rgb565ToGray_Line_C(u8 *dst, const u16 *src, u32 pixels);
+void Pix_Rgb555ToGray_Line_C(u8 *dst, const u16 *src, u32 pixels);
+void Pix_Rgb888ToGray_Line_C(u8 *dst, const u8 *src, u32 pixels);
+void Pix_YuyvToGray_Line_C(u8 *dst, const u8 *src, u32 pixels);
+void Pix_YuyvToI420_Line2_C(u8 *y0, u8 *y1, u8 *u, u8 *v, const u8 *src0, const u8 *src1, u32 pixels);
+void Pix_BayerToGray_Line2_C(u8 *dst0, u8 *dst1, const u8 *src0, const u8 *src1, u32 pixels);
+
+#endif
@@ -0,0 +1,360 @@
+#include "resize.h"
+#include <string.h>
+
+#ifdef PIX_NEON
+#include <arm_neon.h>
+#endif
+
+// One plane of the source window or of the output
+typedef struct {
+    u8 *base;            // First pixel
+    u32 stride;
+    u32 width;
+    u32 height;
+} ResizePlane;
+
+void Resize_Init(Resize *rs)
+{
+    memset(&rs->stats, 0, sizeof(rs->stats));
+    rs->row_src[0] = -1;
+    rs->row_src[1] = -1;
+}
+
+// 8 bit channels of a source line, RGB565 goes through the line buffer
+static const u8 *Resize_Src_Line(Resize *rs, const ResizePlane *s, u32 y, int rgb565)
+{
+    const u8 *line = s->base + y * s->stride;
+
+    if(!rgb565) return line;
+    Pix_Rgb565ToRgb888_Line(rs->line, (const u16 *)line, s->width);
+    return rs->line;
+}
+
+// Where the 8 bit channels of an output line go, packed by Resize_Dst_Commit for RGB565
+static u8 *Resize_Dst_Line(Resize *rs, const ResizePlane *d, u32 y, int rgb565)
+{
+    return rgb565 ? rs->out : d->base + y * d->stride;
+}
+
+static void Resize_Dst_Commit(Resize *rs, const ResizePlane *d, u32 y, int rgb565)
+{
+    if(rgb565) Pix_Rgb888ToRgb565_Line((u16 *)(d->base + y * d->stride), rs->out, d->width);
+}
+
+// --------------------------------------- Box --------------------------------------------------------
+
+// acc[i] += line[i]
+static void Resize_Accumulate(u16 *acc, const u8 *line, u32 samples)
+{
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 16 <= samples; i += 16)
+    {
+        uint8x16_t l = vld1q_u8(line + i);
+        vst1q_u16(acc + i, vaddw_u8(vld1q_u16(acc + i), vget_low_u8(l)));
+        vst1q_u16(acc + i + 8, vaddw_u8(vld1q_u16(acc + i + 8), vget_high_u8(l)));
+    }
+#endif
+    for(; i < samples; i++) acc[i] += line[i];
+}
+
+#ifdef PIX_NEON
+// Sums of neighbouring lanes: 16 samples in, 8 pair sums out
+static inline uint16x8_t Resize_Neon_Pairs(uint16x8_t a, uint16x8_t b)
+{
+    return vcombine_u16(vpadd_u16(vget_low_u16(a), vget_high_u16(a)), vpadd_u16(vget_low_u16(b), vget_high_u16(b)));
+}
+
+// 8 box sums from factor vectors of 8 consecutive columns, rounded to the mean
+static inline uint8x8_t Resize_Neon_BoxMean(const uint16x8_t *v, u32 factor)
+{
+    uint16x8_t s = Resize_Neon_Pairs(v[0], v[1]);
+
+    if(factor == 2) return vrshrn_n_u16(s, 2);
+    return vrshrn_n_u16(Resize_Neon_Pairs(s, Resize_Neon_Pairs(v[2], v[3])), 4);
+}
+#endif
+
+// Output line from the column sums of factor lines
+static void Resize_Box_Line(u8 *out, const u16 *acc, u32 width, u32 ch, u32 factor)
+{
+    u32 shift = factor == 2 ? 2U : 4U;
+    u32 ox = 0;
+
+#ifdef PIX_NEON
+    if(ch == 1)
+    {
+        for(; ox + 8 <= width; ox += 8)
+        {
+            uint16x8_t v[4];
+
+            for(u32 j = 0; j < factor; j++) v[j] = vld1q_u16(acc + ox * factor + 8 * j);
+            vst1_u8(out + ox, Resize_Neon_BoxMean(v, factor));
+        }
+    }
+    else
+    {
+        for(; ox + 8 <= width; ox += 8)
+        {
+            uint16x8x3_t p[4];
+            uint8x8x3_t o;
+
+            for(u32 j = 0; j < factor; j++) p[j] = vld3q_u16(acc + (ox * factor + 8 * j) * 3);
+            for(u32 c = 0; c < 3; c++)
+            {
+                uint16x8_t v[4];
+
+                for(u32 j = 0; j < factor; j++) v[j] = p[j].val[c];
+                o.val[c] = Resize_Neon_BoxMean(v, factor);
+            }
+            vst3_u8(out + ox * 3, o);
+        }
+    }
+#endif
+    for(; ox < width; ox++)
+    {
+        for(u32 c = 0; c < ch; c++)
+        {
+            u32 sum = 0;
+
+            for(u32 j = 0; j < factor; j++) sum += acc[(ox * factor + j) * ch + c];
+            out[ox * ch + c] = (u8)((sum + (1U << (shift - 1))) >> shift);
+        }
+    }
+}
+
+static void Resize_Box_Plane(Resize *rs, const ResizePlane *s, const ResizePlane *d, u32 ch, u32 factor, int rgb565)
+{
+    u32 samples = d->width * factor * ch;
+
+    for(u32 oy = 0; oy < d->height; oy++)
+    {
+        memset(rs->acc, 0, samples * sizeof(rs->acc[0]));
+        for(u32 k = 0; k < factor; k++) Resize_Accumulate(rs->acc, Resize_Src_Line(rs, s, oy * factor + k, rgb565), samples);
+
+        Resize_Box_Line(Resize_Dst_Line(rs, d, oy, rgb565), rs->acc, d->width, ch, factor);
+        Resize_Dst_Commit(rs, d, oy, rgb565);
+    }
+}
+
+// --------------------------------------- Bilinear ---------------------------------------------------
+
+// Source position of output index i, centres aligned, as a sample index and the Q8 weight of the next one
+static void Resize_Map(u32 i, u32 src_len, u32 dst_len, u32 *pos, u8 *frac)
+{
+    u64 step = ((u64)src_len << 16) / dst_len;
+    s64 at = (s64)(((2U * (u64)i + 1U) * step) >> 1) - 32768;
+
+    if(at < 0) at = 0;
+    *pos = (u32)(at >> 16);
+    *frac = (u8)((at >> 8) & 0xFF);
+    if(*pos >= src_len - 1U)
+    {
+        *pos = src_len - 1U;
+        *frac = 0;
+    }
+}
+
+// Horizontally resampled source line y, the cached line keep is not evicted
+static const u16 *Resize_Bilinear_Row(Resize *rs, const ResizePlane *s, const ResizePlane *d, u32 y, s32 keep, u32 ch, int rgb565)
+{
+    const u8 *line;
+    u16 *row;
+    int slot;
+
+    if(rs->row_src[0] == (s32)y) return rs->rows[0];
+    if(rs->row_src[1] == (s32)y) return rs->rows[1];
+
+    slot = rs->row_src[0] == keep ? 1 : 0;
+    row = rs->rows[slot];
+    line = Resize_Src_Line(rs, s, y, rgb565);
+
+    // A gather per output pixel, no NEON here, it runs over output pixels only
+    for(u32 ox = 0; ox < d->width; ox++)
+    {
+        u32 w1 = rs->fx[ox], w0 = 256U - w1;
+        const u8 *a = line + rs->x0[ox] * ch;
+        const u8 *b = w1 != 0 ? a + ch : a;
+
+        for(u32 c = 0; c < ch; c++) row[ox * ch + c] = (u16)(a[c] * w0 + b[c] * w1);
+    }
+    rs->row_src[slot] = (s32)y;
+    return row;
+}
+
+// out = ( r0 * ( 256 - fy ) + r1 * fy ) / 65536, rounded
+static void Resize_Blend(u8 *out, const u16 *r0, const u16 *r1, u32 fy, u32 samples)
+{
+    u32 w0 = 256U - fy;
+    u32 i = 0;
+
+#ifdef PIX_NEON
+    for(; i + 8 <= samples; i += 8)
+    {
+        uint16x8_t a = vld1q_u16(r0 + i), b = vld1q_u16(r1 + i);
+        uint32x4_t lo = vmlal_n_u16(vmull_n_u16(vget_low_u16(a), (u16)w0), vget_low_u16(b), (u16)fy);
+        uint32x4_t hi = vmlal_n_u16(vmull_n_u16(vget_high_u16(a), (u16)w0), vget_high_u16(b), (u16)fy);
+
+        vst1_u8(out + i, vmovn_u16(vcombine_u16(vrshrn_n_u32(lo, 16), vrshrn_n_u32(hi, 16))));
+    }
+#endif
+    for(; i < samples; i++) out[i] = (u8)((r0[i] * w0 + r1[i] * fy + 32768U) >> 16);
+}
+
+static void Resize_Bilinear_Plane(Resize *rs, const ResizePlane *s, const ResizePlane *d, u32 ch, int rgb565)
+{
+    for(u32 ox = 0; ox < d->width; ox++)
+    {
+        u32 x0;
+
+        Resize_Map(ox, s->width, d->width, &x0, &rs->fx[ox]);
+        rs->x0[ox] = (u16)x0;
+    }
+    rs->row_src[0] = -1;
+    rs->row_src[1] = -1;
+
+    for(u32 oy = 0; oy < d->height; oy++)
+    {
+        u32 y0, y1;
+        u8 fy;
+
+        Resize_Map(oy, s->height, d->height, &y0, &fy);
+        y1 = fy != 0 ? y0 + 1U : y0;
+
+        const u16 *r0 = Resize_Bilinear_Row(rs, s, d, y0, (s32)y1, ch, rgb565);
+        const u16 *r1 = Resize_Bilinear_Row(rs, s, d, y1, (s32)y0, ch, rgb565);
+        Resize_Blend(Resize_Dst_Line(rs, d, oy, rgb565), r0, r1, fy, d->width * ch);
+        Resize_Dst_Commit(rs, d, oy, rgb565);
+    }
+}
+
+// --------------------------------------- Images -----------------------------------------------------
+
+// Validate a request and resolve the window
+static int Resize_Check(Resize *rs, const PixImage *src, const ResizeRect *crop, const PixImage *dst, ResizeRect *win)
+{
+    int i420;
+
+    if(rs == NULL || src == NULL || dst == NULL || src->format != dst->format) return XST_INVALID_PARAM;
+    if(src->format != PIX_FMT_GRAY8 && src->format != PIX_FMT_RGB888 && src->format != PIX_FMT_RGB565 &&
+       src->format != PIX_FMT_I420) return XST_NO_FEATURE;
+
+    if(crop != NULL) *win = *crop;
+    else
+    {
+        win->x = 0;
+        win->y = 0;
+        win->width = src->width;
+        win->height = src->height;
+    }
+
+    if(win->width == 0 || win->height == 0 || dst->width == 0 || dst->height == 0) return XST_INVALID_PARAM;
+    if((u32)win->x + win->width > src->width || (u32)win->y + win->height > src->height) return XST_INVALID_PARAM;
+    if(win->width > RESIZE_MAX_WIDTH || dst->width > RESIZE_MAX_WIDTH) return XST_INVALID_PARAM;
+
+    // Chroma planes take the window and output at half size
+    i420 = src->format == PIX_FMT_I420;
+    if(i420 && ((win->x | win->y | win->width | win->height | dst->width | dst->height) & 1U) != 0) return XST_INVALID_PARAM;
+    return XST_SUCCESS;
+}
+
+// Run a filter over every plane, factor 0 selects bilinear
+static int Resize_Run(Resize *rs, const PixImage *src, const ResizeRect *crop, PixImage *dst, u32 factor)
+{
+    ResizeRect win;
+    XTime t0, t1;
+    int status = Resize_Check(rs, src, crop, dst, &win);
+    int rgb565;
+    u32 ch, bpp, planes;
+
+    if(status == XST_SUCCESS && factor != 0 && (win.width / factor != dst->width || win.height / factor != dst->height))
+        status = XST_INVALID_PARAM;
+    if(status != XST_SUCCESS)
+    {
+        if(rs != NULL) rs->stats.errors++;
+        return status;
+    }
+
+    XTime_GetTime(&t0);
+    rgb565 = src->format == PIX_FMT_RGB565;
+    ch = (src->format == PIX_FMT_RGB888 || rgb565) ? 3U : 1U;
+    bpp = Pix_Bytes_Per_Pixel(src->format);
+    planes = src->format == PIX_FMT_I420 ? 3U : 1U;
+
+    for(u32 p = 0; p < planes; p++)
+    {
+        u32 scale = p == 0 ? 1U : 2U;
+        ResizePlane s = {
+            .base = src->planes[p] + (win.y / scale) * src->strides[p] + (win.x / scale) * bpp,
+            .stride = src->strides[p],
+            .width = win.width / scale,
+            .height = win.height / scale,
+        };
+        ResizePlane d = {
+            .base = dst->planes[p],
+            .stride = dst->strides[p],
+            .width = dst->width / scale,
+            .height = dst->height / scale,
+        };
+
+        if(factor != 0) Resize_Box_Plane(rs, &s, &d, ch, factor, rgb565);
+        else Resize_Bilinear_Plane(rs, &s, &d, ch, rgb565);
+    }
+    XTime_GetTime(&t1);
+
+    if(factor != 0) rs->stats.box++;
+    else rs->stats.bilinear++;
+    rs->stats.busy_ticks += t1 - t0;
+    return XST_SUCCESS;
+}
+
+int Resize_Box(Resize *rs, const PixImage *src, const ResizeRect *crop, PixImage *dst, u32 factor)
+{
+    if(factor != 2 && factor != 4)
+    {
+        if(rs != NULL) rs->stats.errors++;
+        return XST_INVALID_PARAM;
+    }
+    return Resize_Run(rs, src, crop, dst, factor);
+}
+
+int Resize_Bilinear(Resize *rs, const PixImage *src, const ResizeRect *crop, PixImage *dst)
+{
+    return Resize_Run(rs, src, crop, dst, 0);
+}
+
+int Resize_Image(Resize *rs, const PixImage *src, const ResizeRect *crop, PixImage *dst)
+{
+    u32 w = crop != NULL ? crop->width : (src != NULL ? src->width : 0);
+    u32 h = crop != NULL ? crop->height : (src != NULL ? src->height : 0);
+
+    if(dst != NULL)
+    {
+        // I420 chroma has to divide evenly as well
+        u32 align = (src != NULL && src->format == PIX_FMT_I420) ? 2U : 1U;
+
+        for(u32 factor = 2; factor <= 4; factor += 2)
+        {
+            if(w == dst->width * factor && h == dst->height * factor && (dst->width % align) == 0 && (dst->height % align) == 0)
+                return Resize_Run(rs, src, crop, dst, factor);
+        }
+    }
+    return Resize_Run(rs, src, crop, dst, 0);
+}
+
+void Resize_GetStats(const Resize *rs, ResizeStats *stats)
+{
+    *stats = rs->stats;
+}
+
+void Resize_Print_Stats(const Resize *rs)
+{
+    ResizeStats stats;
+    u32 images;
+
+    Resize_GetStats(rs, &stats);
+    images = stats.box + stats.bilinear;
+    xil_printf("[INFO] Resize: %u box, %u bilinear, %u refused, %u us per image\n", stats.box, stats.bilinear, stats.errors,
+               images != 0 ? (u32)(stats.busy_ticks / images / (COUNTS_PER_SECOND / 1000000)) : 0U);
+}
@@ -0,0 +1,68 @@
+#ifndef __RESIZE_H__
+#define __RESIZE_H__
+
+#include "xil_types.h"
+#include "xstatus.h"
+#include "xil_printf.h"
+#include "xiltimer.h"
+#include "pixel_convert.h"
+
+/*
+    Downscaled / cropped copies of captured frames, for a preview or analytics stream without
+    reprogramming the sensor. Both filters are separable and work through line buffers in the
+    Resize context ( ~17 KB, inside the 32 KB L1 ) rather than over the frame:
+
+    - Box 2x / 4x: the vertical pass sums factor source lines into 16 bit column sums, the
+      horizontal pass adds neighbouring columns and rounds ( NEON pairwise adds ).
+    - Bilinear, any ratio: source lines are resampled horizontally in Q8 into a two line cache,
+      the vertical pass blends the two lines ( NEON ). Pixel centres are aligned, a 1:1 ratio is an
+      exact copy.
+
+    GRAY8, RGB888, RGB565 ( unpacked to 8 bit channels per line ) and I420 ( per plane ) are supported.
+*/
+
+#define RESIZE_MAX_WIDTH 640U   // Widest source window and output line, VGA
+
+// Source window, in pixels of the first plane
+typedef struct {
+    u16 x;
+    u16 y;
+    u16 width;
+    u16 height;
+} ResizeRect;
+
+typedef struct {
+    u32 box;             // Images done with the box filter
+    u32 bilinear;        // Images done with the bilinear filter
+    u32 errors;          // Requests refused
+    u64 busy_ticks;      // Global timer ticks spent resizing
+} ResizeStats;
+
+// Working lines for one resize at a time, keep one per thread of use
+typedef struct {
+    u16 acc[RESIZE_MAX_WIDTH * 3];       // Box: column sums of the current output line
+    u16 rows[2][RESIZE_MAX_WIDTH * 3];   // Bilinear: horizontally resampled source lines, Q8
+    s32 row_src[2];                      // Source line held in rows[], -1 when empty
+    u16 x0[RESIZE_MAX_WIDTH];            // Bilinear: left source sample of each output pixel
+    u8  fx[RESIZE_MAX_WIDTH];            // Bilinear: weight of the right neighbour, Q8
+    u8  line[RESIZE_MAX_WIDTH * 3];      // RGB565 source line unpacked
+    u8  out[RESIZE_MAX_WIDTH * 3];       // RGB565 output line before packing
+    ResizeStats stats;
+} Resize;
+
+void Resize_Init(Resize *rs);
+
+// Scale the crop window ( NULL for the whole image ) of src to the size of dst, same format.
+// Exact 2x / 4x reductions use the box filter, everything else bilinear.
+int Resize_Image(Resize *rs, const PixImage *src, const ResizeRect *crop, PixImage *dst);
+
+// Box filter, dst must be the window divided by factor ( 2 or 4 )
+int Resize_Box(Resize *rs, const PixImage *src, const ResizeRect *crop, PixImage *dst, u32 factor);
+
+// Bilinear filter, any ratio either way
+int Resize_Bilinear(Resize *rs, const PixImage *src, const ResizeRect *crop, PixImage *dst);
+
+void Resize_GetStats(const Resize *rs, ResizeStats *stats);
+void Resize_Print_Stats(const Resize *rs);
+
+#endif
@@ -115,6 +115,7 @@
 #include "image_mover.h"
 #include "xparameters.h"
 #include "xil_cache.h"
+#include "xil_mem.h"
 #include "xil_exception.h"
 #include "xstatus.h"
 #include "fsbl_hooks.h"
@@ -876,14 +877,10 @@ void ErrorLockdown(u32 State)
 ****************************************************************************/
 void *(memcpy_rom)(void * s1, const void * s2, u32 n)
 {
-	char *dst = (char *)s1;
-	const char *src = (char *)s2;
-
 	/*
-	 * Loop and copy
+	 * Block copy, NEON for large images
 	 */
-	while (n-- != 0)
-		*dst++ = *src++;
+	Xil_MemCpy(s1, s2, n);
 	return s1;
 }
 /******************************************************************************/
@@ -24,6 +24,7 @@
 * 6.1   nsk      11/07/16 First release.
 * 7.0   mus      01/07/19 Add cpp extern macro
 * 9.0   ml       03/03/23 Add description to fix doxygen warnings.
+* 9.3   cam      10/16/26 Add Xil_MemSet and XIL_MEM_NEON_MIN.
 * </pre>
 *
 *****************************************************************************/
@@ -34,9 +35,20 @@
 extern "C" {
 #endif
 
+/************************** Constant Definitions ****************************/
+
+/**
+ * Copies and fills of at least this many bytes use the 64 byte NEON loop on
+ * Cortex-A9, below it the head / tail alignment work costs more than it saves.
+ */
+#ifndef XIL_MEM_NEON_MIN
+#define XIL_MEM_NEON_MIN	128U
+#endif
+
 /************************** Function Prototypes *****************************/
 
 void Xil_MemCpy(void* dst, const void* src, u32 cnt);
+void Xil_MemSet(void* dst, s32 val, u32 cnt);
 
 #ifdef __cplusplus
 }
@@ -8,8 +8,9 @@
 /**
 * @file xil_mem.c
 *
-* This file contains xil mem copy function to use in case of word aligned
-* data copies.
+* This file contains xil mem copy and set functions. On Cortex-A9 copies and
+* fills of XIL_MEM_NEON_MIN bytes or more run 64 bytes at a time through NEON
+* with PLD prefetching, the rest falls back to the scalar loops.
 *
 * <pre>
 * MODIFICATION HISTORY:
@@ -22,6 +23,9 @@
 * 			  violations.
 * 7.7	sk	 01/10/22 Include xil_mem.h header file to fix Xil_MemCpy
 * 			  prototype misra_c_2012_rule_8_4 violation.
+* 9.3   cam      10/16/26 NEON block copy with PLD and head/tail alignment
+* 			  handling, unaligned sources use unaligned NEON loads.
+* 			  Add Xil_MemSet.
 *
 * </pre>
 *
@@ -32,7 +36,117 @@
 #include "xil_types.h"
 #include "xil_mem.h"
 
+/************************** Constant Definitions ****************************/
+
+#define XIL_MEM_BLOCK		64U	/**< Bytes moved per NEON loop iteration */
+#define XIL_MEM_ALIGN		16U	/**< Destination alignment of the NEON loop */
+
+/*
+ * Cortex-A9 with the hard float ABI only, that is when the IRQ / FIQ vectors
+ * save d0-d7 and an interrupt handler may itself copy with NEON.
+ */
+#if defined(__arm__) && !defined(__aarch64__) && defined(__ARM_PCS_VFP)
+#define XIL_MEM_NEON		1	/**< NEON through inline assembly */
+#endif
+
 /***************** Inline Functions Definitions ********************/
+
+#ifdef XIL_MEM_NEON
+/*****************************************************************************/
+/**
+* @brief       Copy blocks of 64 bytes with NEON, prefetching three blocks
+*              ahead. The BSP is built for VFPv3, the .fpu directive enables
+*              the NEON instructions for this sequence only. Unaligned
+*              sources use unaligned loads, which need Normal memory the same
+*              way the word loop's unaligned accesses do.
+*
+* @param       d: destination, XIL_MEM_ALIGN aligned
+*
+* @param       s: source
+*
+* @param       blocks: number of 64 byte blocks, at least 1
+*
+*****************************************************************************/
+static void Xil_MemCpyBlocks(u8 *d, const u8 *s, u32 blocks)
+{
+	if (((UINTPTR)s & (XIL_MEM_ALIGN - 1U)) == 0U) {
+		__asm__ __volatile__(
+			".fpu neon\n"
+			"1:\n"
+			"pld [%1, #192]\n"
+			"vld1.64 {d0-d3}, [%1 :128]!\n"
+			"vld1.64 {d4-d7}, [%1 :128]!\n"
+			"subs %2, %2, #1\n"
+			"vst1.64 {d0-d3}, [%0 :128]!\n"
+			"vst1.64 {d4-d7}, [%0 :128]!\n"
+			"bne 1b\n"
+			: "+r" (d), "+r" (s), "+r" (blocks)
+			:
+			: "d0", "d1", "d2", "d3", "d4", "d5", "d6", "d7", "cc", "memory");
+	} else {
+		__asm__ __volatile__(
+			".fpu neon\n"
+			"1:\n"
+			"pld [%1, #192]\n"
+			"vld1.8 {d0-d3}, [%1]!\n"
+			"vld1.8 {d4-d7}, [%1]!\n"
+			"subs %2, %2, #1\n"
+			"vst1.64 {d0-d3}, [%0 :128]!\n"
+			"vst1.64 {d4-d7}, [%0 :128]!\n"
+			"bne 1b\n"
+			: "+r" (d), "+r" (s), "+r" (blocks)
+			:
+			: "d0", "d1", "d2", "d3", "d4", "d5", "d6", "d7", "cc", "memory");
+	}
+}
+
+/*****************************************************************************/
+/**
+* @brief       Fill blocks of 64 bytes with NEON.
+*
+* @param       d: destination, XIL_MEM_ALIGN aligned
+*
+* @param       val: byte value
+*
+* @param       blocks: number of 64 byte blocks, at least 1
+*
+*****************************************************************************/
+static void Xil_MemSetBlocks(u8 *d, u8 val, u32 blocks)
+{
+	__asm__ __volatile__(
+		".fpu neon\n"
+		"vdup.8 q0, %2\n"
+		"vmov q1, q0\n"
+		"1:\n"
+		"subs %1, %1, #1\n"
+		"vst1.64 {d0-d3}, [%0 :128]!\n"
+		"vst1.64 {d0-d3}, [%0 :128]!\n"
+		"bne 1b\n"
+		: "+r" (d), "+r" (blocks)
+		: "r" (val)
+		: "d0", "d1", "d2", "d3", "cc", "memory");
+}
+#else
+/* Portable block loops, the same head / tail handling runs on hosts */
+static void Xil_MemCpyBlocks(u8 *d, const u8 *s, u32 blocks)
+{
+	u32 i;
+
+	for (i = 0U; i < (blocks * XIL_MEM_BLOCK); i++) {
+		d[i] = s[i];
+	}
+}
+
+static void Xil_MemSetBlocks(u8 *d, u8 val, u32 blocks)
+{
+	u32 i;
+
+	for (i = 0U; i < (blocks * XIL_MEM_BLOCK); i++) {
+		d[i] = val;
+	}
+}
+#endif
+
 /*****************************************************************************/
 /**
 * @brief       This  function copies memory from once location to other.
@@ -49,6 +163,28 @@ void Xil_MemCpy(void* dst, const void* src, u32 cnt)
 	char *d = (char*)(void *)dst;
 	const char *s = src;
 
+	if (cnt >= XIL_MEM_NEON_MIN) {
+		/* Bytes up to the first 16 byte aligned destination address */
+		u32 head = (u32)(0U - (UINTPTR)d) & (XIL_MEM_ALIGN - 1U);
+		u32 blocks;
+
+		cnt -= head;
+		while (head > 0U) {
+			*d = *s;
+			d += 1U;
+			s += 1U;
+			head -= 1U;
+		}
+
+		blocks = cnt / XIL_MEM_BLOCK;
+		if (blocks > 0U) {
+			Xil_MemCpyBlocks((u8 *)d, (const u8 *)s, blocks);
+		}
+		d += blocks * XIL_MEM_BLOCK;
+		s += blocks * XIL_MEM_BLOCK;
+		cnt -= blocks * XIL_MEM_BLOCK;
+	}
+
 	while (cnt >= sizeof (s32)) {
 		*(s32*)d = *(s32*)s;
 		d += sizeof (s32);
@@ -68,3 +204,45 @@ void Xil_MemCpy(void* dst, const void* src, u32 cnt)
 		cnt -= 1U;
 	}
 }
+
+/*****************************************************************************/
+/**
+* @brief       This function fills memory with a byte value.
+*
+* @param       dst: pointer pointing to destination memory
+*
+* @param       val: value, the low 8 bits are written
+*
+* @param       cnt: 32 bit length of bytes to be set
+*
+*****************************************************************************/
+void Xil_MemSet(void* dst, s32 val, u32 cnt)
+{
+	u8 *d = (u8 *)dst;
+	u8 v = (u8)val;
+
+	if (cnt >= XIL_MEM_NEON_MIN) {
+		u32 head = (u32)(0U - (UINTPTR)d) & (XIL_MEM_ALIGN - 1U);
+		u32 blocks;
+
+		cnt -= head;
+		while (head > 0U) {
+			*d = v;
+			d += 1U;
+			head -= 1U;
+		}
+
+		blocks = cnt / XIL_MEM_BLOCK;
+		if (blocks > 0U) {
+			Xil_MemSetBlocks(d, v, blocks);
+		}
+		d += blocks * XIL_MEM_BLOCK;
+		cnt -= blocks * XIL_MEM_BLOCK;
+	}
+
+	while ((cnt) > 0U) {
+		*d = v;
+		d += 1U;
+		cnt -= 1U;
+	}
+}